@@ -0,0 +1,109 @@
+//MessageBroker dispatch cost with subscribers of the real client for 3 and 32 ports,
+//compared with the former release dispatch copying ImmutableStorage subscriber set under the lock for every message
+
+#include "MessageBroker.h"
+#include "ImmutableStorage.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+//former release MessageBroker
+class LegacyMessageBroker : public IMessageSender
+{
+    private:
+        std::mutex opLock;
+        ImmutableStorage<std::set<IMessageSubscriber*>> curSubs;
+    public:
+        LegacyMessageBroker():curSubs(std::set<IMessageSubscriber*>()) {}
+        void AddSubscriber(IMessageSubscriber* const subscriber)
+        {
+            const std::lock_guard<std::mutex> guard(opLock);
+            auto subs=curSubs.Get();
+            subs.insert(subscriber);
+            curSubs.Set(subs);
+        }
+        void SendMessage(const void* const source, const IMessage &message) final
+        {
+            opLock.lock();
+            auto subs=curSubs.Get();
+            opLock.unlock();
+            for(const auto &subscriber: subs)
+                if(subscriber->ReadyForMessage(message.msgType))
+                    subscriber->OnMessage(source,message);
+        }
+};
+
+//subscriber accepting the same message types as one of the client components
+class BenchSubscriber final : public IMessageSubscriber
+{
+    private:
+        const std::vector<MsgType> types;
+    public:
+        volatile uint64_t count;
+        BenchSubscriber(const std::vector<MsgType> &_types):types(_types),count(0) {}
+        bool ReadyForMessage(const MsgType msgType) final
+        {
+            for(const auto type:types)
+                if(type==msgType)
+                    return true;
+            return false;
+        }
+        void OnMessage(const void* const, const IMessage&) final { count=count+1; }
+};
+
+class TimerMessage: public ITimerMessage { public: TimerMessage(uint32_t _counter):ITimerMessage(_counter){} };
+class IdleStateMessage: public IIdleStateMessage { public: IdleStateMessage(const bool _idle):IIdleStateMessage(_idle){} };
+
+static std::vector<std::unique_ptr<BenchSubscriber>> CreateSubscribers(const int portCount)
+{
+    std::vector<std::unique_ptr<BenchSubscriber>> subscribers;
+    //PortWorker per port
+    for(int i=0;i<portCount;++i)
+        subscribers.push_back(std::make_unique<BenchSubscriber>(std::vector<MsgType>{MSG_PORT_OPEN,MSG_CONNECTED,MSG_IDLE_STATE}));
+    //DataProcessor, TCPTransport, UDPTransport, Timer, ShutdownHandler
+    subscribers.push_back(std::make_unique<BenchSubscriber>(std::vector<MsgType>{MSG_TIMER,MSG_INCOMING_PACKAGE,MSG_CONNECTED,MSG_IDLE_STATE,MSG_STATS}));
+    subscribers.push_back(std::make_unique<BenchSubscriber>(std::vector<MsgType>{MSG_SEND_PACKAGE,MSG_STATS}));
+    subscribers.push_back(std::make_unique<BenchSubscriber>(std::vector<MsgType>{MSG_SEND_PACKAGE,MSG_CONNECTED,MSG_STATS}));
+    subscribers.push_back(std::make_unique<BenchSubscriber>(std::vector<MsgType>{MSG_CONNECTED,MSG_STATS,MSG_IDLE_STATE}));
+    subscribers.push_back(std::make_unique<BenchSubscriber>(std::vector<MsgType>{MSG_SHUTDOWN}));
+    return subscribers;
+}
+
+template<typename Broker> static double Measure(Broker &broker, const IMessage &message, const int count)
+{
+    const auto start=std::chrono::steady_clock::now();
+    for(int i=0;i<count;++i)
+        broker.SendMessage(nullptr,message);
+    return std::chrono::duration<double,std::nano>(std::chrono::steady_clock::now()-start).count()/count;
+}
+
+template<typename Broker> static void Run(const char* const name, Broker &broker, const int portCount)
+{
+    const auto subscribers=CreateSubscribers(portCount);
+    for(auto &subscriber:subscribers)
+        broker.AddSubscriber(subscriber.get());
+    const int count=1000000;
+    const TimerMessage timer(0);
+    const IdleStateMessage idle(false);
+    Measure(broker,timer,count/10);
+    const auto timerNs=Measure(broker,timer,count);
+    const auto idleNs=Measure(broker,idle,count);
+    std::printf("%2d ports, %-7s: timer message %8.1f ns, idle state message %8.1f ns\n",portCount,name,timerNs,idleNs);
+}
+
+int main()
+{
+    std::shared_ptr<ILogger> logger;
+    for(const int portCount:{3,32})
+    {
+        LegacyMessageBroker legacy;
+        Run("legacy",legacy,portCount);
+        MessageBroker broker(logger);
+        Run("current",broker,portCount);
+    }
+    return 0;
+}
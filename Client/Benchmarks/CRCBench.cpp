@@ -0,0 +1,68 @@
+//package checksum throughput for payload sizes of the firmware board profiles and the largest UDP package,
+//every CRC-32C implementation is measured, so implementation file is included to reach them
+
+#include "CRC32C.cpp"
+#include "CRC8.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static uint32_t CRC32CBytewise(const uint8_t *source, size_t len)
+{
+    uint32_t crc=0xFFFFFFFF;
+    while(len--)
+        crc=(crc>>8)^crc32cTables.t[0][(crc^*source++)&0xFF];
+    return ~crc;
+}
+
+static uint32_t CRC8Wrapper(const uint8_t *source, size_t len)
+{
+    return CRC8(source,len);
+}
+
+static double Measure(uint32_t (* const func)(const uint8_t*, size_t), const std::vector<uint8_t> &buffer, const size_t size, uint32_t &sink)
+{
+    const size_t count=200000000/size;
+    const auto start=std::chrono::steady_clock::now();
+    //misaligned start is used for half of the calls, as payload follows metadata of any size
+    for(size_t i=0;i<count;++i)
+        sink^=func(buffer.data()+(i&1),size);
+    const auto seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    return static_cast<double>(count*size)/seconds/1e9;
+}
+
+int main()
+{
+    std::vector<uint8_t> buffer(2048);
+    for(size_t i=0;i<buffer.size();++i)
+        buffer[i]=static_cast<uint8_t>(i*131+7);
+    //all implementations must agree before being compared
+    for(size_t len=0;len<1500;++len)
+    {
+        const auto crc=CRC32CBytewise(buffer.data(),len);
+        bool match=CRC32CSlicing8(buffer.data(),len)==crc&&CRC32C(buffer.data(),len)==crc;
+#ifdef CRC32C_HW_SSE42
+        match&=!__builtin_cpu_supports("sse4.2")||CRC32CSSE42(buffer.data(),len)==crc;
+#endif
+        if(!match)
+        {
+            std::printf("CRC-32C implementations do not match for %zu bytes\n",len);
+            return 1;
+        }
+    }
+    std::printf("CRC32C() uses %s implementation, throughput in GB/s:\n",CRC32CImplName());
+    std::printf("%6s %9s %9s %9s %9s\n","bytes","crc8","bytewise","slicing8","sse4.2");
+    uint32_t sink=0;
+    for(const size_t size:{16,150,256,1024,1466})
+    {
+        std::printf("%6zu %9.2f %9.2f %9.2f",size,
+            Measure(CRC8Wrapper,buffer,size,sink),Measure(CRC32CBytewise,buffer,size,sink),Measure(CRC32CSlicing8,buffer,size,sink));
+#ifdef CRC32C_HW_SSE42
+        if(__builtin_cpu_supports("sse4.2"))
+            std::printf(" %9.2f",Measure(CRC32CSSE42,buffer,size,sink));
+#endif
+        std::printf("\n");
+    }
+    return static_cast<int>(sink&0);
+}
@@ -0,0 +1,70 @@
+//round-trip latency of single bytes sent to local TCP port of the client, while remote side loops serial port back
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    if(argc<2)
+    {
+        std::fprintf(stderr,"Usage: %s <local TCP port of the client> [count of pings, default: 2000]\n",argv[0]);
+        return 1;
+    }
+    const auto port=static_cast<uint16_t>(std::atoi(argv[1]));
+    const int count=argc>2?std::atoi(argv[2]):2000;
+
+    const int fd=socket(AF_INET,SOCK_STREAM,0);
+    sockaddr_in addr={};
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons(port);
+    addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    if(connect(fd,reinterpret_cast<sockaddr*>(&addr),sizeof(addr))!=0)
+    {
+        std::perror("Failed to connect");
+        return 1;
+    }
+    const int noDelay=1;
+    setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&noDelay,sizeof(noDelay));
+    timeval timeout={2,0};
+    setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+
+    std::vector<double> latency;
+    latency.reserve(static_cast<size_t>(count));
+    int lost=0;
+    for(int i=0;i<count;++i)
+    {
+        const uint8_t ping=static_cast<uint8_t>(i);
+        uint8_t pong=0;
+        const auto start=std::chrono::steady_clock::now();
+        if(send(fd,&ping,1,0)!=1)
+            break;
+        if(recv(fd,&pong,1,0)!=1||pong!=ping)
+        {
+            //timed out or out of sequence, resync by draining
+            ++lost;
+            while(recv(fd,&pong,1,MSG_DONTWAIT)==1);
+            continue;
+        }
+        latency.push_back(std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now()-start).count());
+    }
+    close(fd);
+
+    if(latency.empty())
+    {
+        std::printf("pings: 0, lost: %d\n",lost);
+        return 1;
+    }
+    std::sort(latency.begin(),latency.end());
+    const auto n=latency.size();
+    std::printf("pings: %zu, lost: %d, p50: %.0f us, p99: %.0f us, max: %.0f us\n",n,lost,latency[n/2],latency[n*99/100],latency[n-1]);
+    return 0;
+}
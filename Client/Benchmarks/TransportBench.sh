@@ -0,0 +1,53 @@
+#!/bin/bash
+#loopback benchmark of client transport backends against the firmware built for the host:
+#1-byte pings go through the client and remote serial port loopback, for every backend with TCP and UDP,
+#reports ping latency percentiles and socket syscalls per package of the transport carrying data
+#usage: TransportBench.sh <build dir configured with -DBUILD_BENCHMARKS=ON> [count of pings, default: 2000] [extra client parameters]
+
+set -e
+
+build="$1"
+count="${2:-2000}"
+shift 2 || shift $#
+extra=("$@")
+
+if [[ ! -x $build/uartclient || ! -x $build/hostfirmware_mega2560 || ! -x $build/pingbench ]]; then
+  echo "usage: $0 <build dir configured with -DBUILD_BENCHMARKS=ON> [count of pings] [extra client parameters]"
+  exit 1
+fi
+
+remote_addr="127.0.0.2"
+local_port="41001"
+poll_interval="1000"
+log_dir=$(mktemp -d)
+trap 'kill $client_pid $remote_pid 2>/dev/null || true; rm -rf "$log_dir"' EXIT
+
+run() {
+  local name="$1"; shift
+  "$build/hostfirmware_mega2560" "$remote_addr" >"$log_dir/remote.log" 2>&1 &
+  remote_pid=$!
+  sleep 0.3
+  "$build/uartclient" -ra "$remote_addr" -tp 50000 -lp1 "$local_port" -ps1 115200 -pm1 6 \
+    -ptl "$poll_interval" -ptr "$poll_interval" "$@" "${extra[@]}" >"$log_dir/client.log" 2>&1 &
+  client_pid=$!
+  sleep 2
+  local result
+  result=$("$build/pingbench" "$local_port" "$count" || true)
+  kill -USR1 $client_pid 2>/dev/null || true
+  sleep 0.3
+  kill -TERM $client_pid 2>/dev/null || true
+  wait $client_pid 2>/dev/null || true
+  kill $remote_pid 2>/dev/null || true
+  wait $remote_pid 2>/dev/null || true
+  local syscalls
+  syscalls=$(grep -a "syscalls per package" "$log_dir/client.log" | grep -v "received: 0;" | sed -E 's/.*\|\s*([A-Za-z]+)\]: .*syscalls per package: ([0-9.]+).*/\1 \2/' | tr '\n' ' ')
+  printf "%-14s %s; syscalls per package: %s\n" "$name" "$result" "$syscalls"
+}
+
+for transport in tcp udp; do
+  up=0
+  [[ $transport == udp ]] && up=1
+  run "$transport threads" -up $up
+  run "$transport epoll" -up $up -el 1
+  run "$transport io_uring" -up $up -io 1
+done
@@ -0,0 +1,24 @@
+#include "AsyncLogger.h"
+
+#include "AsyncLoggerFactory.h"
+
+AsyncLogger::AsyncLogger(AsyncLoggerFactory &_factory, const uint16_t _nameIdx):
+    factory(_factory),
+    nameIdx(_nameIdx)
+{
+}
+
+LogWriter AsyncLogger::Info()
+{
+    return factory.Write(nameIdx,LogLevel::Info);
+}
+
+LogWriter AsyncLogger::Warning()
+{
+    return factory.Write(nameIdx,LogLevel::Warning);
+}
+
+LogWriter AsyncLogger::Error()
+{
+    return factory.Write(nameIdx,LogLevel::Error);
+}
@@ -0,0 +1,23 @@
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include "ILogger.h"
+#include "LogWriter.h"
+
+#include <cstdint>
+
+class AsyncLoggerFactory;
+
+class AsyncLogger final : public ILogger
+{
+    private:
+        AsyncLoggerFactory &factory;
+        const uint16_t nameIdx;
+    public:
+        AsyncLogger(AsyncLoggerFactory &factory, const uint16_t nameIdx);
+        LogWriter Info() final;
+        LogWriter Warning() final;
+        LogWriter Error() final;
+};
+
+#endif // ASYNCLOGGER_H
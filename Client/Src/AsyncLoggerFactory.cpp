@@ -0,0 +1,330 @@
+#include "AsyncLoggerFactory.h"
+
+#include "AsyncLogger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+#include <ctime>
+#include <streambuf>
+#include <ostream>
+#include <iostream>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+static_assert(sizeof(AsyncLogRecord)==ASYNC_LOG_RECORD_SIZE,"AsyncLogRecord size mismatch");
+
+//fixed-size record ring, written only by the owning thread, read only by background thread
+struct AsyncLogRing
+{
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> head{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<bool> owned{true};
+    AsyncLogRecord records[ASYNC_LOG_RING_SIZE];
+    AsyncLogRecord scratch; //used when ring is full, never committed
+};
+
+//stream buffer over the record's text field, excess characters are discarded
+class RecordStreamBuf final : public std::streambuf
+{
+    private:
+        bool overflowed=false;
+    protected:
+        int_type overflow(int_type ch) final { overflowed=true; return traits_type::not_eof(ch); }
+    public:
+        void Bind(char * const buffer, const size_t size) { setp(buffer,buffer+size); overflowed=false; }
+        size_t GetLength() const { return static_cast<size_t>(pptr()-pbase()); }
+        bool IsOverflowed() const { return overflowed; }
+};
+
+class DiscardSink final : public ILogRecordSink
+{
+    public:
+        void Commit() final {}
+};
+
+class ThreadLogState final : public ILogRecordSink
+{
+    public:
+        AsyncLoggerFactory *owner=nullptr;
+        std::shared_ptr<AsyncLogRing> ring;
+        AsyncLogRecord *record=nullptr;
+        bool writing=false;
+        bool direct=false;
+        RecordStreamBuf buffer;
+        std::ostream stream;
+        std::ostream discardStream;
+        DiscardSink discardSink;
+        ThreadLogState(): stream(&buffer), discardStream(nullptr) {}
+        //ring is released on thread exit, so it may be reused by another thread after it is drained
+        ~ThreadLogState() { if(ring) ring->owned.store(false); }
+        void Commit() final
+        {
+            record->length=static_cast<uint16_t>(buffer.GetLength());
+            record->truncated=buffer.IsOverflowed();
+            if(direct)
+                owner->WriteDirect(*record);
+            else if(record!=&ring->scratch)
+                ring->head.store(ring->head.load(std::memory_order_relaxed)+1,std::memory_order_release);
+            writing=false;
+        }
+};
+
+static thread_local ThreadLogState threadLogState;
+
+static double GetTimeMark()
+{
+    timespec time={};
+    clock_gettime(CLOCK_MONOTONIC,&time);
+    return static_cast<double>(time.tv_sec)+static_cast<double>(time.tv_nsec)/1000000000.;
+}
+
+AsyncLoggerFactory::AsyncLoggerFactory()
+{
+    creationTime=GetTimeMark();
+    names.push_back("Logger"); //used for logger's own messages
+    maxNameWD=static_cast<unsigned int>(names.back().length());
+    shutdownPending=false;
+    Startup();
+    ApplyThreadParams(ThreadParams{"logger",SCHED_OTHER,0,{}});
+}
+
+AsyncLoggerFactory::~AsyncLoggerFactory()
+{
+    Shutdown();
+}
+
+std::shared_ptr<ILogger> AsyncLoggerFactory::CreateLogger(const std::string& name)
+{
+    const std::lock_guard<std::mutex> guard(namesLock);
+    names.push_back(name);
+    if(name.length()>maxNameWD)
+        maxNameWD=static_cast<unsigned int>(name.length());
+    return std::make_shared<AsyncLogger>(*this,static_cast<uint16_t>(names.size()-1));
+}
+
+std::shared_ptr<AsyncLogRing> AsyncLoggerFactory::AcquireRing()
+{
+    const std::lock_guard<std::mutex> guard(ringsLock);
+    //reuse drained ring left by exited thread
+    for(auto &ring:rings)
+        if(!ring->owned.load() && ring->head.load()==ring->tail.load())
+        {
+            ring->owned.store(true);
+            return ring;
+        }
+    rings.push_back(std::make_shared<AsyncLogRing>());
+    return rings.back();
+}
+
+LogWriter AsyncLoggerFactory::Write(const uint16_t nameIdx, const LogLevel level)
+{
+    auto &state=threadLogState;
+    if(state.owner!=this)
+    {
+        if(state.ring)
+            state.ring->owned.store(false);
+        state.ring=AcquireRing();
+        state.owner=this;
+    }
+    auto &ring=*(state.ring);
+    //nested logging from inside of another message's formatting is not supported
+    if(state.writing)
+    {
+        ring.dropped.fetch_add(1,std::memory_order_relaxed);
+        return LogWriter(state.discardStream,state.discardSink);
+    }
+    auto head=ring.head.load(std::memory_order_relaxed);
+    state.direct=false;
+    if(head-ring.tail.load(std::memory_order_acquire)>=ASYNC_LOG_RING_SIZE)
+    {
+        //errors are not lost, they are written right from the calling thread
+        state.direct=level==LogLevel::Error;
+        if(!state.direct)
+            ring.dropped.fetch_add(1,std::memory_order_relaxed);
+        state.record=&ring.scratch;
+    }
+    else
+        state.record=&ring.records[head%ASYNC_LOG_RING_SIZE];
+    state.record->time=GetTimeMark()-creationTime;
+    state.record->nameIdx=nameIdx;
+    state.record->level=level;
+    state.buffer.Bind(state.record->text,sizeof(state.record->text));
+    //same stream state as left by the header of synchronous LogWriter
+    state.stream.clear();
+    state.stream.flags(std::ios_base::dec|std::ios_base::skipws|std::ios_base::fixed);
+    state.stream.precision(2);
+    state.stream.fill(' ');
+    state.stream.width(0);
+    state.writing=true;
+    return LogWriter(state.stream,state);
+}
+
+void AsyncLoggerFactory::OnShutdown()
+{
+    const std::lock_guard<std::mutex> guard(shutdownLock);
+    shutdownPending=true;
+    shutdownCond.notify_one();
+}
+
+void AsyncLoggerFactory::Worker()
+{
+    while(true)
+    {
+        bool stop=false;
+        {
+            std::unique_lock<std::mutex> guard(shutdownLock);
+            shutdownCond.wait_for(guard,std::chrono::milliseconds(ASYNC_LOG_FLUSH_INTERVAL_MS),[this]{return shutdownPending;});
+            stop=shutdownPending;
+        }
+        Drain();
+        FlushAggregated(stop);
+        std::cout.flush();
+        if(stop)
+            return;
+    }
+}
+
+void AsyncLoggerFactory::Drain()
+{
+    {
+        const std::lock_guard<std::mutex> guard(ringsLock);
+        drainRings=rings;
+    }
+    drainHeads.resize(drainRings.size());
+    for(size_t i=0;i<drainRings.size();++i)
+        drainHeads[i]=drainRings[i]->head.load(std::memory_order_acquire);
+    const std::lock_guard<std::mutex> guard(namesLock);
+    //merge records from all rings in time order
+    while(true)
+    {
+        AsyncLogRing *next=nullptr;
+        for(size_t i=0;i<drainRings.size();++i)
+        {
+            auto &ring=*(drainRings[i]);
+            auto tail=ring.tail.load(std::memory_order_relaxed);
+            if(tail==drainHeads[i])
+                continue;
+            if(next==nullptr || ring.records[tail%ASYNC_LOG_RING_SIZE].time<next->records[next->tail.load(std::memory_order_relaxed)%ASYNC_LOG_RING_SIZE].time)
+                next=&ring;
+        }
+        if(next==nullptr)
+            break;
+        auto tail=next->tail.load(std::memory_order_relaxed);
+        ProcessRecord(next->records[tail%ASYNC_LOG_RING_SIZE]);
+        next->tail.store(tail+1,std::memory_order_release);
+    }
+    for(auto &ring:drainRings)
+    {
+        auto dropped=ring->dropped.exchange(0,std::memory_order_relaxed);
+        if(dropped<1)
+            continue;
+        auto text=std::to_string(dropped)+" log records lost, per-thread ring is full";
+        WriteLine(GetTimeMark()-creationTime,LogLevel::Warning,0,text.c_str(),text.length(),false);
+    }
+}
+
+void AsyncLoggerFactory::ProcessRecord(const AsyncLogRecord &record)
+{
+    size_t length=record.length;
+    while(length>0 && record.text[length-1]=='\n')
+        --length;
+    if(record.level!=LogLevel::Warning)
+    {
+        WriteLine(record.time,record.level,record.nameIdx,record.text,length,record.truncated);
+        return;
+    }
+    //messages that differ only by numbers are considered identical
+    keyBuf.clear();
+    keyBuf.push_back(static_cast<char>(record.level));
+    keyBuf.push_back(static_cast<char>(record.nameIdx&0xFF));
+    keyBuf.push_back(static_cast<char>(record.nameIdx>>8));
+    for(size_t i=0;i<length;++i)
+    {
+        if(!isdigit(static_cast<unsigned char>(record.text[i])))
+            keyBuf.push_back(record.text[i]);
+        else if(keyBuf.back()!='#')
+            keyBuf.push_back('#');
+    }
+    auto it=aggregated.find(keyBuf);
+    if(it==aggregated.end())
+        it=aggregated.emplace(keyBuf,AggregatedLogRecord{record.time,record.time,record.nameIdx,record.level,0,0,std::string()}).first;
+    auto &agg=it->second;
+    if(record.time-agg.windowStart>=ASYNC_LOG_AGGREGATE_INTERVAL)
+    {
+        FlushAggregated(false);
+        //entry may be removed by FlushAggregated
+        it=aggregated.emplace(keyBuf,AggregatedLogRecord{record.time,record.time,record.nameIdx,record.level,0,0,std::string()}).first;
+    }
+    auto &cur=it->second;
+    cur.lastTime=record.time;
+    if(cur.printed<ASYNC_LOG_AGGREGATE_BURST)
+    {
+        cur.printed++;
+        WriteLine(record.time,record.level,record.nameIdx,record.text,length,record.truncated);
+        return;
+    }
+    cur.suppressed++;
+    cur.lastText.assign(record.text,length);
+}
+
+void AsyncLoggerFactory::FlushAggregated(bool force)
+{
+    const auto now=GetTimeMark()-creationTime;
+    for(auto it=aggregated.begin();it!=aggregated.end();)
+    {
+        auto &agg=it->second;
+        if(!force && now-agg.windowStart<ASYNC_LOG_AGGREGATE_INTERVAL)
+        {
+            ++it;
+            continue;
+        }
+        if(agg.suppressed>0)
+        {
+            auto text=std::to_string(agg.suppressed)+" identical warnings suppressed in the last second, last one: "+agg.lastText;
+            WriteLine(agg.lastTime,agg.level,agg.nameIdx,text.c_str(),text.length(),false);
+        }
+        it=aggregated.erase(it);
+    }
+}
+
+void AsyncLoggerFactory::FormatLine(std::string &target, const double time, const LogLevel level, const uint16_t nameIdx, const char * const text, const size_t length, const bool truncated) const
+{
+    //same format as synchronous LogWriter header
+    char header[64];
+    const char *type=level==LogLevel::Info?"INFO":(level==LogLevel::Warning?"WARN":"ERR");
+    const auto &name=names[nameIdx];
+    auto hdrLen=snprintf(header,sizeof(header),"[%06.2f|%4s|",time,type);
+    target.assign(header,static_cast<size_t>(hdrLen>0?hdrLen:0));
+    if(name.length()<maxNameWD)
+        target.append(maxNameWD-name.length(),' ');
+    target.append(name);
+    target.append("]: ");
+    target.append(text,length);
+    if(truncated)
+        target.append("...");
+    target.push_back('\n');
+}
+
+void AsyncLoggerFactory::WriteLine(const double time, const LogLevel level, const uint16_t nameIdx, const char * const text, const size_t length, const bool truncated)
+{
+    FormatLine(lineBuf,time,level,nameIdx,text,length,truncated);
+    auto &output=level==LogLevel::Error?std::cerr:std::cout;
+    output.write(lineBuf.data(),static_cast<std::streamsize>(lineBuf.size()));
+}
+
+void AsyncLoggerFactory::WriteDirect(const AsyncLogRecord &record)
+{
+    size_t length=record.length;
+    while(length>0 && record.text[length-1]=='\n')
+        --length;
+    //names lock is also held by background thread while it writes drained records
+    const std::lock_guard<std::mutex> guard(namesLock);
+    std::string line;
+    FormatLine(line,record.time,record.level,record.nameIdx,record.text,length,record.truncated);
+    std::cerr.write(line.data(),static_cast<std::streamsize>(line.size()));
+}
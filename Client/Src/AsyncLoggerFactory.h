@@ -0,0 +1,97 @@
+#ifndef ASYNCLOGGERFACTORY_H
+#define ASYNCLOGGERFACTORY_H
+
+#include "ILogger.h"
+#include "ILoggerFactory.h"
+#include "LogWriter.h"
+#include "WorkerBase.h"
+
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+#define ASYNC_LOG_RECORD_SIZE 256 //fixed record size, longer messages are truncated
+#define ASYNC_LOG_RING_SIZE 256 //records per thread
+#define ASYNC_LOG_FLUSH_INTERVAL_MS 20
+#define ASYNC_LOG_AGGREGATE_INTERVAL 1.0 //seconds
+#define ASYNC_LOG_AGGREGATE_BURST 5 //identical warnings printed per interval before suppression starts
+
+enum class LogLevel : uint8_t
+{
+    Info,
+    Warning,
+    Error,
+};
+
+struct AsyncLogRecord
+{
+    double time;
+    uint16_t nameIdx;
+    LogLevel level;
+    bool truncated;
+    uint16_t length;
+    char text[ASYNC_LOG_RECORD_SIZE-16];
+};
+
+struct AggregatedLogRecord
+{
+    double windowStart;
+    double lastTime;
+    uint16_t nameIdx;
+    LogLevel level;
+    int printed;
+    int suppressed;
+    std::string lastText;
+};
+
+struct AsyncLogRing;
+
+//logger backend that does not block the calling thread on output:
+//callers format message text into fixed-size records at their own per-thread ring,
+//background thread writes headers and text to stdout/stderr, and aggregates bursts of identical warnings,
+//errors are never aggregated or dropped, they are written right from the calling thread if it's ring is full
+class AsyncLoggerFactory final : public ILoggerFactory, public WorkerBase
+{
+    private:
+        double creationTime;
+        std::mutex namesLock;
+        std::deque<std::string> names;
+        unsigned int maxNameWD;
+        std::mutex ringsLock;
+        std::vector<std::shared_ptr<AsyncLogRing>> rings;
+        std::mutex shutdownLock;
+        std::condition_variable shutdownCond;
+        bool shutdownPending;
+        //used only by background thread
+        std::vector<std::shared_ptr<AsyncLogRing>> drainRings;
+        std::vector<uint32_t> drainHeads;
+        std::unordered_map<std::string,AggregatedLogRecord> aggregated;
+        std::string keyBuf;
+        std::string lineBuf;
+        std::shared_ptr<AsyncLogRing> AcquireRing();
+        void Drain();
+        void ProcessRecord(const AsyncLogRecord &record);
+        void FlushAggregated(bool force);
+        void FormatLine(std::string &target, const double time, const LogLevel level, const uint16_t nameIdx, const char * const text, const size_t length, const bool truncated) const;
+        void WriteLine(const double time, const LogLevel level, const uint16_t nameIdx, const char * const text, const size_t length, const bool truncated);
+    protected:
+        //WorkerBase
+        void Worker() final;
+        void OnShutdown() final;
+    public:
+        AsyncLoggerFactory();
+        ~AsyncLoggerFactory();
+        //ILoggerFactory
+        std::shared_ptr<ILogger> CreateLogger(const std::string &name) final;
+        //start new record at the calling thread's ring, used by AsyncLogger
+        LogWriter Write(const uint16_t nameIdx, const LogLevel level);
+        //write record from the calling thread, used for errors when it's ring is full
+        void WriteDirect(const AsyncLogRecord &record);
+};
+
+#endif // ASYNCLOGGERFACTORY_H
@@ -0,0 +1,99 @@
+#include "CRC32C.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define CRC32C_HW_SSE42
+#endif
+
+#define CRC32C_POLY 0x82F63B78U //reflected
+
+//tables for slicing-by-8, table 0 is the regular byte-at-a-time table
+struct Crc32cTables
+{
+    uint32_t t[8][256];
+    constexpr Crc32cTables(): t()
+    {
+        for(uint32_t i=0;i<256;++i)
+        {
+            uint32_t crc=i;
+            for(int b=0;b<8;++b)
+                crc=(crc&1)?(crc>>1)^CRC32C_POLY:crc>>1;
+            t[0][i]=crc;
+        }
+        for(uint32_t i=0;i<256;++i)
+            for(int s=1;s<8;++s)
+                t[s][i]=(t[s-1][i]>>8)^t[0][t[s-1][i]&0xFF];
+    }
+};
+
+static constexpr Crc32cTables crc32cTables;
+
+static uint32_t CRC32CSlicing8(const uint8_t *source, size_t len)
+{
+    const auto &t=crc32cTables.t;
+    uint32_t crc=0xFFFFFFFF;
+    //input is processed as little-endian words
+    while(len>=8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo,source,4);
+        memcpy(&hi,source+4,4);
+        lo^=crc;
+        crc=t[7][lo&0xFF]^t[6][(lo>>8)&0xFF]^t[5][(lo>>16)&0xFF]^t[4][lo>>24]^
+            t[3][hi&0xFF]^t[2][(hi>>8)&0xFF]^t[1][(hi>>16)&0xFF]^t[0][hi>>24];
+        source+=8;
+        len-=8;
+    }
+    while(len--)
+        crc=(crc>>8)^t[0][(crc^*source++)&0xFF];
+    return ~crc;
+}
+
+#ifdef CRC32C_HW_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t CRC32CSSE42(const uint8_t *source, size_t len)
+{
+    uint64_t crc=0xFFFFFFFF;
+    while(len>=8)
+    {
+        uint64_t word;
+        memcpy(&word,source,8);
+        crc=_mm_crc32_u64(crc,word);
+        source+=8;
+        len-=8;
+    }
+    auto crc32=static_cast<uint32_t>(crc);
+    while(len--)
+        crc32=_mm_crc32_u8(crc32,*source++);
+    return ~crc32;
+}
+#endif
+
+struct Crc32cImpl
+{
+    uint32_t (*func)(const uint8_t*, size_t);
+    const char *name;
+};
+
+static Crc32cImpl SelectImpl()
+{
+#ifdef CRC32C_HW_SSE42
+    if(__builtin_cpu_supports("sse4.2"))
+        return Crc32cImpl{CRC32CSSE42,"sse4.2"};
+#endif
+    return Crc32cImpl{CRC32CSlicing8,"slicing-by-8"};
+}
+
+static const Crc32cImpl crc32cImpl=SelectImpl();
+
+uint32_t CRC32C(const uint8_t *source, size_t len)
+{
+    return crc32cImpl.func(source,len);
+}
+
+const char* CRC32CImplName()
+{
+    return crc32cImpl.name;
+}
@@ -0,0 +1,11 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstdint>
+#include <cstddef>
+
+//CRC-32C (Castagnoli), implementation is selected at runtime for current cpu
+uint32_t CRC32C(const uint8_t *source, size_t len);
+const char* CRC32CImplName();
+
+#endif // CRC32C_H
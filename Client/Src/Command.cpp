@@ -1,20 +1,61 @@
 #include "Command.h"
 #include "Config.h"
+#include "CRC8.h"
+#include "CRC32C.h"
 
-void Request::Write(const Request& source, const int portIndex, uint8_t* const rawBuffer)
+int Response::PayloadSize(const int portCount, const uint8_t features, const int maxPortSz, const uint8_t* const rawBuffer)
 {
-    const auto offset=PKG_HDR_SZ+portIndex*CMD_HDR_SIZE;
-    *(rawBuffer+offset)=static_cast<uint8_t>(source.type);
-    *(rawBuffer+offset+1)=source.arg;
-    *(rawBuffer+offset+2)=source.plSz;
+    int result=0;
+    for(int i=0;i<portCount;++i)
+    {
+        const int plSz=ReadCmdPayloadSize(rawBuffer,static_cast<uint8_t>(i),features);
+        if(plSz>maxPortSz)
+            return -1;
+        result+=plSz;
+    }
+    return result;
 }
 
-Response Response::Map(const int portIndex, const uint8_t* const rawBuffer)
+bool Hello::Map(const uint8_t* const rawBuffer, Hello& result)
 {
-    const auto offset=PKG_HDR_SZ+portIndex*CMD_HDR_SIZE;
-    //read current counter value
-    uint32_t counter=static_cast<uint32_t>(*(rawBuffer+PKG_CNT_OFFSET)|*(rawBuffer+PKG_CNT_OFFSET+1)<<8|*(rawBuffer+PKG_CNT_OFFSET+2)<<16|*(rawBuffer+PKG_CNT_OFFSET+3)<<24);
-    return Response{static_cast<RespType>(*(rawBuffer+offset)),*(rawBuffer+offset+1),*(rawBuffer+offset+2),counter};
+    if(rawBuffer[0]!=HS_MAGIC_0 || rawBuffer[1]!=HS_MAGIC_1 || rawBuffer[2]!=HS_VERSION || CRC8(rawBuffer,HELLO_SIZE-1)!=rawBuffer[HELLO_SIZE-1])
+        return false;
+    result.features=rawBuffer[3];
+    result.portCount=rawBuffer[4];
+    result.payloadSize=static_cast<uint16_t>(rawBuffer[5]|rawBuffer[6]<<8);
+    result.bufferSize=static_cast<uint16_t>(rawBuffer[7]|rawBuffer[8]<<8);
+    result.ioSize=static_cast<uint16_t>(rawBuffer[9]|rawBuffer[10]<<8);
+    result.aggregateMultiplier=rawBuffer[11];
+    return true;
+}
+
+void HelloRequest::Write(uint8_t* const rawBuffer)
+{
+    rawBuffer[0]=HS_MAGIC_0;
+    rawBuffer[1]=HS_MAGIC_1;
+    rawBuffer[2]=HS_VERSION;
+    rawBuffer[HELLO_REQUEST_SIZE-1]=CRC8(rawBuffer,HELLO_REQUEST_SIZE-1);
+}
+
+void Select::Write(const Select& source, uint8_t* const rawBuffer)
+{
+    rawBuffer[0]=HS_MAGIC_0;
+    rawBuffer[1]=HS_MAGIC_1;
+    rawBuffer[2]=source.features;
+    rawBuffer[SELECT_SIZE-1]=CRC8(rawBuffer,SELECT_SIZE-1);
+}
+
+void WritePayloadCRC(const int metaSz, const size_t pkgSz, uint8_t* const rawBuffer)
+{
+    const auto plOffset=static_cast<size_t>(metaSz+META_CRC_SZ);
+    WriteU32Value(CRC32C(rawBuffer+plOffset,pkgSz-plOffset),rawBuffer+metaSz-PL_CRC_SIZE);
+}
+
+bool VerifyPayloadCRC(const int metaSz, const size_t pkgSz, const uint8_t* const rawBuffer)
+{
+    const auto plOffset=static_cast<size_t>(metaSz+META_CRC_SZ);
+    const auto crc=rawBuffer+metaSz-PL_CRC_SIZE;
+    return CRC32C(rawBuffer+plOffset,pkgSz-plOffset)==static_cast<uint32_t>(*crc|*(crc+1)<<8|*(crc+2)<<16|*(crc+3)<<24);
 }
 
 void WriteU32Value(const uint32_t value, uint8_t* const target)
@@ -1,40 +1,70 @@
 #ifndef COMMAND_H
 #define COMMAND_H
 
-#include <cstdint>
-
-enum struct ReqType : uint8_t
-{
-    NoCommand = 0x00,
-    Reset = 0x01,
-    Open = 0x02,
-    Close = 0x04,
-    Data = 0x08,
-};
+#include "UARTEthernetBridge/protocol.h"
 
-enum struct RespType : uint8_t
-{
-    NoCommand = 0x00,
-    Data = 0x08,
-};
+#include <cstdint>
+#include <cstddef>
 
 struct Request
 {
-    static void Write(const Request& source, const int portIndex, uint8_t* const rawBuffer);
+    //command header layout depends on package format features, inlined so it is specialized for features known at compile time
+    static void Write(const Request& source, const int portIndex, const uint8_t features, uint8_t* const rawBuffer)
+    {
+        //credits field is not used in requests
+        WriteCmdHeader(rawBuffer,static_cast<uint8_t>(portIndex),features,static_cast<uint8_t>(source.type),source.arg,source.plSz,0);
+    }
     ReqType type;
     uint8_t arg;
-    uint8_t plSz;
+    uint16_t plSz;
 };
 
 struct Response
 {
-    static Response Map(const int portIndex, const uint8_t* const rawBuffer);
+    static Response Map(const int portIndex, const uint8_t features, const uint8_t* const rawBuffer)
+    {
+        const auto cmdHdr=rawBuffer+CmdHdrOffset(features,static_cast<uint8_t>(portIndex));
+        //read current counter value
+        const auto counter=static_cast<uint32_t>(*(rawBuffer+PKG_CNT_OFFSET)|*(rawBuffer+PKG_CNT_OFFSET+1)<<8|*(rawBuffer+PKG_CNT_OFFSET+2)<<16|*(rawBuffer+PKG_CNT_OFFSET+3)<<24);
+        return Response{static_cast<RespType>(*cmdHdr),*(cmdHdr+1),ReadCmdPayloadSize(rawBuffer,static_cast<uint8_t>(portIndex),features),counter,
+                        ReadCmdCredits(rawBuffer,static_cast<uint8_t>(portIndex),features)};
+    }
+    //sum of payload sizes for all ports, or -1 if payload size for any port exceeds maxPortSz
+    static int PayloadSize(const int portCount, const uint8_t features, const int maxPortSz, const uint8_t* const rawBuffer);
     RespType type;
     uint8_t arg;
-    uint8_t plSz;
+    uint16_t plSz;
     uint32_t counter;
+    //exact free space of remote ring-buffer, valid only with PKG_FEAT_CREDITS
+    uint16_t credits;
+};
+
+struct Hello
+{
+    //false if raw buffer does not contain valid hello of supported version
+    static bool Map(const uint8_t* const rawBuffer, Hello& result);
+    uint8_t features;
+    uint8_t portCount;
+    uint16_t payloadSize;
+    uint16_t bufferSize;
+    uint16_t ioSize;
+    uint8_t aggregateMultiplier;
+};
+
+struct HelloRequest
+{
+    static void Write(uint8_t* const rawBuffer);
+};
+
+struct Select
+{
+    static void Write(const Select& source, uint8_t* const rawBuffer);
+    uint8_t features;
 };
 
+//CRC-32C of the payload, stored at the end of metadata block, valid only with PKG_FEAT_PLCRC
+void WritePayloadCRC(const int metaSz, const size_t pkgSz, uint8_t* const rawBuffer);
+bool VerifyPayloadCRC(const int metaSz, const size_t pkgSz, const uint8_t* const rawBuffer);
 void WriteU32Value(const uint32_t value, uint8_t* const target);
 void WriteU16Value(const uint16_t value, uint8_t* const target);
 
@@ -1,9 +1,10 @@
 #include "Config.h"
+#include "Command.h"
 
-#define META_SZ(uart_count) (PKG_HDR_SZ+CMD_HDR_SIZE*uart_count)
-#define META_CRC_SZ 1
-#define PACKAGE_SIZE(uart_count,data_payload_size) (META_SZ(uart_count)+META_CRC_SZ+data_payload_size*uart_count)
-#define PORT_OFFSET(uart_count,data_payload_size,port_index) (META_SZ(uart_count)+META_CRC_SZ+data_payload_size*port_index)
+void Config::SetRemoteAggregateMultiplier(int multiplier)
+{
+    remoteAggregateMultiplier=multiplier;
+}
 
 void Config::SetServiceIntervalMS(int intervalMS)
 {
@@ -40,6 +41,11 @@ void Config::SetLocalRingBuffSec(int size)
     localRingBuffSec=size;
 }
 
+void Config::SetLocalRingBuffSize(int size)
+{
+    localRingBuffSize=size;
+}
+
 void Config::SetRemoteAddr(const std::string& addr)
 {
     remoteAddr=addr;
@@ -50,6 +56,96 @@ void Config::SetUDPEnabled(bool _enableUDP)
     enableUDP=_enableUDP;
 }
 
+void Config::SetIOURingEnabled(bool _enableIOURing)
+{
+    enableIOURing=_enableIOURing;
+}
+
+void Config::SetUDPReorderWindow(int packages)
+{
+    udpReorderWindow=packages;
+}
+
+void Config::SetTimerMode(TimerMode _timerMode)
+{
+    timerMode=_timerMode;
+}
+
+void Config::SetTimerSpinUS(int spinUS)
+{
+    timerSpinUS=spinUS;
+}
+
+void Config::SetVariableLengthEnabled(bool _enableVariableLength)
+{
+    enableVariableLength=_enableVariableLength;
+}
+
+void Config::SetSharedPayloadEnabled(bool _enableSharedPayload)
+{
+    enableSharedPayload=_enableSharedPayload;
+}
+
+void Config::Set16BitLengthEnabled(bool _enable16BitLength)
+{
+    enable16BitLength=_enable16BitLength;
+}
+
+void Config::SetHandshakeEnabled(bool _enableHandshake)
+{
+    enableHandshake=_enableHandshake;
+}
+
+void Config::SetCreditsEnabled(bool _enableCredits)
+{
+    enableCredits=_enableCredits;
+}
+
+void Config::SetPayloadCRCEnabled(bool _enablePayloadCRC)
+{
+    enablePayloadCRC=_enablePayloadCRC;
+}
+
+void Config::SetNackEnabled(bool _enableNack)
+{
+    enableNack=_enableNack;
+}
+
+void Config::SetFECGroupSize(int packages)
+{
+    fecGroupSize=packages;
+}
+
+void Config::SetDualPathEnabled(bool _enableDualPath)
+{
+    enableDualPath=_enableDualPath;
+}
+
+void Config::SetAutoPathEnabled(bool _enableAutoPath)
+{
+    enableAutoPath=_enableAutoPath;
+}
+
+void Config::SetAutoPathLossPercent(int percent)
+{
+    autoPathLossPercent=percent;
+}
+
+void Config::SetAutoPathRTTMS(int rttMS)
+{
+    autoPathRTTMS=rttMS;
+}
+
+void Config::SetIdleTimeoutMS(int timeoutMS)
+{
+    idleTimeoutMS=timeoutMS;
+}
+
+void Config::SetKeepaliveIntervalMS(int intervalMS)
+{
+    keepaliveIntervalMS=intervalMS;
+}
+
 void Config::SetRemotePollIntervalUS(int intervalUS)
 {
     remotePollInterval=intervalUS;
@@ -75,6 +171,11 @@ int Config::GetLocalRingBufferSec() const
     return localRingBuffSec;
 }
 
+int Config::GetLocalRingBufferSize() const
+{
+    return localRingBuffSize;
+}
+
 int Config::GetTCPBuffSz() const
 {
     return TCPBuffSz;
@@ -85,6 +186,11 @@ int Config::GetLingerSec() const
     return linger;
 }
 
+int Config::GetKeepaliveIntervalMS() const
+{
+    return keepaliveIntervalMS;
+}
+
 int Config::GetPortCount() const
 {
     return portCount;
@@ -92,17 +198,41 @@ int Config::GetPortCount() const
 
 int Config::GetNetPackageMetaSz() const
 {
-    return META_SZ(portCount);
+    return MetaSize(static_cast<uint8_t>(portCount),GetPackageFeatures());
 }
 
 int Config::GetNetPackageSz() const
 {
-    return PACKAGE_SIZE(portCount,portPLSize);
+    return PackageSize(static_cast<uint8_t>(portCount),static_cast<uint16_t>(portPLSize),GetPackageFeatures());
+}
+
+int Config::GetNetPackageHdrSz() const
+{
+    return enableVariableLength?PayloadOffset(static_cast<uint8_t>(portCount),GetPackageFeatures()):GetNetPackageSz();
 }
 
 int Config::GetPortBuffOffset(int portIndex) const
 {
-    return PORT_OFFSET(portCount,portPLSize,portIndex);
+    return PortOffset(static_cast<uint8_t>(portCount),static_cast<uint16_t>(portPLSize),GetPackageFeatures(),static_cast<uint8_t>(portIndex));
+}
+
+int Config::GetPortPayloadMaxSz() const
+{
+    //payload size is stored in a single byte of the port's command header, or in two bytes with 16-bit payload sizes
+    const int limit=enable16BitLength?0xFFFF:0xFF;
+    if(!enableSharedPayload)
+        return portPLSize;
+    return portPLSize*portCount>limit?limit:portPLSize*portCount;
+}
+
+int Config::GetCmdHdrSz() const
+{
+    return CmdHdrSize(GetPackageFeatures());
+}
+
+uint8_t Config::GetPackageFeatures() const
+{
+    return static_cast<uint8_t>((enableVariableLength?PKG_FEAT_VARLEN:0)|(enableSharedPayload?PKG_FEAT_SHARED:0)|(enable16BitLength?PKG_FEAT_LEN16:0)|(enableCredits?PKG_FEAT_CREDITS:0)|(enablePayloadCRC?PKG_FEAT_PLCRC:0)|(enableNack?PKG_FEAT_NACK:0)|(fecGroupSize>0?PKG_FEAT_FEC:0)|(enableDualPath?PKG_FEAT_DUAL:0));
 }
 
 int Config::GetPortPayloadSz() const
@@ -125,11 +255,101 @@ bool Config::GetUDPEnabled() const
     return enableUDP;
 }
 
+int Config::GetRemoteAggregateMultiplier() const
+{
+    return remoteAggregateMultiplier;
+}
+
 int Config::GetRemotePollIntervalUS() const
 {
     return remotePollInterval;
 }
 
+bool Config::GetIOURingEnabled() const
+{
+    return enableIOURing;
+}
+
+int Config::GetUDPReorderWindow() const
+{
+    return udpReorderWindow;
+}
+
+TimerMode Config::GetTimerMode() const
+{
+    return timerMode;
+}
+
+int Config::GetTimerSpinUS() const
+{
+    return timerSpinUS;
+}
+
+bool Config::GetVariableLengthEnabled() const
+{
+    return enableVariableLength;
+}
+
+bool Config::GetSharedPayloadEnabled() const
+{
+    return enableSharedPayload;
+}
+
+bool Config::Get16BitLengthEnabled() const
+{
+    return enable16BitLength;
+}
+
+bool Config::GetHandshakeEnabled() const
+{
+    return enableHandshake;
+}
+
+bool Config::GetCreditsEnabled() const
+{
+    return enableCredits;
+}
+
+bool Config::GetPayloadCRCEnabled() const
+{
+    return enablePayloadCRC;
+}
+
+bool Config::GetNackEnabled() const
+{
+    return enableNack;
+}
+
+int Config::GetFECGroupSize() const
+{
+    return fecGroupSize;
+}
+
+bool Config::GetDualPathEnabled() const
+{
+    return enableDualPath;
+}
+
+bool Config::GetAutoPathEnabled() const
+{
+    return enableAutoPath;
+}
+
+int Config::GetAutoPathLossPercent() const
+{
+    return autoPathLossPercent;
+}
+
+int Config::GetAutoPathRTTMS() const
+{
+    return autoPathRTTMS;
+}
+
+int Config::GetIdleTimeoutMS() const
+{
+    return idleTimeoutMS;
+}
+
 uint16_t Config::GetTCPPort() const
 {
     return tcpPort;
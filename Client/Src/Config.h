@@ -8,10 +8,8 @@
 #include <unordered_set>
 #include <sys/time.h>
 
-//some hardcoded params
-#define PKG_HDR_SZ 6
-#define PKG_CNT_OFFSET 2
-#define CMD_HDR_SIZE 3
+//some hardcoded params, package layout is defined at protocol.h shared with the firmware
+#define MAX_PACKAGE_SIZE_LEN16 1472 //ethernet MTU without IP and UDP headers
 
 #define NET_NAME "ENC28J65E366"
 #define NET_DOMAIN "lan"
@@ -21,13 +19,33 @@ class Config final : public IConfig
     private:
         int serviceInterval;
         int localRingBuffSec=1;
+        int localRingBuffSize=0;
         int TCPBuffSz;
         int linger;
         int portPLSize;
         int portCount;
         int remoteRingBuffSize;
         int remotePollInterval;
+        int remoteAggregateMultiplier=0;
         bool enableUDP;
+        bool enableIOURing=false;
+        int udpReorderWindow=4;
+        TimerMode timerMode=TimerMode::Sleep;
+        int timerSpinUS=100;
+        bool enableVariableLength=false;
+        bool enableSharedPayload=false;
+        bool enable16BitLength=false;
+        bool enableHandshake=false;
+        bool enableCredits=false;
+        bool enablePayloadCRC=false;
+        bool enableNack=false;
+        int fecGroupSize=0;
+        bool enableDualPath=false;
+        bool enableAutoPath=false;
+        int autoPathLossPercent=10;
+        int autoPathRTTMS=100;
+        int idleTimeoutMS=1000;
+        int keepaliveIntervalMS=250;
         uint16_t tcpPort;
         std::string remoteAddr;
     public:
@@ -37,8 +55,28 @@ class Config final : public IConfig
         void SetPortPayloadSize(int sz);
         void SetRemoteRingBuffSize(int size);
         void SetLocalRingBuffSec(int size);
+        void SetLocalRingBuffSize(int size);
         void SetUDPEnabled(bool enableUDP);
+        void SetIOURingEnabled(bool enableIOURing);
+        void SetUDPReorderWindow(int packages);
+        void SetTimerMode(TimerMode timerMode);
+        void SetTimerSpinUS(int spinUS);
+        void SetVariableLengthEnabled(bool enableVariableLength);
+        void SetSharedPayloadEnabled(bool enableSharedPayload);
+        void Set16BitLengthEnabled(bool enable16BitLength);
+        void SetHandshakeEnabled(bool enableHandshake);
+        void SetCreditsEnabled(bool enableCredits);
+        void SetPayloadCRCEnabled(bool enablePayloadCRC);
+        void SetNackEnabled(bool enableNack);
+        void SetFECGroupSize(int packages);
+        void SetDualPathEnabled(bool enableDualPath);
+        void SetAutoPathEnabled(bool enableAutoPath);
+        void SetAutoPathLossPercent(int percent);
+        void SetAutoPathRTTMS(int rttMS);
+        void SetIdleTimeoutMS(int timeoutMS);
+        void SetKeepaliveIntervalMS(int intervalMS);
         void SetRemotePollIntervalUS(int intervalUS);
+        void SetRemoteAggregateMultiplier(int multiplier);
         void SetServiceIntervalMS(int intervalMS);
         void SetTCPBuffSz(int sz);
         void SetLingerSec(int sz);
@@ -49,17 +87,41 @@ class Config final : public IConfig
         int GetPortPayloadSz() const final;
         int GetRemoteRingBuffSize() const final;
         int GetLocalRingBufferSec() const final;
+        int GetLocalRingBufferSize() const final;
         bool GetUDPEnabled() const final;
         int GetRemotePollIntervalUS() const final;
+        int GetRemoteAggregateMultiplier() const final;
+        bool GetIOURingEnabled() const final;
+        int GetUDPReorderWindow() const final;
+        TimerMode GetTimerMode() const final;
+        int GetTimerSpinUS() const final;
+        bool GetVariableLengthEnabled() const final;
+        bool GetSharedPayloadEnabled() const final;
+        bool Get16BitLengthEnabled() const final;
+        bool GetHandshakeEnabled() const final;
+        bool GetCreditsEnabled() const final;
+        bool GetPayloadCRCEnabled() const final;
+        bool GetNackEnabled() const final;
+        int GetFECGroupSize() const final;
+        bool GetDualPathEnabled() const final;
+        bool GetAutoPathEnabled() const final;
+        int GetAutoPathLossPercent() const final;
+        int GetAutoPathRTTMS() const final;
+        int GetIdleTimeoutMS() const final;
 
         int GetServiceIntervalMS() const final;
         timeval GetServiceIntervalTV() const final;
         int GetTCPBuffSz() const final;
         int GetLingerSec() const final;
+        int GetKeepaliveIntervalMS() const final;
 
         int GetNetPackageMetaSz() const final;
         int GetNetPackageSz() const final;
+        int GetNetPackageHdrSz() const final;
         int GetPortBuffOffset(int portIndex) const final;
+        int GetPortPayloadMaxSz() const final;
+        int GetCmdHdrSz() const final;
+        uint8_t GetPackageFeatures() const final;
 };
 
 #endif //CONFIG_H
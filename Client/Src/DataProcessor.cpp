@@ -1,28 +1,129 @@
 #include "DataProcessor.h"
 #include "Command.h"
 
-class SendPackageMessage: public ISendPackageMessage { public: SendPackageMessage(const bool _useTCP, uint8_t* const _package):ISendPackageMessage(_useTCP,_package){} };
+#include <cstring>
 
-DataProcessor::DataProcessor(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config, std::vector<std::shared_ptr<PortWorker> >& _portWorkers):
+class SendPackageMessage: public ISendPackageMessage { public: SendPackageMessage(const bool _useTCP, const PackageHandle& _handle, const size_t _size):ISendPackageMessage(_useTCP,_handle,_size){} };
+class IdleStateMessage: public IIdleStateMessage { public: IdleStateMessage(const bool _idle):IIdleStateMessage(_idle){} };
+
+//package format known at compile time, all offsets are constants and loop over ports is unrolled
+template<typename Layout, uint8_t Features>
+struct StaticFormat
+{
+    explicit StaticFormat(const IConfig&) {}
+    static constexpr uint8_t GetFeatures() { return Features; }
+    static constexpr size_t GetPortPayloadSz() { return Layout::GetPayloadSize(); }
+    static constexpr size_t GetPackageSize() { return Layout::GetPackageSize(Features); }
+    static constexpr size_t GetPortOffset(const uint8_t portIndex) { return Layout::GetPortOffset(Features,portIndex); }
+    template<typename F> static void ForEachPort(F &&f) { Layout::ForEachPort(f); }
+};
+
+//package format from config, read once per package
+struct RuntimeFormat
+{
+    const uint8_t portCount;
+    const uint16_t payloadSize;
+    const uint8_t features;
+    explicit RuntimeFormat(const IConfig& config):
+        portCount(static_cast<uint8_t>(config.GetPortCount())),
+        payloadSize(static_cast<uint16_t>(config.GetPortPayloadSz())),
+        features(config.GetPackageFeatures()) {}
+    uint8_t GetFeatures() const { return features; }
+    size_t GetPortPayloadSz() const { return payloadSize; }
+    size_t GetPackageSize() const { return PackageSize(portCount,payloadSize,features); }
+    size_t GetPortOffset(const uint8_t portIndex) const { return PortOffset(portCount,payloadSize,features,portIndex); }
+    template<typename F> void ForEachPort(F &&f) const
+    {
+        for(uint8_t i=0;i<portCount;++i)
+            f(i);
+    }
+};
+
+DataProcessor::DataProcessor(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config, std::vector<std::shared_ptr<PortWorker> >& _portWorkers, PackagePool& _packagePool, PathSelector& _pathSelector):
     logger(_logger),
     sender(_sender),
     config(_config),
     portWorkers(_portWorkers),
-    txBuff(std::make_unique<uint8_t[]>(static_cast<size_t>(config.GetNetPackageSz())))
+    packagePool(_packagePool),
+    pathSelector(_pathSelector),
+    pathWindow(DUAL_PATH_WINDOW,std::chrono::microseconds(DUAL_PATH_WINDOW*_config.GetRemotePollIntervalUS())),
+    barrierHoldTime((_config.GetUDPReorderWindow()+1)*_config.GetRemotePollIntervalUS()),
+    udpHoldTime(std::chrono::milliseconds(_config.GetServiceIntervalMS()))
 {
+    txPathSeq=0;
+    udpSynced=false;
+    nextUDPSeq=seqBarrier=0;
+    barrierHeld.reserve(AUTO_PATH_HOLD);
+    barrierLateCount.store(0);
+    barrierLostCount.store(0);
+    tcpPathActive=false;
+    udpHeld.reserve(AUTO_PATH_HOLD);
+    udpEarlyCount.store(0);
+    idle.store(false);
+    activityPending.store(false);
+    lastActivity=std::chrono::steady_clock::now();
+    txDemand.resize(portWorkers.size());
+    txLimit.resize(portWorkers.size());
+    //package format features selected on connect for the firmware board profiles: none with legacy firmware, or defaults from PKG_FEATURES,
+    //PKG_FEAT_NACK is added with UDP transport
+    encodeRequests=&DataProcessor::EncodeRequests<RuntimeFormat>;
+    decodeResponses=&DataProcessor::DecodeResponses<RuntimeFormat>;
+    SelectCodec<ProMiniLayout,0>() || SelectCodec<ProMiniLayout,PKG_FEAT_VARLEN|PKG_FEAT_SHARED|PKG_FEAT_CREDITS>() ||
+    SelectCodec<Mega2560Layout,0>() || SelectCodec<Mega2560Layout,PKG_FEAT_VARLEN|PKG_FEAT_SHARED|PKG_FEAT_CREDITS>() ||
+    SelectCodec<Mega2560Layout,PKG_FEAT_VARLEN|PKG_FEAT_SHARED|PKG_FEAT_CREDITS|PKG_FEAT_NACK>();
+}
+
+template<typename Layout, uint8_t Features>
+bool DataProcessor::SelectCodec()
+{
+    //PKG_FEAT_FEC does not change package layout, parity packages are handled by UDP transport
+    if(config.GetPortCount()!=Layout::GetPortCount() || config.GetPortPayloadSz()!=Layout::GetPayloadSize() || (config.GetPackageFeatures()&~PKG_FEAT_FEC)!=Features)
+        return false;
+    encodeRequests=&DataProcessor::EncodeRequests<StaticFormat<Layout,Features>>;
+    decodeResponses=&DataProcessor::DecodeResponses<StaticFormat<Layout,Features>>;
+    logger->Info()<<"Using package codec specialized for "<<static_cast<int>(Layout::GetPortCount())<<" ports, "<<Layout::GetPayloadSize()<<" bytes payload, features: "<<static_cast<int>(Features);
+    return true;
 }
 
 bool DataProcessor::ReadyForMessage(const MsgType msgType)
 {
-    return msgType==MSG_TIMER || msgType==MSG_INCOMING_PACKAGE;
+    return msgType==MSG_TIMER || msgType==MSG_INCOMING_PACKAGE || msgType==MSG_CONNECTED || msgType==MSG_IDLE_STATE || msgType==MSG_STATS;
 }
 
-void DataProcessor::OnMessage(const void* const, const IMessage& message)
+void DataProcessor::OnMessage(const void* const source, const IMessage& message)
 {
+    if(message.msgType==MSG_CONNECTED)
+    {
+        //remote side starts new path and UDP sequences
+        std::lock_guard<std::mutex> pushGuard(pushLock);
+        pathWindow.Reset();
+        barrierHeld.clear();
+        udpHeld.clear();
+        udpSynced=false;
+        tcpPathActive=false;
+        ReportActivity(true);
+    }
+    //port worker already sent wakeup on first data from local client
+    if(message.msgType==MSG_IDLE_STATE && source!=this && !static_cast<const IIdleStateMessage&>(message).idle)
+        ReportActivity(false);
     if(message.msgType==MSG_TIMER)
         OnPollEvent(static_cast<const ITimerMessage&>(message));
     if(message.msgType==MSG_INCOMING_PACKAGE)
         OnIncomingPackageEvent(static_cast<const IIncomingPackageMessage&>(message));
+    if(message.msgType==MSG_STATS)
+        OnStats();
+}
+
+void DataProcessor::OnStats()
+{
+    if(config.GetAutoPathEnabled())
+        logger->Info()<<"UDP packages dropped after data path moved to TCP: "<<barrierLateCount.load(std::memory_order_relaxed)<<
+            "; UDP packages not awaited before TCP ones: "<<barrierLostCount.load(std::memory_order_relaxed)<<
+            "; UDP packages delivered before the last TCP one: "<<udpEarlyCount.load(std::memory_order_relaxed);
+    if(!config.GetDualPathEnabled())
+        return;
+    logger->Info()<<"Dual path duplicates dropped: "<<pathWindow.GetLateCount()<<"; packages awaited from slower path: "<<pathWindow.GetReorderedCount()<<
+        "; packages lost: "<<pathWindow.GetLostCount();
 }
 
 //TODO: embed time value from ITimerMessage into the outgoing request
@@ -31,35 +132,164 @@ void DataProcessor::OnPollEvent(const ITimerMessage& message)
     //caller timer-thread may change if timer interval updated, so lock there as precaution
     std::lock_guard<std::mutex> pollGuard(pollLock);
 
+    //packages held by automatic path selection are released in time even if nothing else arrives
+    if(config.GetAutoPathEnabled())
+    {
+        std::lock_guard<std::mutex> pushGuard(pushLock);
+        ReleaseExpiredHeld();
+    }
+
     //logger->Info()<<"Poll event, counter: "<<message.counter;
 
+    //take new buffer for every package, so transports may keep previous packages queued
+    auto package=packagePool.Acquire();
+    if(!package.IsValid())
+    {
+        logger->Warning()<<"No free package buffers left, skipping poll event: "<<message.counter;
+        return;
+    }
+    auto txBuff=package.Get();
+
     //process data from the local connections, fill-up txBuffer
     bool useTCP=false;
     bool openTriggered=false;
-    for(int i=0;i<config.GetPortCount();++i)
-    {
-        auto request=portWorkers[static_cast<size_t>(i)]->ProcessTX(message.counter,txBuff.get()+config.GetPortBuffOffset(i));
-        if(request.type==ReqType::Open || request.type==ReqType::Close || request.type==ReqType::Reset)
-            useTCP=true;
-        if(request.type==ReqType::Open)
-            openTriggered=true;
-        Request::Write(request,i,txBuff.get());
-    }
+    bool active=activityPending.exchange(false);
+    if(config.GetSharedPayloadEnabled())
+        SharePayloadSpace();
+    const auto pkgSize=(this->*encodeRequests)(txBuff,message.counter,idle.load(),useTCP,openTriggered,active);
 
     //write counter to package header
     if(openTriggered)
     {
-        logger->Info()<<"Sending remote poll interval: "<<config.GetRemotePollIntervalUS();
-        WriteU32Value(static_cast<uint32_t>(config.GetRemotePollIntervalUS()),txBuff.get()+PKG_CNT_OFFSET);
+        //aggregate multiplier is placed at the top byte, 0 - keep IO_AGGREGATE_MULTIPLIER of the firmware
+        logger->Info()<<"Sending remote poll interval: "<<config.GetRemotePollIntervalUS()<<"; aggregate multiplier: "<<config.GetRemoteAggregateMultiplier();
+        WriteU32Value(static_cast<uint32_t>(config.GetRemotePollIntervalUS())|static_cast<uint32_t>(config.GetRemoteAggregateMultiplier())<<24,txBuff+PKG_CNT_OFFSET);
     }
     else
-        WriteU32Value(message.counter,txBuff.get()+PKG_CNT_OFFSET);
+        WriteU32Value(message.counter,txBuff+PKG_CNT_OFFSET);
 
-    if(!config.GetUDPEnabled())
+    if(!config.GetUDPEnabled() || pathSelector.UseTCP())
         useTCP=true;
 
+    //dual path: the same package goes via both transports, copy is needed because every transport writes it's own header and checksums
+    PackageHandle tcpCopy;
+    if(config.GetDualPathEnabled())
+    {
+        WritePathSeq(txBuff,static_cast<uint8_t>(config.GetPortCount()),config.GetPackageFeatures(),txPathSeq++);
+        tcpCopy=packagePool.Acquire();
+        if(tcpCopy.IsValid())
+            std::memcpy(tcpCopy.Get(),txBuff,pkgSize);
+        else
+            logger->Warning()<<"No free package buffers left, package is sent via UDP only: "<<message.counter;
+        useTCP=false;
+    }
+
     //send data
-    sender.SendMessage(this,SendPackageMessage(useTCP,txBuff.get()));
+    sender.SendMessage(this,SendPackageMessage(useTCP,package,pkgSize));
+    if(tcpCopy.IsValid())
+        sender.SendMessage(this,SendPackageMessage(true,tcpCopy,pkgSize));
+
+    UpdateIdleState(active);
+}
+
+//with variable-length packages payload of every port placed right after the previous one, returns package size
+template<typename Format>
+size_t DataProcessor::EncodeRequests(uint8_t* const txBuff, const uint32_t counter, const bool markIdle, bool& useTCP, bool& openTriggered, bool& active)
+{
+    const Format format(config);
+    const bool varLen=format.GetFeatures()&PKG_FEAT_VARLEN;
+    const bool sharedPayload=format.GetFeatures()&PKG_FEAT_SHARED;
+    size_t offset=format.GetPortOffset(0);
+    format.ForEachPort([&](const uint8_t i)
+    {
+        auto &portWorker=*portWorkers[i];
+        auto request=portWorker.ProcessTX(counter,txBuff+(varLen?offset:format.GetPortOffset(i)),sharedPayload?txLimit[i]:format.GetPortPayloadSz());
+        if(request.type==ReqType::Open || request.type==ReqType::Close || request.type==ReqType::Reset)
+            useTCP=true;
+        if(request.type==ReqType::Open)
+            openTriggered=true;
+        const bool paused=(request.type==ReqType::NoCommand || request.type==ReqType::Data) && portWorker.IsRXPaused();
+        if(paused)
+            request.arg|=REQ_ARG_PAUSE;
+        //paused port still has data pending at the remote side, so it is not considered idle
+        if(request.type!=ReqType::NoCommand || paused)
+            active=true;
+        else if(markIdle)
+            request.arg|=REQ_ARG_IDLE;
+        Request::Write(request,i,format.GetFeatures(),txBuff);
+        offset+=request.plSz;
+    });
+    return varLen?offset:format.GetPackageSize();
+}
+
+//weighted max-min fair share: ports that need less than their share give the rest of it to other ports
+void DataProcessor::SharePayloadSpace()
+{
+    const auto maxSz=static_cast<size_t>(config.GetPortPayloadMaxSz());
+    auto budget=static_cast<size_t>(config.GetPortPayloadSz()*config.GetPortCount());
+    size_t weightSum=0;
+    for(size_t i=0;i<portWorkers.size();++i)
+    {
+        txDemand[i]=portWorkers[i]->GetTXDemand();
+        if(txDemand[i]>maxSz)
+            txDemand[i]=maxSz;
+        txLimit[i]=0;
+        if(txDemand[i]>0)
+            weightSum+=portWorkers[i]->GetWeight();
+    }
+    //port with zero limit and non-zero demand is not satisfied yet
+    bool changed=true;
+    while(changed && weightSum>0)
+    {
+        changed=false;
+        for(size_t i=0;i<portWorkers.size();++i)
+        {
+            const size_t weight=portWorkers[i]->GetWeight();
+            if(txDemand[i]<1 || txLimit[i]>0 || txDemand[i]*weightSum>budget*weight)
+                continue;
+            txLimit[i]=txDemand[i];
+            budget-=txDemand[i];
+            weightSum-=weight;
+            changed=true;
+        }
+    }
+    if(weightSum<1)
+        return;
+    //remaining ports are limited by their share, space left after rounding goes to the first ones
+    auto left=budget;
+    for(size_t i=0;i<portWorkers.size();++i)
+        if(txDemand[i]>0 && txLimit[i]<1)
+        {
+            txLimit[i]=budget*portWorkers[i]->GetWeight()/weightSum;
+            left-=txLimit[i];
+        }
+    for(size_t i=0;i<portWorkers.size() && left>0;++i)
+        if(txDemand[i]>txLimit[i])
+        {
+            const auto extra=txDemand[i]-txLimit[i]<left?txDemand[i]-txLimit[i]:left;
+            txLimit[i]+=extra;
+            left-=extra;
+        }
+}
+
+void DataProcessor::UpdateIdleState(const bool active)
+{
+    if(config.GetIdleTimeoutMS()<1)
+        return;
+    const auto now=std::chrono::steady_clock::now();
+    if(active)
+    {
+        lastActivity=now;
+        if(idle.exchange(false))
+            sender.SendMessage(this,IdleStateMessage(false));
+        return;
+    }
+    //timer will switch to keepalive rate, port workers will start watching local clients for incoming data
+    if(!idle.load() && now-lastActivity>=std::chrono::milliseconds(config.GetIdleTimeoutMS()))
+    {
+        idle.store(true);
+        sender.SendMessage(this,IdleStateMessage(true));
+    }
 }
 
 void DataProcessor::OnIncomingPackageEvent(const IIncomingPackageMessage& message)
@@ -67,9 +297,191 @@ void DataProcessor::OnIncomingPackageEvent(const IIncomingPackageMessage& messag
     //may be ocassionally called simultaneously from TCP and UDP transport
     std::lock_guard<std::mutex> pushGuard(pushLock);
     //logger->Info()<<"Package event: "<<message.msgType;
-    for(int i=0;i<config.GetPortCount();++i)
+    //payload sizes are already verified by transports
+    if(config.GetAutoPathEnabled())
+    {
+        OnAutoPathPackage(message);
+        return;
+    }
+    if(!config.GetDualPathEnabled())
+    {
+        DecodePackage(message.package);
+        return;
+    }
+    //the first copy is taken, the second one is dropped as late, packages arrived ahead of missing ones wait for the slower path
+    pathWindow.Push(ReadPathSeq(message.package,static_cast<uint8_t>(config.GetPortCount()),config.GetPackageFeatures()),message.handle);
+    for(auto package=pathWindow.Pop();package.IsValid();package=pathWindow.Pop())
+        DecodePackage(package.Get());
+}
+
+void DataProcessor::DecodePackage(const uint8_t* const package)
+{
+    //remote side already left idle mode, resume polling at full rate right away
+    if((this->*decodeResponses)(package))
+        ReportActivity(true);
+}
+
+bool DataProcessor::UDPReachedBarrier(const uint16_t barrier) const
+{
+    return static_cast<uint16_t>(barrier-nextUDPSeq)==0 || static_cast<uint16_t>(barrier-nextUDPSeq)>=0x8000;
+}
+
+void DataProcessor::ReleaseBarrierHeld()
+{
+    for(auto &package:barrierHeld)
+        DecodeTCPPackage(package.Get());
+    barrierHeld.clear();
+    pathSelector.SetUDPMissing(0,0);
+}
+
+void DataProcessor::ReleaseUDPHeld()
+{
+    tcpPathActive=false;
+    for(auto &package:udpHeld)
+        DecodePackage(package.Get());
+    udpHeld.clear();
+}
+
+void DataProcessor::ReleaseExpiredHeld()
+{
+    const auto now=std::chrono::steady_clock::now();
+    //UDP packages still missing are considered lost
+    if(!barrierHeld.empty() && now-barrierStart>=barrierHoldTime)
+    {
+        barrierLostCount.fetch_add(static_cast<uint16_t>(seqBarrier-nextUDPSeq),std::memory_order_relaxed);
+        nextUDPSeq=seqBarrier;
+        ReleaseBarrierHeld();
+    }
+    if(!udpHeld.empty() && now-udpHeldStart>=udpHoldTime)
+    {
+        udpEarlyCount.fetch_add(udpHeld.size(),std::memory_order_relaxed);
+        ReleaseUDPHeld();
+    }
+}
+
+void DataProcessor::DecodeTCPPackage(const uint8_t* const package)
+{
+    DecodePackage(package);
+    //remote side sends nothing more via TCP until data path is moved to TCP again
+    if((static_cast<uint16_t>(package[1]<<8)&PKG_PATH_LAST)!=0)
+        ReleaseUDPHeld();
+    else
+        tcpPathActive=true;
+}
+
+void DataProcessor::UpdateUDPMissing()
+{
+    //UDP packages awaited before held TCP ones are requested via TCP, remote side retransmits them via UDP
+    const auto count=static_cast<uint16_t>(seqBarrier-nextUDPSeq);
+    pathSelector.SetUDPMissing(nextUDPSeq,static_cast<uint8_t>(count>UINT8_MAX?UINT8_MAX:count));
+}
+
+void DataProcessor::OnAutoPathPackage(const IIncomingPackageMessage& message)
+{
+    const auto header=static_cast<uint16_t>(*message.package|*(message.package+1)<<8);
+    const auto now=std::chrono::steady_clock::now();
+    if(!message.viaTCP)
     {
-        auto response=Response::Map(i,message.package);
-        portWorkers[static_cast<size_t>(i)]->ProcessRX(response,message.package+config.GetPortBuffOffset(i));
+        //UDP packages are already ordered by transport
+        if(udpSynced && static_cast<uint16_t>(header-nextUDPSeq)>=0x8000)
+        {
+            barrierLateCount.fetch_add(1,std::memory_order_relaxed);
+            return;
+        }
+        udpSynced=true;
+        if(!barrierHeld.empty())
+        {
+            //UDP packages still missing before the held TCP ones are skipped by transport, so they are considered lost
+            if(static_cast<uint16_t>(header-seqBarrier)<0x8000)
+            {
+                barrierLostCount.fetch_add(static_cast<uint16_t>(seqBarrier-nextUDPSeq),std::memory_order_relaxed);
+                ReleaseBarrierHeld();
+            }
+            else
+            {
+                nextUDPSeq=static_cast<uint16_t>(header+1);
+                DecodePackage(message.package);
+                if(UDPReachedBarrier(seqBarrier))
+                    ReleaseBarrierHeld();
+                else
+                    UpdateUDPMissing();
+                return;
+            }
+        }
+        nextUDPSeq=static_cast<uint16_t>(header+1);
+        //package is sent after the last TCP package, which is not delivered yet
+        if(tcpPathActive)
+        {
+            if(udpHeld.empty())
+                udpHeldStart=now;
+            if(barrierHeld.size()+udpHeld.size()<AUTO_PATH_HOLD && now-udpHeldStart<udpHoldTime)
+            {
+                udpHeld.push_back(message.handle);
+                return;
+            }
+            udpEarlyCount.fetch_add(udpHeld.size()+1,std::memory_order_relaxed);
+            ReleaseUDPHeld();
+        }
+        DecodePackage(message.package);
+        return;
     }
+    //data path is not moved to TCP, package is sent via TCP because UDP is not available at remote side
+    if((header&PKG_PATH_BARRIER)==0)
+    {
+        ReleaseBarrierHeld();
+        DecodePackage(message.package);
+        return;
+    }
+    //barrier carries lower bits of UDP sequence number, full value is restored relative to the next awaited one
+    const auto distance=static_cast<uint16_t>((header-nextUDPSeq)&PKG_PATH_SEQ_MASK);
+    const auto barrier=static_cast<uint16_t>(distance<=PKG_PATH_SEQ_MASK/2?nextUDPSeq+distance:nextUDPSeq-(PKG_PATH_SEQ_MASK+1-distance));
+    //remote side did not send anything via UDP yet
+    if(!udpSynced || UDPReachedBarrier(barrier))
+    {
+        ReleaseBarrierHeld();
+        DecodeTCPPackage(message.package);
+        return;
+    }
+    if(barrierHeld.empty())
+    {
+        barrierStart=now;
+        seqBarrier=barrier;
+        UpdateUDPMissing();
+    }
+    if(barrierHeld.size()+udpHeld.size()<AUTO_PATH_HOLD && now-barrierStart<barrierHoldTime)
+    {
+        barrierHeld.push_back(message.handle);
+        return;
+    }
+    //UDP packages still missing are considered lost
+    barrierLostCount.fetch_add(static_cast<uint16_t>(seqBarrier-nextUDPSeq),std::memory_order_relaxed);
+    nextUDPSeq=seqBarrier;
+    ReleaseBarrierHeld();
+    OnAutoPathPackage(message);
+}
+
+//returns true if response of any port carries a command
+template<typename Format>
+bool DataProcessor::DecodeResponses(const uint8_t* const package)
+{
+    const Format format(config);
+    const bool varLen=format.GetFeatures()&PKG_FEAT_VARLEN;
+    size_t offset=format.GetPortOffset(0);
+    bool active=false;
+    format.ForEachPort([&](const uint8_t i)
+    {
+        auto response=Response::Map(i,format.GetFeatures(),package);
+        portWorkers[i]->ProcessRX(response,package+(varLen?offset:format.GetPortOffset(i)));
+        offset+=response.plSz;
+        active|=response.type!=RespType::NoCommand;
+    });
+    return active;
+}
+
+void DataProcessor::ReportActivity(const bool wakeup)
+{
+    //idle state itself is updated on next poll event
+    activityPending.store(true);
+    if(wakeup && idle.load())
+        sender.SendMessage(this,IdleStateMessage(false));
 }
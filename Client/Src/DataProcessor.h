@@ -6,10 +6,21 @@
 #include "IMessageSubscriber.h"
 #include "IMessageSender.h"
 #include "PortWorker.h"
+#include "PackagePool.h"
+#include "ReorderWindow.h"
+#include "PathSelector.h"
 
 #include <memory>
 #include <mutex>
 #include <vector>
+#include <atomic>
+#include <chrono>
+
+//max count of packages arrived via faster path ahead of the missing one, while it's copy is on the way via slower path
+#define DUAL_PATH_WINDOW 32
+//max count of packages held by automatic path selection: TCP ones while UDP packages sent before them are awaited,
+//or UDP ones while the last TCP package is awaited after data path is moved back to UDP
+#define AUTO_PATH_HOLD 16
 
 class DataProcessor final : public IMessageSubscriber
 {
@@ -18,14 +29,60 @@ class DataProcessor final : public IMessageSubscriber
         IMessageSender& sender;
         const IConfig& config;
         std::vector<std::shared_ptr<PortWorker>> portWorkers;
-        std::unique_ptr<uint8_t[]> txBuff;
+        PackagePool& packagePool;
+        PathSelector& pathSelector;
         std::mutex pollLock;
         std::mutex pushLock;
+        //idle state is changed only from poll event, other threads only report activity
+        std::atomic<bool> idle;
+        std::atomic<bool> activityPending;
+        std::chrono::steady_clock::time_point lastActivity;
+        //per-port payload limits when payload space is shared between ports, preallocated
+        std::vector<size_t> txDemand;
+        std::vector<size_t> txLimit;
+        //package codec selected on construction, specialized for the default layouts of the firmware board profiles, or generic
+        size_t (DataProcessor::*encodeRequests)(uint8_t* const txBuff, const uint32_t counter, const bool markIdle, bool& useTCP, bool& openTriggered, bool& active);
+        bool (DataProcessor::*decodeResponses)(const uint8_t* const package);
+        //with dual path mode every package goes via both transports, copies of incoming packages are merged in path sequence order
+        uint16_t txPathSeq;
+        ReorderWindow pathWindow;
+        //with automatic path selection TCP packages carry next UDP sequence number of remote side while data path is TCP,
+        //so UDP packages sent before them are delivered first, and ones left behind are dropped as late
+        bool udpSynced;
+        uint16_t nextUDPSeq;
+        uint16_t seqBarrier;
+        std::vector<PackageHandle> barrierHeld;
+        std::chrono::steady_clock::time_point barrierStart;
+        const std::chrono::microseconds barrierHoldTime;
+        std::atomic<uint64_t> barrierLateCount;
+        std::atomic<uint64_t> barrierLostCount;
+        //when data path returns to UDP, UDP packages are held until the last TCP package marked by remote side is delivered,
+        //it is not lost with TCP, so it is awaited up to the service interval
+        bool tcpPathActive;
+        std::vector<PackageHandle> udpHeld;
+        std::chrono::steady_clock::time_point udpHeldStart;
+        const std::chrono::microseconds udpHoldTime;
+        std::atomic<uint64_t> udpEarlyCount;
     private:
+        template<typename Format> size_t EncodeRequests(uint8_t* const txBuff, const uint32_t counter, const bool markIdle, bool& useTCP, bool& openTriggered, bool& active);
+        template<typename Format> bool DecodeResponses(const uint8_t* const package);
+        template<typename Layout, uint8_t Features> bool SelectCodec();
         void OnPollEvent(const ITimerMessage& message);
         void OnIncomingPackageEvent(const IIncomingPackageMessage& message);
+        void OnAutoPathPackage(const IIncomingPackageMessage& message);
+        bool UDPReachedBarrier(const uint16_t barrier) const;
+        void ReleaseBarrierHeld();
+        void ReleaseUDPHeld();
+        void ReleaseExpiredHeld();
+        void UpdateUDPMissing();
+        void DecodePackage(const uint8_t* const package);
+        void DecodeTCPPackage(const uint8_t* const package);
+        void UpdateIdleState(const bool active);
+        void ReportActivity(const bool wakeup);
+        void SharePayloadSpace();
+        void OnStats();
     public:
-        DataProcessor(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config, std::vector<std::shared_ptr<PortWorker>>& portWorkers);
+        DataProcessor(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config, std::vector<std::shared_ptr<PortWorker>>& portWorkers, PackagePool& packagePool, PathSelector& pathSelector);
         //methods for ISubscriber
         bool ReadyForMessage(const MsgType msgType) final;
         void OnMessage(const void* const source, const IMessage& message) final;
@@ -0,0 +1,123 @@
+#include "EventLoop.h"
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define MAX_EVENTS 64
+
+class ShutdownMessage: public IShutdownMessage { public: ShutdownMessage(int _ec):IShutdownMessage(_ec){} };
+
+EventLoop::EventLoop(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config):
+    logger(_logger),
+    sender(_sender),
+    config(_config),
+    epollFd(epoll_create1(EPOLL_CLOEXEC)),
+    shutdownFd(eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC))
+{
+    shutdownPending.store(false);
+    if(epollFd<0 || shutdownFd<0)
+        return;
+    epoll_event ev={};
+    ev.events=EPOLLIN;
+    ev.data.fd=shutdownFd;
+    if(epoll_ctl(epollFd,EPOLL_CTL_ADD,shutdownFd,&ev)!=0)
+        logger->Error()<<"Failed to add shutdown event to epoll set: "<<strerror(errno);
+}
+
+EventLoop::~EventLoop()
+{
+    if(shutdownFd>=0)
+        close(shutdownFd);
+    if(epollFd>=0)
+        close(epollFd);
+}
+
+void EventLoop::HandleError(int ec, const std::string &message)
+{
+    logger->Error()<<message<<strerror(ec)<<std::endl;
+    sender.SendMessage(this,ShutdownMessage(ec));
+}
+
+bool EventLoop::AddFd(const int fd, const uint32_t events, IEventHandler* const handler)
+{
+    epoll_event ev={};
+    ev.events=events;
+    ev.data.fd=fd;
+    if(epoll_ctl(epollFd,EPOLL_CTL_ADD,fd,&ev)!=0)
+    {
+        //fd may be still registered from the previous owner (pty master is never closed between clients)
+        if(errno!=EEXIST || epoll_ctl(epollFd,EPOLL_CTL_MOD,fd,&ev)!=0)
+        {
+            logger->Error()<<"Failed to add fd "<<fd<<" to epoll set: "<<strerror(errno);
+            return false;
+        }
+    }
+    handlers[fd]=handler;
+    return true;
+}
+
+bool EventLoop::ModifyFd(const int fd, const uint32_t events)
+{
+    epoll_event ev={};
+    ev.events=events;
+    ev.data.fd=fd;
+    if(epoll_ctl(epollFd,EPOLL_CTL_MOD,fd,&ev)!=0)
+    {
+        logger->Error()<<"Failed to modify fd "<<fd<<" at epoll set: "<<strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void EventLoop::RemoveFd(const int fd)
+{
+    //fd may be already closed and automatically removed from epoll set, so ignore errors there
+    epoll_ctl(epollFd,EPOLL_CTL_DEL,fd,nullptr);
+    handlers.erase(fd);
+}
+
+void EventLoop::Worker()
+{
+    if(epollFd<0 || shutdownFd<0)
+    {
+        HandleError(errno,"Failed to create epoll or eventfd descriptors: ");
+        return;
+    }
+
+    logger->Info()<<"Starting event loop";
+    epoll_event events[MAX_EVENTS];
+    while(!shutdownPending.load())
+    {
+        auto count=epoll_wait(epollFd,events,MAX_EVENTS,config.GetServiceIntervalMS());
+        if(count<0)
+        {
+            auto error=errno;
+            if(error==EINTR)
+                continue;
+            HandleError(error,"epoll_wait failed: ");
+            return;
+        }
+        for(int i=0;i<count;++i)
+        {
+            const auto fd=events[i].data.fd;
+            if(fd==shutdownFd)
+                continue;
+            //handler may be removed by processing of previous events
+            auto handler=handlers.find(fd);
+            if(handler!=handlers.end())
+                handler->second->OnEvent(fd,events[i].events);
+        }
+    }
+    logger->Info()<<"Event loop shutdown";
+}
+
+void EventLoop::OnShutdown()
+{
+    shutdownPending.store(true);
+    uint64_t value=1;
+    if(write(shutdownFd,&value,sizeof(value))!=sizeof(value))
+        logger->Warning()<<"Failed to signal event loop shutdown: "<<strerror(errno);
+}
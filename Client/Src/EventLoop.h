@@ -0,0 +1,39 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include "IEventLoop.h"
+#include "IConfig.h"
+#include "ILogger.h"
+#include "IMessageSender.h"
+#include "WorkerBase.h"
+
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+
+//single-threaded epoll reactor, may be used to run listeners, port-workers, transports and timer in one thread
+class EventLoop final : public WorkerBase, public IEventLoop
+{
+    private:
+        std::shared_ptr<ILogger> logger;
+        IMessageSender& sender;
+        const IConfig& config;
+        const int epollFd;
+        const int shutdownFd;
+        std::atomic<bool> shutdownPending;
+        std::unordered_map<int,IEventHandler*> handlers;
+        void HandleError(int ec, const std::string& message);
+    public:
+        EventLoop(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config);
+        ~EventLoop();
+        //IEventLoop
+        bool AddFd(const int fd, const uint32_t events, IEventHandler* const handler) final;
+        bool ModifyFd(const int fd, const uint32_t events) final;
+        void RemoveFd(const int fd) final;
+    protected:
+        //WorkerBase
+        void Worker() final;
+        void OnShutdown() final;
+};
+
+#endif // EVENTLOOP_H
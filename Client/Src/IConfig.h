@@ -7,6 +7,14 @@
 #include <cstdint>
 #include <string>
 
+enum class TimerMode
+{
+    Sleep, //std::this_thread::sleep_for with drift correction
+    TimerFD, //absolute timerfd with CLOCK_MONOTONIC
+    NanoSleep, //clock_nanosleep with TIMER_ABSTIME
+    HybridSpin, //clock_nanosleep until shortly before deadline, then busy-wait
+};
+
 class IConfig
 {
     public:
@@ -16,17 +24,41 @@ class IConfig
         virtual int GetPortPayloadSz() const = 0; //-pls
         virtual int GetRemoteRingBuffSize() const = 0; //-rbs
         virtual int GetLocalRingBufferSec() const = 0; //TODO
+        virtual int GetLocalRingBufferSize() const = 0; //-lrs, 0 - calculated from port speed and GetLocalRingBufferSec
         virtual bool GetUDPEnabled() const = 0; //-udp
         virtual int GetRemotePollIntervalUS() const = 0;//-ptr
+        virtual int GetRemoteAggregateMultiplier() const = 0; //-agm, 0 - firmware default
+        virtual bool GetIOURingEnabled() const = 0; //-io
+        virtual int GetUDPReorderWindow() const = 0; //-urw
+        virtual TimerMode GetTimerMode() const = 0; //-tm
+        virtual int GetTimerSpinUS() const = 0; //-tms
+        virtual bool GetVariableLengthEnabled() const = 0; //-vl
+        virtual bool GetSharedPayloadEnabled() const = 0; //-sp
+        virtual bool Get16BitLengthEnabled() const = 0; //-wl
+        virtual bool GetCreditsEnabled() const = 0; //-cr
+        virtual bool GetPayloadCRCEnabled() const = 0; //-plc
+        virtual bool GetNackEnabled() const = 0; //-nak
+        virtual int GetFECGroupSize() const = 0; //-fec, 0 - disabled
+        virtual bool GetDualPathEnabled() const = 0; //-dp
+        virtual bool GetAutoPathEnabled() const = 0; //-ap
+        virtual int GetAutoPathLossPercent() const = 0; //-apl
+        virtual int GetAutoPathRTTMS() const = 0; //-apr, 0 - not used
+        virtual bool GetHandshakeEnabled() const = 0; //-hs, disabled automatically if remote side does not send hello
+        virtual int GetIdleTimeoutMS() const = 0; //-idl
 
         virtual int GetServiceIntervalMS() const = 0; //service param, not configurable for now
         virtual timeval GetServiceIntervalTV() const = 0; //service param, not configurable for now
         virtual int GetTCPBuffSz() const = 0; //service param, not configurable for now
         virtual int GetLingerSec() const = 0; //service param, not configurable for now
+        virtual int GetKeepaliveIntervalMS() const = 0; //service param, not configurable for now, must be less than remote alarm interval
 
         virtual int GetNetPackageMetaSz() const = 0; //auto-calculated
-        virtual int GetNetPackageSz() const = 0; //auto-calculated
+        virtual int GetNetPackageSz() const = 0; //auto-calculated, max size for variable-length packages
+        virtual int GetNetPackageHdrSz() const = 0; //auto-calculated, part of the package received before payload size is known
         virtual int GetPortBuffOffset(int portIndex) const = 0; //auto-calculated
+        virtual int GetPortPayloadMaxSz() const = 0; //auto-calculated, payload size limit for single port
+        virtual int GetCmdHdrSz() const = 0; //auto-calculated, command header size for single port
+        virtual uint8_t GetPackageFeatures() const = 0; //auto-calculated, package format features selected on handshake
 };
 
 #endif
@@ -0,0 +1,21 @@
+#ifndef IEVENTLOOP_H
+#define IEVENTLOOP_H
+
+#include <cstdint>
+
+class IEventHandler
+{
+    public:
+        virtual void OnEvent(const int fd, const uint32_t events) = 0; //events is a set of EPOLL* flags reported for fd
+};
+
+//all methods must be called either before event loop startup, or from the event loop thread itself (from IEventHandler::OnEvent)
+class IEventLoop
+{
+    public:
+        virtual bool AddFd(const int fd, const uint32_t events, IEventHandler* const handler) = 0;
+        virtual bool ModifyFd(const int fd, const uint32_t events) = 0;
+        virtual void RemoveFd(const int fd) = 0;
+};
+
+#endif // IEVENTLOOP_H
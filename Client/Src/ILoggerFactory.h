@@ -8,7 +8,7 @@ class ILoggerFactory
 {
     public:
         virtual std::shared_ptr<ILogger> CreateLogger(const std::string &name) = 0;
+        virtual ~ILoggerFactory() = default;
 };
 
 #endif // ILOGGER_FACTORY_H
-
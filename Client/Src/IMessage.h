@@ -3,6 +3,7 @@
 
 #include "PortConfig.h"
 #include "Connection.h"
+#include "PackagePool.h"
 #include <memory>
 
 enum MsgType
@@ -13,6 +14,9 @@ enum MsgType
     MSG_TIMER,
     MSG_SEND_PACKAGE,
     MSG_PORT_OPEN,
+    MSG_STATS,
+    MSG_IDLE_STATE,
+    MSG_TYPE_COUNT, //must be the last one
 };
 
 class IMessage
@@ -39,12 +43,15 @@ class IConnectedMessage : public IMessage
         const uint16_t udpPort;
 };
 
+//subscriber may keep a copy of handle to take shared ownership of the package buffer
 class IIncomingPackageMessage : public IMessage
 {
     protected:
-        IIncomingPackageMessage(const uint8_t* const _package):
-            IMessage(MSG_INCOMING_PACKAGE),package(_package){}
+        IIncomingPackageMessage(const bool _viaTCP, const PackageHandle& _handle):
+            IMessage(MSG_INCOMING_PACKAGE),viaTCP(_viaTCP),handle(_handle),package(_handle.Get()){}
     public:
+        const bool viaTCP;
+        const PackageHandle& handle;
         const uint8_t * const package;
 };
 
@@ -57,14 +64,18 @@ class ITimerMessage : public IMessage
         const uint32_t counter;
 };
 
+//subscriber may keep a copy of handle to send package asynchronously
+//size is less than package buffer size when variable-length packages are used
 class ISendPackageMessage : public IMessage
 {
     protected:
-        ISendPackageMessage(const bool _useTCP, uint8_t* const _package):
-            IMessage(MSG_SEND_PACKAGE),useTCP(_useTCP),package(_package){}
+        ISendPackageMessage(const bool _useTCP, const PackageHandle& _handle, const size_t _size):
+            IMessage(MSG_SEND_PACKAGE),useTCP(_useTCP),handle(_handle),package(_handle.Get()),size(_size){}
     public:
         const bool useTCP;
+        const PackageHandle& handle;
         uint8_t * const package;
+        const size_t size;
 };
 
 class IPortOpenMessage : public IMessage
@@ -77,4 +88,19 @@ class IPortOpenMessage : public IMessage
         std::shared_ptr<Connection>& connection;
 };
 
+class IStatsMessage : public IMessage
+{
+    protected:
+        IStatsMessage():IMessage(MSG_STATS){}
+};
+
+//sent when no data was transferred in both directions for a while, and again on first data to transfer
+class IIdleStateMessage : public IMessage
+{
+    protected:
+        IIdleStateMessage(const bool _idle):IMessage(MSG_IDLE_STATE),idle(_idle){}
+    public:
+        const bool idle;
+};
+
 #endif // IMESSAGE_H
@@ -6,6 +6,7 @@
 class IMessageSubscriber
 {
     public:
+        //result must not change after subscriber is added to the broker, it is cached in release builds
         virtual bool ReadyForMessage(const MsgType msgType) = 0;
         virtual void OnMessage(const void* const source, const IMessage &message) = 0;
 };
@@ -0,0 +1,337 @@
+#include "IOURing.h"
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+IOURing::IOURing(const unsigned _sendSlotCount):
+    slotCount(_sendSlotCount),
+    slots(_sendSlotCount)
+{
+    ringFd=-1;
+    sqRing=cqRing=MAP_FAILED;
+    sqes=nullptr;
+    sqRingSz=cqRingSz=sqesSz=0;
+    sqHead=sqTail=sqMask=sqEntries=sqArray=cqHead=cqTail=cqMask=nullptr;
+    cqes=nullptr;
+    sqLocalTail=0;
+    sqPending=0;
+    streamHead=streamCount=0;
+    streamOpen=false;
+    syscalls.store(0);
+}
+
+IOURing::~IOURing()
+{
+    Dispose();
+}
+
+bool IOURing::Setup(const unsigned entries)
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    io_uring_params params={};
+    ringFd=static_cast<int>(syscall(__NR_io_uring_setup,entries,&params));
+    if(ringFd<0)
+        return false;
+
+    sqRingSz=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+    cqRingSz=params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+    const bool singleMmap=(params.features&IORING_FEAT_SINGLE_MMAP)!=0;
+    if(singleMmap)
+        sqRingSz=cqRingSz=sqRingSz>cqRingSz?sqRingSz:cqRingSz;
+
+    sqRing=mmap(nullptr,sqRingSz,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ringFd,IORING_OFF_SQ_RING);
+    if(sqRing==MAP_FAILED)
+        return false;
+    cqRing=singleMmap?sqRing:mmap(nullptr,cqRingSz,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ringFd,IORING_OFF_CQ_RING);
+    if(cqRing==MAP_FAILED)
+        return false;
+    sqesSz=params.sq_entries*sizeof(io_uring_sqe);
+    auto sqesMap=mmap(nullptr,sqesSz,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ringFd,IORING_OFF_SQES);
+    if(sqesMap==MAP_FAILED)
+        return false;
+    sqes=static_cast<io_uring_sqe*>(sqesMap);
+
+    auto sqBase=static_cast<uint8_t*>(sqRing);
+    sqHead=reinterpret_cast<unsigned*>(sqBase+params.sq_off.head);
+    sqTail=reinterpret_cast<unsigned*>(sqBase+params.sq_off.tail);
+    sqMask=reinterpret_cast<unsigned*>(sqBase+params.sq_off.ring_mask);
+    sqEntries=reinterpret_cast<unsigned*>(sqBase+params.sq_off.ring_entries);
+    sqArray=reinterpret_cast<unsigned*>(sqBase+params.sq_off.array);
+    auto cqBase=static_cast<uint8_t*>(cqRing);
+    cqHead=reinterpret_cast<unsigned*>(cqBase+params.cq_off.head);
+    cqTail=reinterpret_cast<unsigned*>(cqBase+params.cq_off.tail);
+    cqMask=reinterpret_cast<unsigned*>(cqBase+params.cq_off.ring_mask);
+    cqes=reinterpret_cast<io_uring_cqe*>(cqBase+params.cq_off.cqes);
+    sqLocalTail=*sqTail;
+    sqPending=0;
+    return true;
+}
+
+void IOURing::Dispose()
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    //closing the ring cancels all pending operations
+    if(sqes!=nullptr)
+        munmap(sqes,sqesSz);
+    if(cqRing!=MAP_FAILED && cqRing!=sqRing)
+        munmap(cqRing,cqRingSz);
+    if(sqRing!=MAP_FAILED)
+        munmap(sqRing,sqRingSz);
+    if(ringFd>=0)
+        close(ringFd);
+    ringFd=-1;
+    sqRing=cqRing=MAP_FAILED;
+    sqes=nullptr;
+    cqes=nullptr;
+    for(auto &slot:slots)
+        slot.package=PackageHandle();
+    streamHead=streamCount=0;
+    streamOpen=false;
+    slotReleased.notify_all();
+}
+
+bool IOURing::IsReady()
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    return ringFd>=0 && cqes!=nullptr;
+}
+
+io_uring_sqe* IOURing::GetSQE()
+{
+    //sqLock must be held by caller
+    if(cqes==nullptr)
+        return nullptr;
+    const auto head=__atomic_load_n(sqHead,__ATOMIC_ACQUIRE);
+    if(sqLocalTail-head>=*sqEntries)
+        return nullptr;
+    const auto index=sqLocalTail&*sqMask;
+    auto sqe=&sqes[index];
+    memset(sqe,0,sizeof(io_uring_sqe));
+    sqArray[index]=index;
+    sqLocalTail++;
+    sqPending++;
+    return sqe;
+}
+
+void IOURing::FlushSQ()
+{
+    //sqLock must be held by caller
+    __atomic_store_n(sqTail,sqLocalTail,__ATOMIC_RELEASE);
+}
+
+int IOURing::Enter(unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    syscalls.fetch_add(1,std::memory_order_relaxed);
+    return static_cast<int>(syscall(__NR_io_uring_enter,ringFd,toSubmit,minComplete,flags,nullptr,0));
+}
+
+bool IOURing::SubmitSend(const size_t slot)
+{
+    //sqLock must be held by caller, io_uring_enter will not block here
+    auto sqe=GetSQE();
+    if(sqe==nullptr)
+        return false;
+    const auto &send=slots[slot];
+    sqe->opcode=IORING_OP_SEND;
+    sqe->fd=send.fd;
+    sqe->addr=reinterpret_cast<uint64_t>(send.package.Get());
+    sqe->len=static_cast<uint32_t>(send.len);
+    sqe->msg_flags=static_cast<uint32_t>(send.flags);
+    sqe->user_data=IOURING_SEND_TAG|slot;
+    FlushSQ();
+    const auto toSubmit=sqPending;
+    sqPending=0;
+    return Enter(toSubmit,0,0)>=0;
+}
+
+bool IOURing::Send(const int fd, const PackageHandle &package, const size_t len, const int flags)
+{
+    //submit is performed under lock, so ring cannot be disposed meanwhile
+    const std::lock_guard<std::mutex> guard(sqLock);
+    unsigned slot=0;
+    while(slot<slotCount && slots[slot].package.IsValid())
+        ++slot;
+    if(slot>=slotCount || cqes==nullptr)
+        return false;
+    slots[slot]=IOURingSend{package,len,fd,flags};
+    if(SubmitSend(slot))
+        return true;
+    slots[slot].package=PackageHandle();
+    return false;
+}
+
+bool IOURing::SendStream(const int fd, const PackageHandle &package, const size_t len, const int flags, const std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> guard(sqLock);
+    //sender waits while all slots are queued, so send rate is limited by the socket
+    if(!slotReleased.wait_for(guard,timeout,[this]{ return !streamOpen || streamCount<slotCount; }) || !streamOpen || cqes==nullptr)
+        return false;
+    const auto slot=(streamHead+streamCount)%slotCount;
+    slots[slot]=IOURingSend{package,len,fd,flags};
+    //send is submitted after completion of the previous one
+    if(++streamCount>1)
+        return true;
+    if(SubmitSend(slot))
+        return true;
+    DropStream();
+    return false;
+}
+
+void IOURing::DropStream()
+{
+    //sqLock must be held by caller
+    for(size_t i=0;i<streamCount;++i)
+        slots[(streamHead+i)%slotCount].package=PackageHandle();
+    streamCount=0;
+    slotReleased.notify_all();
+}
+
+void IOURing::OpenStream()
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    streamOpen=true;
+}
+
+bool IOURing::CloseStream(const uint64_t tag)
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    streamOpen=false;
+    slotReleased.notify_all();
+    if(streamCount<1)
+        return true;
+    //send in progress keeps it's slot until completion
+    for(size_t i=1;i<streamCount;++i)
+        slots[(streamHead+i)%slotCount].package=PackageHandle();
+    streamCount=1;
+    auto sqe=GetSQE();
+    if(sqe==nullptr)
+        return false;
+    sqe->opcode=IORING_OP_ASYNC_CANCEL;
+    sqe->fd=-1;
+    sqe->addr=IOURING_SEND_TAG|streamHead;
+    sqe->user_data=tag;
+    return true;
+}
+
+bool IOURing::IsStreamBusy()
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    return streamCount>0;
+}
+
+bool IOURing::PrepareRecv(const int fd, void * const buffer, const size_t len, const int flags, const uint64_t tag)
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    auto sqe=GetSQE();
+    if(sqe==nullptr)
+        return false;
+    sqe->opcode=IORING_OP_RECV;
+    sqe->fd=fd;
+    sqe->addr=reinterpret_cast<uint64_t>(buffer);
+    sqe->len=static_cast<uint32_t>(len);
+    sqe->msg_flags=static_cast<uint32_t>(flags);
+    sqe->user_data=tag;
+    return true;
+}
+
+bool IOURing::PrepareRecvMsg(const int fd, msghdr * const msg, const int flags, const uint64_t tag)
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    auto sqe=GetSQE();
+    if(sqe==nullptr)
+        return false;
+    sqe->opcode=IORING_OP_RECVMSG;
+    sqe->fd=fd;
+    sqe->addr=reinterpret_cast<uint64_t>(msg);
+    sqe->len=1;
+    sqe->msg_flags=static_cast<uint32_t>(flags);
+    sqe->user_data=tag;
+    return true;
+}
+
+bool IOURing::PrepareTimeout(const __kernel_timespec * const ts, const uint64_t tag)
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    auto sqe=GetSQE();
+    if(sqe==nullptr)
+        return false;
+    sqe->opcode=IORING_OP_TIMEOUT;
+    sqe->fd=-1;
+    sqe->addr=reinterpret_cast<uint64_t>(ts);
+    sqe->len=1;
+    sqe->user_data=tag;
+    return true;
+}
+
+bool IOURing::PrepareCancel(const uint64_t targetTag, const uint64_t tag)
+{
+    const std::lock_guard<std::mutex> guard(sqLock);
+    auto sqe=GetSQE();
+    if(sqe==nullptr)
+        return false;
+    sqe->opcode=IORING_OP_ASYNC_CANCEL;
+    sqe->fd=-1;
+    sqe->addr=targetTag;
+    sqe->user_data=tag;
+    return true;
+}
+
+int IOURing::SubmitAndWait(const unsigned minComplete)
+{
+    unsigned toSubmit=0;
+    {
+        const std::lock_guard<std::mutex> guard(sqLock);
+        if(cqes==nullptr)
+            return -EBADF;
+        FlushSQ();
+        toSubmit=sqPending;
+        sqPending=0;
+    }
+    auto result=Enter(toSubmit,minComplete,minComplete>0?IORING_ENTER_GETEVENTS:0);
+    return result<0?-errno:result;
+}
+
+bool IOURing::PopCompletion(uint64_t& tag, int& result, size_t& requested)
+{
+    if(cqes==nullptr)
+        return false;
+    const auto head=*cqHead;
+    if(head==__atomic_load_n(cqTail,__ATOMIC_ACQUIRE))
+        return false;
+    const auto &cqe=cqes[head&*cqMask];
+    tag=cqe.user_data;
+    result=cqe.res;
+    __atomic_store_n(cqHead,head+1,__ATOMIC_RELEASE);
+    requested=0;
+    if((tag&IOURING_SEND_TAG)!=0)
+    {
+        const std::lock_guard<std::mutex> guard(sqLock);
+        const auto slot=static_cast<size_t>(tag&~IOURING_SEND_TAG);
+        requested=slots[slot].len;
+        slots[slot].package=PackageHandle();
+        tag=IOURING_SEND_TAG;
+        if(streamCount<1 || slot!=streamHead)
+            return true;
+        streamHead=(streamHead+1)%slotCount;
+        streamCount--;
+        slotReleased.notify_all();
+        //rest of the stream must not be sent after failed or short send, caller resets connection
+        if(result<0 || static_cast<size_t>(result)!=requested)
+            DropStream();
+        else if(streamCount>0 && !SubmitSend(streamHead))
+        {
+            //next send cannot be submitted, reported as failure of this one
+            DropStream();
+            result=-EBUSY;
+        }
+    }
+    return true;
+}
+
+uint64_t IOURing::GetSyscallCount()
+{
+    return syscalls.load(std::memory_order_relaxed);
+}
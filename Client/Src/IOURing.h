@@ -0,0 +1,99 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include "PackagePool.h"
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <vector>
+
+//tag reported for completed send operations
+#define IOURING_SEND_TAG 0x8000000000000000UL
+//send slots of transport rings, every slot holds it's package until send is complete
+#define IOURING_SEND_SLOTS 8
+
+struct IOURingSend
+{
+    PackageHandle package;
+    size_t len;
+    int fd;
+    int flags;
+};
+
+//minimal io_uring wrapper without external dependencies (liburing is not required)
+//submission is thread-safe, completions must be consumed from a single thread,
+//single ring is used either for datagram sends with Send or for stream sends with SendStream
+class IOURing
+{
+    private:
+        const unsigned slotCount;
+        std::mutex sqLock;
+        int ringFd;
+        void *sqRing;
+        void *cqRing;
+        size_t sqRingSz;
+        size_t cqRingSz;
+        io_uring_sqe *sqes;
+        size_t sqesSz;
+        unsigned *sqHead;
+        unsigned *sqTail;
+        unsigned *sqMask;
+        unsigned *sqEntries;
+        unsigned *sqArray;
+        unsigned *cqHead;
+        unsigned *cqTail;
+        unsigned *cqMask;
+        io_uring_cqe *cqes;
+        unsigned sqLocalTail;
+        unsigned sqPending;
+        //send slots, keep ownership of package buffers until send is complete
+        std::vector<IOURingSend> slots;
+        std::condition_variable slotReleased;
+        //stream sends are queued at slots in order starting from streamHead, only the first one is in progress
+        size_t streamHead;
+        size_t streamCount;
+        bool streamOpen;
+        std::atomic<uint64_t> syscalls;
+        io_uring_sqe* GetSQE();
+        void FlushSQ();
+        int Enter(unsigned toSubmit, unsigned minComplete, unsigned flags);
+        bool SubmitSend(const size_t slot);
+        void DropStream();
+    public:
+        IOURing(const unsigned sendSlotCount);
+        ~IOURing();
+        bool Setup(const unsigned entries);
+        void Dispose();
+        bool IsReady();
+        //submit send operation without waiting for it's completion, package is held at free send slot until completion
+        bool Send(const int fd, const PackageHandle &package, const size_t len, const int flags);
+        //queue send operation on stream socket, sends are performed one by one, so data is never reordered or interleaved,
+        //waits for free send slot up to timeout, returns false on timeout, failure or if stream is closed
+        bool SendStream(const int fd, const PackageHandle &package, const size_t len, const int flags, const std::chrono::milliseconds timeout);
+        //allow stream sends for new connection, stream must be idle
+        void OpenStream();
+        //drop queued stream sends and prepare cancellation of the send in progress, new stream sends fail until OpenStream
+        bool CloseStream(const uint64_t tag);
+        //true while stream send is in progress, it's completion is still expected
+        bool IsStreamBusy();
+        //prepare operations, they will be submitted on next SubmitAndWait call
+        bool PrepareRecv(const int fd, void * const buffer, const size_t len, const int flags, const uint64_t tag);
+        bool PrepareRecvMsg(const int fd, msghdr * const msg, const int flags, const uint64_t tag);
+        bool PrepareTimeout(const __kernel_timespec * const ts, const uint64_t tag);
+        bool PrepareCancel(const uint64_t targetTag, const uint64_t tag);
+        int SubmitAndWait(const unsigned minComplete);
+        //get next completion, send slots are released automatically, requested is set to the send length for send completions,
+        //stream sends queued after failed or short send are dropped
+        bool PopCompletion(uint64_t &tag, int &result, size_t &requested);
+        uint64_t GetSyscallCount();
+};
+
+#endif // IOURING_H
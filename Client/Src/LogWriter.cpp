@@ -4,9 +4,10 @@
 
 LogWriter::LogWriter(std::ostream &_output, std::mutex &_extLock, const double &time, const std::string &type, const int& typeWD, const std::string &name, const int& nameWD):
     output(_output),
-    extLock(_extLock)
+    extLock(&_extLock),
+    sink(nullptr)
 {
-    extLock.lock();
+    extLock->lock();
     endl=false;
     //write header
     output<<"["<<std::fixed<<std::setprecision(2)<<std::setfill('0')<<std::setw(6)<<time<<\
@@ -14,11 +15,36 @@ LogWriter::LogWriter(std::ostream &_output, std::mutex &_extLock, const double &
     //std::cout<<"!!!create!!!"<<std::endl;
 }
 
+LogWriter::LogWriter(std::ostream &_output, ILogRecordSink &_sink):
+    output(_output),
+    extLock(nullptr),
+    sink(&_sink)
+{
+    endl=false;
+}
+
+LogWriter::LogWriter(LogWriter &&other):
+    output(other.output),
+    extLock(other.extLock),
+    sink(other.sink),
+    endl(other.endl)
+{
+    other.extLock=nullptr;
+    other.sink=nullptr;
+}
+
 LogWriter::~LogWriter()
 {
+    if(sink!=nullptr)
+    {
+        sink->Commit();
+        return;
+    }
+    if(extLock==nullptr)
+        return;
     if(!endl)
         output<<std::endl;
-    extLock.unlock();
+    extLock->unlock();
 }
 
 LogWriter& LogWriter::operator<<(std::ostream& (*manip)(std::ostream&))
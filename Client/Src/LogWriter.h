@@ -5,20 +5,30 @@
 #include <string>
 #include <mutex>
 
+//receives the record formatted by LogWriter, used by asynchronous loggers
+class ILogRecordSink
+{
+    public:
+        virtual void Commit() = 0;
+};
+
 class LogWriter
 {
     private:
         std::ostream &output;
-        std::mutex &extLock;
+        std::mutex *extLock;
+        ILogRecordSink *sink;
         bool endl;
     public:
         //constructor aquires shared extLock and write formated header to output from remaining paramters
         LogWriter(std::ostream& output, std::mutex &extLock, const double& time, const std::string& type, const int& typeWD, const std::string& name, const int& nameWD);
-        //destructor releases shared extLock allowing other LogWriters to run
+        //constructor for asynchronous mode, output is a per-thread record buffer, header is written later by the sink
+        LogWriter(std::ostream& output, ILogRecordSink &sink);
+        //destructor releases shared extLock allowing other LogWriters to run, or commits the record to the sink
         ~LogWriter();
         //other constructors
         LogWriter (LogWriter&) = delete;
-        LogWriter (LogWriter&&) = default;
+        LogWriter (LogWriter&& other);
         //<< override for manipulators, detects use of excess std::endl
         LogWriter& operator<<(std::ostream& (*manip)(std::ostream&));
         //main << override for all other stuff
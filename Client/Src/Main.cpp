@@ -1,6 +1,7 @@
 #include "OptionsParser.h"
 #include "ILogger.h"
 #include "StdioLoggerFactory.h"
+#include "AsyncLoggerFactory.h"
 #include "ImmutableStorage.h"
 #include "IPAddress.h"
 #include "MessageBroker.h"
@@ -16,6 +17,8 @@
 #include "DataProcessor.h"
 #include "PortWorker.h"
 #include "RemoteBufferTracker.h"
+#include "EventLoop.h"
+#include "CRC32C.h"
 
 #include <cstdint>
 #include <memory>
@@ -25,6 +28,8 @@
 #include <cstring>
 #include <csignal>
 #include <climits>
+#include <thread>
+#include <chrono>
 #include <sys/time.h>
 
 #include <unistd.h>
@@ -32,6 +37,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+
+class StatsMessage: public IStatsMessage { public: StatsMessage():IStatsMessage(){} };
 
 // examples
 
@@ -56,22 +64,56 @@
 void usage(const std::string &self)
 {
     std::cerr<<"Usage: "<<self<<" [parameters]"<<std::endl;
-    std::cerr<<"  mandatory parameters, must match the values hardcoded at server firmware:"<<std::endl;
+    std::cerr<<"  mandatory parameters:"<<std::endl;
     std::cerr<<"    -ra <ip address, or host name> remote address to connect"<<std::endl;
     std::cerr<<"    -tp <port> remote TCP port"<<std::endl;
+    std::cerr<<"  parameters reported by remote side on connect, mandatory only with firmware that does not send hello, or with -hs 0:"<<std::endl;
     std::cerr<<"    -pc <count> UART port count configured at remote side, required to match for operation"<<std::endl;
     std::cerr<<"    -pls <bytes> network payload size for single port in bytes, required to match for operation"<<std::endl;
-    std::cerr<<"    -rbs <bytes> remote ring-buffer size for incoming data, should match to prevent data loss"<<std::endl;
+    std::cerr<<"    -rbs <bytes> remote ring-buffer size for incoming data, must not exceed the remote value to prevent data loss"<<std::endl;
     std::cerr<<"  uart port related parameters:"<<std::endl;
     std::cerr<<"    -ps{n} <speed in bits-per-second> open remote uart port #n at provided speed, example: -ps1 57600"<<std::endl;
     std::cerr<<"    -pm{n} <mode number> set mode for remote uart port #n, example: -pm1 6 (equals to SERIAL_8N1 arduino-define)"<<std::endl;
     std::cerr<<"    -rst{n} <0,1> perform reset on connection to port #n, default: 0 - do not perform reset"<<std::endl;
+    std::cerr<<"    -pw{n} <1-255> share of package payload space for port #n when it is shared between ports with -sp 1, default: 1"<<std::endl;
+    std::cerr<<"    -pio{n} <bytes> uart read and write size per remote uart poll for port #n, up to -pls, default: PORT_IO_SIZE at firmware"<<std::endl;
     std::cerr<<"    -lp{n} <port> local TCP port number OR file path for creating PTS symlink, example -lp1 40001 -lp2 40002 -lp3 /tmp/usbETH3"<<std::endl;
     std::cerr<<"  optional parameters:"<<std::endl;
+    std::cerr<<"    -hs <0,1> 0 - do not wait for hello from remote side on connect, required for firmware that does not send it, package format features are not used, default: 1 - detected on startup"<<std::endl;
     std::cerr<<"    -up <0,1> 1 - enable use of less reliable UDP transport with lower latency and jitter, default: 0 - disabled"<<std::endl;
+    std::cerr<<"    -urw <0-16> UDP reorder window: max count of packages arrived ahead of missing ones, held for up to this count of -ptr intervals and delivered in order, default: 4, 0 - drop out-of-order packages"<<std::endl;
+    std::cerr<<"    -vl <0,1> 1 - send and receive variable-length packages carrying only used payload bytes, must be supported by PKG_FEATURES at firmware, default: selected on handshake, 0 - fixed-size packages"<<std::endl;
+    std::cerr<<"    -wl <0,1> 1 - use 16-bit payload lengths allowing network packages up to "<<MAX_PACKAGE_SIZE_LEN16<<" bytes, must be supported by PKG_FEATURES at firmware, default: selected on handshake if payload may exceed 255 bytes, 0 - 8-bit payload lengths"<<std::endl;
+    std::cerr<<"    -sp <0,1> 1 - share package payload space between active ports instead of fixed slot per port, implies -vl 1, must be supported by PKG_FEATURES at firmware, default: selected on handshake, 0 - disabled"<<std::endl;
+    std::cerr<<"    -cr <0,1> 1 - remote side reports exact free space of it's ring-buffers, so they may be filled completely, must be supported by PKG_FEATURES at firmware, default: selected on handshake, 0 - stop sending when remote ring-buffer is half full"<<std::endl;
+    std::cerr<<"    -plc <0,1> 1 - protect package payload with CRC-32C, corrupted UDP packages are dropped and TCP connection is reset, must be supported by PKG_FEATURES at firmware, default: 0 - only metadata is protected"<<std::endl;
+    std::cerr<<"    -nak <0,1> 1 - request retransmission of lost UDP packages detected with -urw window, and keep history of sent packages for retransmission, must be supported by PKG_FEATURES at firmware, default: selected on handshake with -up 1, 0 - disabled"<<std::endl;
+    std::cerr<<"    -fec <0-16> UDP forward error correction: count of sent UDP packages followed by XOR parity package, so single lost package of the group is restored without retransmission, must be supported by PKG_FEATURES at firmware, default: 0 - disabled"<<std::endl;
+    std::cerr<<"    -dp <0,1> 1 - send every package via both UDP and TCP, the first copy to arrive is used and the other one is dropped, requires -up 1, must be supported by PKG_FEATURES at firmware, default: 0 - disabled"<<std::endl;
+    std::cerr<<"    -ap <0,1> 1 - move data path to TCP while UDP path measured with probe packages degrades, and back to UDP after it recovers, requires -up 1, default: 0 - disabled"<<std::endl;
+    std::cerr<<"    -apl <1-100> UDP loss in percent that moves data path to TCP with -ap 1, path returns to UDP when loss stays below half of it, default: 10"<<std::endl;
+    std::cerr<<"    -apr <time, ms> UDP round-trip time that moves data path to TCP with -ap 1, path returns to UDP when it stays below half of it, default: 100, 0 - not used"<<std::endl;
     std::cerr<<"    -la <ip-addr> local IP to listen for TCP channels enabled by -lp{n} option, default: 127.0.0.1"<<std::endl;
     std::cerr<<"    -ptl <time, us> interval in micro-seconds between polling+sending data operations, limits outgoing throughput, default: 8192, invalid values will result in data loss"<<std::endl;
     std::cerr<<"    -ptr <time, us> remote poll interval, limits incoming throughput, default: 8192, invalid values will result in data loss"<<std::endl;
+    std::cerr<<"    -lrs <bytes> size of local ring-buffer for data received from each remote uart, remote side stops reading the uart when it is almost full, default: 1 second of data at port speed"<<std::endl;
+    std::cerr<<"    -agm <1-255> number of remote uart polls aggregated into single package sent every -ptr interval, default: IO_AGGREGATE_MULTIPLIER at firmware"<<std::endl;
+    std::cerr<<"    -idl <time, ms> switch both sides to keepalive poll rate after no data was transferred for this time, polling at full rate resumes on first data, default: 1000, 0 - disabled"<<std::endl;
+    std::cerr<<"    -el <0,1> 1 - run all listeners, port workers, transports and timer in a single epoll event-loop thread, default: 0 - use separate thread for each"<<std::endl;
+    std::cerr<<"    -io <0,1> 1 - use io_uring for TCP/UDP transport socket operations if supported by kernel, ignored in event-loop mode, default: 0 - use regular socket calls"<<std::endl;
+    std::cerr<<"    -tm <0-3> poll timer backend: 0 - sleep (default), 1 - absolute timerfd, 2 - clock_nanosleep with absolute deadline, 3 - clock_nanosleep followed by busy-wait"<<std::endl;
+    std::cerr<<"    -tms <time, us> busy-wait time before deadline for -tm 3 timer backend, default: 100"<<std::endl;
+    std::cerr<<"  scheduling parameters for latency-critical threads:"<<std::endl;
+    std::cerr<<"    -rtp <0,1> realtime scheduling policy used by -rtt, -rtn and -rtw options: 0 - SCHED_FIFO (default), 1 - SCHED_RR"<<std::endl;
+    std::cerr<<"    -rtt <1-99> realtime priority for poll timer thread (and event-loop thread with -el 1), default: not set, use regular scheduling"<<std::endl;
+    std::cerr<<"    -rtn <1-99> realtime priority for TCP and UDP transport threads, default: not set"<<std::endl;
+    std::cerr<<"    -rtw <1-99> realtime priority for port worker threads, default: not set"<<std::endl;
+    std::cerr<<"    -cpt <cpu list> CPU affinity for poll timer thread (and event-loop thread with -el 1), example: -cpt 2 or -cpt 0,2-3, default: not set"<<std::endl;
+    std::cerr<<"    -cpn <cpu list> CPU affinity for TCP and UDP transport threads, default: not set"<<std::endl;
+    std::cerr<<"    -cpw <cpu list> CPU affinity for port worker threads, default: not set"<<std::endl;
+    std::cerr<<"    -ml <0,1> 1 - lock all current and future memory with mlockall, so buffers are prefaulted and never swapped out, default: 0"<<std::endl;
+    std::cerr<<"    -al <0,1> 1 - format and write log messages at separate thread, repeated warnings are aggregated, errors are never dropped, default: 0 - write log messages directly from calling thread"<<std::endl;
+    std::cerr<<"  send SIGUSR1 signal to print transport statistics"<<std::endl;
 
 }
 
@@ -82,6 +124,76 @@ int param_error(const std::string &self, const std::string &message)
     return 1;
 }
 
+static bool ParseCPUList(const std::string &list, std::vector<int> &cpus)
+{
+    //comma-separated list of cpu numbers and ranges, example: 0,2-3
+    size_t pos=0;
+    while(pos<list.size())
+    {
+        auto next=list.find(',',pos);
+        if(next==std::string::npos)
+            next=list.size();
+        const auto item=list.substr(pos,next-pos);
+        const auto dash=item.find('-');
+        char *endFirst=nullptr, *endLast=nullptr;
+        const auto firstStr=item.substr(0,dash);
+        const auto lastStr=dash==std::string::npos?firstStr:item.substr(dash+1);
+        const auto first=strtol(firstStr.c_str(),&endFirst,10);
+        const auto last=strtol(lastStr.c_str(),&endLast,10);
+        if(firstStr.empty() || lastStr.empty() || *endFirst!='\0' || *endLast!='\0' || first<0 || last<first || last>=CPU_SETSIZE)
+            return false;
+        for(auto cpu=first;cpu<=last;++cpu)
+            cpus.push_back(static_cast<int>(cpu));
+        pos=next+1;
+    }
+    return !cpus.empty();
+}
+
+static bool ParseThreadParams(OptionsParser &options, const std::string &prioParam, const std::string &cpuParam, const int policy, ThreadParams &params)
+{
+    if(options.CheckParamPresent(prioParam,false,""))
+    {
+        options.CheckIsInteger(prioParam,1,99,true,"Realtime priority value is invalid");
+        params.policy=policy;
+        params.priority=options.GetInteger(prioParam);
+    }
+    if(options.CheckParamPresent(cpuParam,false,""))
+        return ParseCPUList(options.GetString(cpuParam),params.cpus);
+    return true;
+}
+
+static void ApplyThreadParams(std::shared_ptr<ILogger> &logger, WorkerBase &worker, const ThreadParams &params)
+{
+    auto ec=worker.ApplyThreadParams(params);
+    if(ec!=0)
+        logger->Warning()<<"Failed to apply scheduling parameters for thread "<<params.name<<": "<<strerror(ec);
+}
+
+//packages that may be in use at the same time, every consumer holds it's packages until they are sent, delivered or dropped
+static size_t GetPackagePoolSize(const IConfig &config)
+{
+    //tx package and it's copy for TCP in data processor, package being received by TCP transport
+    size_t result=3;
+    //sends queued at TCP io_uring ring
+    if(config.GetIOURingEnabled())
+        result+=IOURING_SEND_SLOTS;
+    //packages awaiting the slower path, or held after data path is moved to TCP, in data processor
+    if(config.GetDualPathEnabled())
+        result+=DUAL_PATH_WINDOW;
+    if(config.GetAutoPathEnabled())
+        result+=AUTO_PATH_HOLD;
+    if(!config.GetUDPEnabled())
+        return result;
+    //rx batch and tx queue, reorder window with the package just pushed, parity, probe and restored packages
+    result+=UDP_BATCH_SIZE*2+static_cast<size_t>(config.GetUDPReorderWindow())+1+3;
+    //retransmission history, it may keep packages already sent from tx queue
+    if(config.GetNackEnabled())
+        result+=UDP_TX_HISTORY_SIZE;
+    if(config.GetIOURingEnabled())
+        result+=IOURING_SEND_SLOTS;
+    return result;
+}
+
 int main (int argc, char *argv[])
 {
     //parse command-line options, fillup config
@@ -97,17 +209,92 @@ int main (int argc, char *argv[])
     options.CheckIsInteger("tp",1,65535,true,"TCP port is invalid");
     config.SetTCPPort(static_cast<uint16_t>(options.GetInteger("tp")));
 
-    options.CheckParamPresent("pc",true,"port count must be provided");
-    options.CheckIsInteger("pc",1,32,true,"port count value is invalid");
-    config.SetPortCount(options.GetInteger("pc"));
+    config.SetTCPBuffSz(65536);
+    config.SetServiceIntervalMS(500); //management interval
+    config.SetLingerSec(30); //linger
+    config.SetKeepaliveIntervalMS(250); //poll interval while idle, must be less than DEFAULT_ALARM_INTERVAL_MS at firmware
 
-    options.CheckParamPresent("pls",true,"Network payload size must be provided");
-    options.CheckIsInteger("pls",1,255,true,"Network payload size must be provided");
-    config.SetPortPayloadSize(options.GetInteger("pls"));
+    bool asyncLogging=false;
+    if(options.CheckParamPresent("al",false,""))
+    {
+        options.CheckIsBoolean("al",true,"Asynchronous logging parameter is invalid");
+        asyncLogging=options.GetBoolean("al");
+    }
 
-    options.CheckParamPresent("rbs",true,"remote ring-buffer size is missing");
-    options.CheckIsInteger("rbs",1,65535,true,"remote ring-buffer size is invalid!");
-    config.SetRemoteRingBuffSize(options.GetInteger("rbs"));
+    //logger is needed early to report remote side detection
+    std::unique_ptr<ILoggerFactory> logFactory;
+    if(asyncLogging)
+        logFactory=std::make_unique<AsyncLoggerFactory>();
+    else
+        logFactory=std::make_unique<StdioLoggerFactory>();
+    auto mainLogger=logFactory->CreateLogger("Main");
+
+    //read remote side configuration, legacy firmware does not send it
+    bool handshake=true;
+    if(options.CheckParamPresent("hs",false,""))
+    {
+        options.CheckIsBoolean("hs",true,"Handshake mode parameter is invalid");
+        handshake=options.GetBoolean("hs");
+    }
+    Hello hello={};
+    if(handshake)
+    {
+        auto probe=TCPTransport::Probe(config,hello);
+        if(probe==ProbeResult::NoConnection)
+            mainLogger->Info()<<"Waiting for remote side: "<<config.GetRemoteAddr()<<":"<<config.GetTCPPort();
+        while(probe==ProbeResult::NoConnection)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.GetServiceIntervalMS()));
+            probe=TCPTransport::Probe(config,hello);
+        }
+        if(probe==ProbeResult::InvalidHello)
+            return param_error(argv[0],"Remote side sent invalid or unsupported hello");
+        handshake=probe==ProbeResult::HelloReceived;
+        if(handshake)
+            mainLogger->Info()<<"Remote side: ports: "<<static_cast<int>(hello.portCount)<<", payload: "<<hello.payloadSize<<", buffer: "<<hello.bufferSize<<
+                                ", io: "<<hello.ioSize<<"x"<<static_cast<int>(hello.aggregateMultiplier)<<", features: 0x"<<std::hex<<static_cast<int>(hello.features)<<std::dec;
+        else
+            mainLogger->Info()<<"Remote side does not send hello, running without handshake";
+    }
+    config.SetHandshakeEnabled(handshake);
+
+    //pc, pls and rbs are taken from the hello if omitted
+    if(!handshake)
+        options.CheckParamPresent("pc",true,"port count must be provided");
+    if(options.CheckParamPresent("pc",false,""))
+    {
+        options.CheckIsInteger("pc",1,32,true,"port count value is invalid");
+        config.SetPortCount(options.GetInteger("pc"));
+    }
+    else
+        config.SetPortCount(hello.portCount);
+    if(handshake && config.GetPortCount()!=hello.portCount)
+        return param_error(argv[0],"Port count does not match UART_COUNT="+std::to_string(hello.portCount)+" reported by remote side");
+
+    if(!handshake)
+        options.CheckParamPresent("pls",true,"Network payload size must be provided");
+    if(options.CheckParamPresent("pls",false,""))
+    {
+        options.CheckIsInteger("pls",1,MAX_PACKAGE_SIZE_LEN16,true,"Network payload size is invalid");
+        config.SetPortPayloadSize(options.GetInteger("pls"));
+    }
+    else
+        config.SetPortPayloadSize(hello.payloadSize);
+    if(handshake && config.GetPortPayloadSz()!=hello.payloadSize)
+        return param_error(argv[0],"Network payload size does not match DATA_PAYLOAD_SIZE="+std::to_string(hello.payloadSize)+" reported by remote side");
+
+    if(!handshake)
+        options.CheckParamPresent("rbs",true,"remote ring-buffer size is missing");
+    if(options.CheckParamPresent("rbs",false,""))
+    {
+        options.CheckIsInteger("rbs",1,65535,true,"remote ring-buffer size is invalid!");
+        config.SetRemoteRingBuffSize(options.GetInteger("rbs"));
+    }
+    else
+        config.SetRemoteRingBuffSize(hello.bufferSize);
+    //smaller value is allowed, it only limits the amount of data in flight
+    if(handshake && config.GetRemoteRingBuffSize()>hello.bufferSize)
+        return param_error(argv[0],"Remote ring-buffer size exceeds DATA_BUFFER_SIZE="+std::to_string(hello.bufferSize)+" reported by remote side");
 
     //ps, pm, rst, lp params parsed below
 
@@ -119,6 +306,120 @@ int main (int argc, char *argv[])
         config.SetUDPEnabled(options.GetBoolean("up"));
     }
 
+    if(options.CheckParamPresent("urw",false,""))
+    {
+        options.CheckIsInteger("urw",0,16,true,"UDP reorder window is invalid");
+        config.SetUDPReorderWindow(options.GetInteger("urw"));
+    }
+
+    //package format features not set explicitly are selected from the ones supported by remote side
+    if(options.CheckParamPresent("vl",false,""))
+    {
+        options.CheckIsBoolean("vl",true,"Variable-length package mode parameter is invalid");
+        config.SetVariableLengthEnabled(options.GetBoolean("vl"));
+    }
+    else if(handshake)
+        config.SetVariableLengthEnabled(hello.features&PKG_FEAT_VARLEN);
+
+    if(options.CheckParamPresent("sp",false,""))
+    {
+        options.CheckIsBoolean("sp",true,"Shared payload mode parameter is invalid");
+        config.SetSharedPayloadEnabled(options.GetBoolean("sp"));
+        //payload of every port is placed right after the previous one
+        if(config.GetSharedPayloadEnabled())
+            config.SetVariableLengthEnabled(true);
+    }
+    else if(handshake)
+        config.SetSharedPayloadEnabled((hello.features&PKG_FEAT_SHARED) && config.GetVariableLengthEnabled());
+
+    //not selected automatically, it costs remote side ~35 cpu cycles per payload byte by estimate, Firmware/CRC32CBench measures it on the board
+    if(options.CheckParamPresent("plc",false,""))
+    {
+        options.CheckIsBoolean("plc",true,"Payload CRC mode parameter is invalid");
+        config.SetPayloadCRCEnabled(options.GetBoolean("plc"));
+    }
+
+    if(options.CheckParamPresent("wl",false,""))
+    {
+        options.CheckIsBoolean("wl",true,"16-bit payload length mode parameter is invalid");
+        config.Set16BitLengthEnabled(options.GetBoolean("wl"));
+    }
+    else if(handshake && (hello.features&PKG_FEAT_LEN16))
+    {
+        //wider command header is only worth it if port payload may exceed 255 bytes,
+        //mode is enabled first, because payload limit and package size are calculated for the current command header
+        config.Set16BitLengthEnabled(true);
+        const bool len16Useful=config.GetPortPayloadMaxSz()>255 && config.GetNetPackageSz()<=MAX_PACKAGE_SIZE_LEN16;
+        if(!len16Useful)
+            config.Set16BitLengthEnabled(false);
+    }
+
+    if(options.CheckParamPresent("cr",false,""))
+    {
+        options.CheckIsBoolean("cr",true,"Remote buffer credits mode parameter is invalid");
+        config.SetCreditsEnabled(options.GetBoolean("cr"));
+    }
+    else if(handshake)
+        config.SetCreditsEnabled(hello.features&PKG_FEAT_CREDITS);
+
+    if(options.CheckParamPresent("nak",false,""))
+    {
+        options.CheckIsBoolean("nak",true,"UDP retransmission mode parameter is invalid");
+        config.SetNackEnabled(options.GetBoolean("nak"));
+    }
+    else if(handshake)
+        config.SetNackEnabled(config.GetUDPEnabled() && (hello.features&PKG_FEAT_NACK));
+
+    //not selected automatically, parity packages take extra 1/N of UDP bandwidth in both directions
+    if(options.CheckParamPresent("fec",false,""))
+    {
+        options.CheckIsInteger("fec",0,FEC_GROUP_MAX,true,"UDP forward error correction group size is invalid");
+        config.SetFECGroupSize(options.GetInteger("fec"));
+    }
+
+    //not selected automatically, every package takes network bandwidth twice
+    if(options.CheckParamPresent("dp",false,""))
+    {
+        options.CheckIsBoolean("dp",true,"Dual path mode parameter is invalid");
+        config.SetDualPathEnabled(options.GetBoolean("dp"));
+    }
+
+    if(options.CheckParamPresent("ap",false,""))
+    {
+        options.CheckIsBoolean("ap",true,"Automatic path selection parameter is invalid");
+        config.SetAutoPathEnabled(options.GetBoolean("ap"));
+    }
+
+    if(options.CheckParamPresent("apl",false,""))
+    {
+        options.CheckIsInteger("apl",1,100,true,"Automatic path selection loss threshold is invalid");
+        config.SetAutoPathLossPercent(options.GetInteger("apl"));
+    }
+
+    if(options.CheckParamPresent("apr",false,""))
+    {
+        options.CheckIsInteger("apr",0,10000,true,"Automatic path selection round-trip time threshold is invalid");
+        config.SetAutoPathRTTMS(options.GetInteger("apr"));
+    }
+
+    if(handshake && (config.GetPackageFeatures()&~hello.features)!=0)
+        return param_error(argv[0],"Selected package format features are not supported by remote side");
+    //remote side uses legacy package format with client that does not request hello
+    if(!handshake && config.GetPackageFeatures()!=0)
+        return param_error(argv[0],"Package format features require handshake with remote side, use -hs 1");
+    if(config.GetDualPathEnabled() && !config.GetUDPEnabled())
+        return param_error(argv[0],"Dual path mode requires UDP transport, use -up 1");
+    if(config.GetAutoPathEnabled() && !config.GetUDPEnabled())
+        return param_error(argv[0],"Automatic path selection requires UDP transport, use -up 1");
+    //data already goes via both paths
+    if(config.GetAutoPathEnabled() && config.GetDualPathEnabled())
+        return param_error(argv[0],"Automatic path selection cannot be used with dual path mode");
+    if(!config.Get16BitLengthEnabled() && config.GetPortPayloadSz()>255)
+        return param_error(argv[0],"Network payload size over 255 bytes requires 16-bit payload lengths");
+    //larger frames are only useful while they are not fragmented
+    if(config.Get16BitLengthEnabled() && config.GetNetPackageSz()>MAX_PACKAGE_SIZE_LEN16)
+        return param_error(argv[0],"Network package size with 16-bit payload lengths must not exceed "+std::to_string(MAX_PACKAGE_SIZE_LEN16)+" bytes, reduce -pls or -pc");
+
     ImmutableStorage<IPAddress> localAddr(IPAddress("127.0.0.1"));
     if(options.CheckParamPresent("la",false,""))
     {
@@ -140,11 +441,80 @@ int main (int argc, char *argv[])
         config.SetRemotePollIntervalUS(options.GetInteger("ptr"));
     }
 
+    if(options.CheckParamPresent("lrs",false,""))
+    {
+        options.CheckIsInteger("lrs",1,64*1024*1024,true,"Local ring-buffer size is invalid");
+        config.SetLocalRingBuffSize(options.GetInteger("lrs"));
+    }
+
+    if(options.CheckParamPresent("agm",false,""))
+    {
+        options.CheckIsInteger("agm",1,255,true,"Aggregate multiplier is invalid");
+        config.SetRemoteAggregateMultiplier(options.GetInteger("agm"));
+    }
+
+    if(options.CheckParamPresent("idl",false,""))
+    {
+        options.CheckIsInteger("idl",0,3600000,true,"Idle timeout is invalid");
+        config.SetIdleTimeoutMS(options.GetInteger("idl"));
+    }
+
+    bool useEventLoop=false;
+    if(options.CheckParamPresent("el",false,""))
+    {
+        options.CheckIsBoolean("el",true,"Event loop mode parameter is invalid");
+        useEventLoop=options.GetBoolean("el");
+    }
+
+    if(options.CheckParamPresent("io",false,""))
+    {
+        options.CheckIsBoolean("io",true,"io_uring mode parameter is invalid");
+        config.SetIOURingEnabled(options.GetBoolean("io"));
+    }
+
+    if(options.CheckParamPresent("tm",false,""))
+    {
+        options.CheckIsInteger("tm",0,3,true,"Timer mode is invalid");
+        config.SetTimerMode(static_cast<TimerMode>(options.GetInteger("tm")));
+    }
+
+    if(options.CheckParamPresent("tms",false,""))
+    {
+        options.CheckIsInteger("tms",0,1000000,true,"Timer busy-wait time is invalid");
+        config.SetTimerSpinUS(options.GetInteger("tms"));
+    }
+
+    int rtPolicy=SCHED_FIFO;
+    if(options.CheckParamPresent("rtp",false,""))
+    {
+        options.CheckIsBoolean("rtp",true,"Realtime scheduling policy parameter is invalid");
+        rtPolicy=options.GetBoolean("rtp")?SCHED_RR:SCHED_FIFO;
+    }
+
+    ThreadParams timerParams;
+    ThreadParams transportParams;
+    ThreadParams workerParams;
+    if(!ParseThreadParams(options,"rtt","cpt",rtPolicy,timerParams))
+        return param_error(argv[0],"Timer CPU affinity list is invalid");
+    if(!ParseThreadParams(options,"rtn","cpn",rtPolicy,transportParams))
+        return param_error(argv[0],"Transport CPU affinity list is invalid");
+    if(!ParseThreadParams(options,"rtw","cpw",rtPolicy,workerParams))
+        return param_error(argv[0],"Port worker CPU affinity list is invalid");
+
+    bool lockMemory=false;
+    if(options.CheckParamPresent("ml",false,""))
+    {
+        options.CheckIsBoolean("ml",true,"Memory locking parameter is invalid");
+        lockMemory=options.GetBoolean("ml");
+    }
+
     std::vector<int> localPorts;
     std::vector<std::string> localFiles;
     std::vector<int> uartSpeeds;
     std::vector<int> uartModes;
     std::vector<bool> rstFlags;
+    std::vector<int> weights;
+    std::vector<int> ioSizes;
     for(size_t i=0;i<static_cast<size_t>(config.GetPortCount());++i)
     {
         auto strIdx=std::to_string(i+1);
@@ -195,11 +565,27 @@ int main (int argc, char *argv[])
         }
         else
             rstFlags.push_back(false);
-    }
 
-    config.SetTCPBuffSz(65536);
-    config.SetServiceIntervalMS(500); //management interval
-    config.SetLingerSec(30); //linger
+        //pw - port weight
+        if(options.CheckParamPresent("pw"+strIdx,false,""))
+        {
+            options.CheckIsInteger("pw"+strIdx,1,255,true,"port weight is invalid!");
+            weights.push_back(options.GetInteger("pw"+strIdx));
+        }
+        else
+            weights.push_back(1);
+
+        //pio - uart io size per remote poll, must fit port's payload together with the rest of port open request
+        if(options.CheckParamPresent("pio"+strIdx,false,""))
+        {
+            options.CheckIsInteger("pio"+strIdx,1,config.GetPortPayloadSz(),true,"uart io size is invalid!");
+            if(config.GetPortPayloadMaxSz()<7)
+                return param_error(argv[0],"uart io size may be set only with network payload size of at least 7 bytes");
+            ioSizes.push_back(options.GetInteger("pio"+strIdx));
+        }
+        else
+            ioSizes.push_back(0);
+    }
 
     //timeout for main thread waiting for external signals
     const timespec sigTs={2,0};
@@ -212,15 +598,15 @@ int main (int argc, char *argv[])
                                static_cast<SerialMode>(uartModes[i]),
                                rstFlags[i],
                                IPEndpoint(localAddr.Get(),static_cast<uint16_t>(localPorts[i])),
-                               localFiles[i],i));
+                               localFiles[i],i,static_cast<uint8_t>(weights[i]),static_cast<uint16_t>(ioSizes[i])));
 
-    StdioLoggerFactory logFactory;
-    auto mainLogger=logFactory.CreateLogger("Main");
-    auto messageBrokerLogger=logFactory.CreateLogger("MSGBroker");
-    auto tcpTransportLogger=logFactory.CreateLogger("TCPTransport");
-    auto udpTransportLogger=logFactory.CreateLogger("UDPTransport");
-    auto timerLogger=logFactory.CreateLogger("PollTimer");
-    auto dpLogger=logFactory.CreateLogger("DataProcessor");
+    auto messageBrokerLogger=logFactory->CreateLogger("MSGBroker");
+    auto tcpTransportLogger=logFactory->CreateLogger("TCPTransport");
+    auto udpTransportLogger=logFactory->CreateLogger("UDPTransport");
+    auto timerLogger=logFactory->CreateLogger("PollTimer");
+    auto dpLogger=logFactory->CreateLogger("DataProcessor");
+    auto pathLogger=logFactory->CreateLogger("PathSelector");
+    auto eventLoopLogger=logFactory->CreateLogger("EventLoop");
 
     //configure the most essential stuff
     MessageBroker messageBroker(messageBrokerLogger);
@@ -232,13 +618,23 @@ int main (int argc, char *argv[])
     //create instances for main logic
 
     //TCP transport
-    TCPTransport tcpTransport(tcpTransportLogger,messageBroker,config);
+    //preallocated package buffers shared by data processor and transports
+    //UDP parity package is longer than the package it protects by it's header
+    PackagePool packagePool(static_cast<size_t>(config.GetNetPackageSz()+(config.GetFECGroupSize()>0?FEC_HDR_SIZE:0)),GetPackagePoolSize(config));
+
+    //data path selected from UDP path state, used only if enabled
+    PathSelector pathSelector(pathLogger,config);
+
+    TCPTransport tcpTransport(tcpTransportLogger,messageBroker,config,packagePool,pathSelector);
     messageBroker.AddSubscriber(tcpTransport);
 
     //UDP transport
-    UDPTransport udpTransport(udpTransportLogger,messageBroker,config);
+    UDPTransport udpTransport(udpTransportLogger,messageBroker,config,packagePool,pathSelector);
     messageBroker.AddSubscriber(udpTransport);
 
+    //Event loop, used only if enabled
+    EventLoop eventLoop(eventLoopLogger,messageBroker,config);
+
     //Port polling timer
     Timer pollTimer(timerLogger,messageBroker,config,ptl);
     messageBroker.AddSubscriber(pollTimer);
@@ -256,13 +652,13 @@ int main (int argc, char *argv[])
         if(!portConfigs[i].ptsListener.empty())
         {
             listenersCreated=true;
-            auto logger=logFactory.CreateLogger("PTYListener:"+std::to_string(i));
+            auto logger=logFactory->CreateLogger("PTYListener:"+std::to_string(i));
             ptyListeners.push_back(std::make_shared<PTYListener>(logger,messageBroker,config,portConfigs[i]));
         }
         else if(portConfigs[i].listener.address.isValid && portConfigs[i].listener.port>0)
         {
             listenersCreated=true;
-            auto logger=logFactory.CreateLogger("TCPListener:"+std::to_string(i));
+            auto logger=logFactory->CreateLogger("TCPListener:"+std::to_string(i));
             tcpListeners.push_back(std::make_shared<TCPListener>(logger,messageBroker,config,portConfigs[i]));
         }
         else
@@ -282,9 +678,9 @@ int main (int argc, char *argv[])
     std::vector<std::shared_ptr<RemoteBufferTracker>> buffTrackers;
     for(size_t i=0;i<portConfigs.size();++i)
     {
-        auto rTrackerLogger=logFactory.CreateLogger("BuffTracker:"+std::to_string(i));
+        auto rTrackerLogger=logFactory->CreateLogger("BuffTracker:"+std::to_string(i));
         auto rTracker=std::make_shared<RemoteBufferTracker>(rTrackerLogger,config,config.GetRemoteRingBuffSize());
-        auto portLogger=logFactory.CreateLogger("PortWorker:"+std::to_string(i));
+        auto portLogger=logFactory->CreateLogger("PortWorker:"+std::to_string(i));
         auto portWorker=std::make_shared<PortWorker>(portLogger,messageBroker,config,portConfigs[i],*(rTracker));
         messageBroker.AddSubscriber(portWorker);
         portWorkers.push_back(portWorker);
@@ -292,7 +688,7 @@ int main (int argc, char *argv[])
     }
 
     //Data processor
-    DataProcessor dataProcessor(dpLogger,messageBroker,config,portWorkers);
+    DataProcessor dataProcessor(dpLogger,messageBroker,config,portWorkers,packagePool,pathSelector);
     messageBroker.AddSubscriber(dataProcessor);
 
     //create sigset_t struct with signals
@@ -304,22 +700,78 @@ int main (int argc, char *argv[])
         return 1;
     }
 
-    auto outSpeed=static_cast<int>(1000000.0/static_cast<double>(ptl)*static_cast<double>(config.GetPortPayloadSz())*8.0);
-    auto inSpeed=static_cast<int>(1000000.0/static_cast<double>(config.GetRemotePollIntervalUS())*static_cast<double>(config.GetPortPayloadSz())*8.0);
+    auto outSpeed=static_cast<int>(1000000.0/static_cast<double>(ptl)*static_cast<double>(config.GetPortPayloadMaxSz())*8.0);
+    auto inSpeed=static_cast<int>(1000000.0/static_cast<double>(config.GetRemotePollIntervalUS())*static_cast<double>(config.GetPortPayloadMaxSz())*8.0);
 
     mainLogger->Info()<<"Maximum calculated TX speed: "<<outSpeed<<" bps";
     mainLogger->Info()<<"Maximum calculated RX speed: "<<inSpeed<<" bps";
+    if(config.GetPayloadCRCEnabled())
+        mainLogger->Info()<<"Payload CRC-32C implementation: "<<CRC32CImplName();
+
+    //all buffers are allocated at this point, lock them in memory before starting threads, this also prefaults them
+    if(lockMemory)
+    {
+        if(mlockall(MCL_CURRENT|MCL_FUTURE)!=0)
+            mainLogger->Warning()<<"Failed to lock memory: "<<strerror(errno);
+        else
+            mainLogger->Info()<<"All process memory is locked";
+    }
 
     //startup
-    for(auto &portWorker:portWorkers)
-        portWorker->Startup();
-    tcpTransport.Startup();
-    udpTransport.Startup();
-    pollTimer.Startup();
-    for(auto &listener:tcpListeners)
-        listener->Startup();
-    for(auto &listener:ptyListeners)
-        listener->Startup();
+    if(useEventLoop)
+    {
+        if(config.GetIOURingEnabled())
+            mainLogger->Warning()<<"io_uring mode is not used when running in event-loop mode";
+        bool attached=true;
+        for(auto &portWorker:portWorkers)
+            attached=attached && portWorker->Attach(eventLoop);
+        attached=attached && tcpTransport.Attach(eventLoop) && udpTransport.Attach(eventLoop) && pollTimer.Attach(eventLoop);
+        for(auto &listener:tcpListeners)
+            attached=attached && listener->Attach(eventLoop);
+        for(auto &listener:ptyListeners)
+            attached=attached && listener->Attach(eventLoop);
+        if(!attached)
+        {
+            mainLogger->Error()<<"Failed to setup event loop";
+            messageBroker.SendMessage(nullptr,ShutdownMessage(1));
+        }
+        else
+        {
+            eventLoop.Startup();
+            timerParams.name="event-loop";
+            ApplyThreadParams(mainLogger,eventLoop,timerParams);
+        }
+    }
+    else
+    {
+        for(size_t i=0;i<portWorkers.size();++i)
+        {
+            portWorkers[i]->Startup();
+            workerParams.name="port-worker-"+std::to_string(i);
+            ApplyThreadParams(mainLogger,*(portWorkers[i]),workerParams);
+        }
+        tcpTransport.Startup();
+        transportParams.name="tcp-transport";
+        ApplyThreadParams(mainLogger,tcpTransport,transportParams);
+        udpTransport.Startup();
+        //UDP transport thread exits right away if UDP is not used
+        transportParams.name="udp-transport";
+        if(config.GetUDPEnabled())
+            ApplyThreadParams(mainLogger,udpTransport,transportParams);
+        pollTimer.Startup();
+        timerParams.name="poll-timer";
+        ApplyThreadParams(mainLogger,pollTimer,timerParams);
+        for(size_t i=0;i<tcpListeners.size();++i)
+        {
+            tcpListeners[i]->Startup();
+            ApplyThreadParams(mainLogger,*(tcpListeners[i]),ThreadParams{"tcp-listener-"+std::to_string(i),SCHED_OTHER,0,{}});
+        }
+        for(size_t i=0;i<ptyListeners.size();++i)
+        {
+            ptyListeners[i]->Startup();
+            ApplyThreadParams(mainLogger,*(ptyListeners[i]),ThreadParams{"pty-listener-"+std::to_string(i),SCHED_OTHER,0,{}});
+        }
+    }
 
     //main loop, awaiting for signal
     while(true)
@@ -331,6 +783,11 @@ int main (int argc, char *argv[])
             mainLogger->Error()<<"Error while handling incoming signal: "<<strerror(error)<<std::endl;
             break;
         }
+        else if(signal==SIGUSR1)
+        {
+            messageBroker.SendMessage(nullptr,StatsMessage());
+            continue;
+        }
         else if(signal>0 && signal!=SIGUSR2 && signal!=SIGINT) //SIGUSR2 triggered by shutdownhandler to unblock sigtimedwait
         {
             mainLogger->Info()<< "Pending shutdown by receiving signal: "<<signal<<"->"<<strsignal(signal)<<std::endl;
@@ -347,6 +804,23 @@ int main (int argc, char *argv[])
         }
     }
 
+    if(useEventLoop)
+    {
+        //stop event loop thread first, so all components may be safely detached from the main thread
+        eventLoop.Shutdown();
+        for(auto &listener:tcpListeners)
+            listener->Detach();
+        for(auto &listener:ptyListeners)
+            listener->Detach();
+        pollTimer.Detach();
+        udpTransport.Detach();
+        tcpTransport.Detach();
+        for(auto &portWorker:portWorkers)
+            portWorker->Detach();
+        mainLogger->Info()<<"Clean shutdown"<<std::endl;
+        return 0;
+    }
+
     //request shutdown of background workers
     for(auto &listener:tcpListeners) //server TCP listeners will be shutdown first
         listener->RequestShutdown();
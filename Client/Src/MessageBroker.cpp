@@ -6,47 +6,58 @@
 #endif
 
 MessageBroker::MessageBroker(std::shared_ptr<ILogger>& _logger):
+    logger(_logger)
+{
 #ifdef NDEBUG
-    curSubs(std::set<IMessageSubscriber*>()),
+    auto empty=std::make_unique<const std::vector<IMessageSubscriber*>>();
+    for(auto &subs:curSubs)
+        subs.store(empty.get());
+    snapshots.push_back(std::move(empty));
 #endif
-    logger(_logger)
-{ }
+}
 
 #ifdef NDEBUG
 
+void MessageBroker::Publish(IMessageSubscriber* const subscriber)
+{
+    //opLock must be held by caller, memory allocation happens only here while adding subscribers
+    if(!subscribers.insert(subscriber).second)
+        return;
+    for(int msgType=0;msgType<MSG_TYPE_COUNT;++msgType)
+    {
+        if(!subscriber->ReadyForMessage(static_cast<MsgType>(msgType)))
+            continue;
+        auto subs=std::make_unique<std::vector<IMessageSubscriber*>>(*curSubs[msgType].load(std::memory_order_relaxed));
+        subs->push_back(subscriber);
+        curSubs[msgType].store(subs.get(),std::memory_order_release);
+        snapshots.push_back(std::move(subs));
+    }
+}
+
 void MessageBroker::AddSubscriber(IMessageSubscriber &subscriber)
 {
     const std::lock_guard<std::mutex> guard(opLock);
-    auto subs=curSubs.Get();
-    subs.insert(&subscriber);
-    curSubs.Set(subs);
+    Publish(&subscriber);
 }
 
 void MessageBroker::AddSubscriber(IMessageSubscriber * const subscriber)
 {
     const std::lock_guard<std::mutex> guard(opLock);
-    auto subs=curSubs.Get();
-    subs.insert(subscriber);
-    curSubs.Set(subs);
+    Publish(subscriber);
 }
 
 void MessageBroker::AddSubscriber(const std::shared_ptr<IMessageSubscriber> &subscriber)
 {
     const std::lock_guard<std::mutex> guard(opLock);
-    auto subs=curSubs.Get();
-    subs.insert(subscriber.get());
-    curSubs.Set(subs);
+    Publish(subscriber.get());
 }
 
 void MessageBroker::SendMessage(const void* const source, const IMessage& message)
 {
-    opLock.lock();
-    auto subs=curSubs.Get();
-    opLock.unlock();
-
-    for(const auto &subscriber: subs)
-        if(subscriber->ReadyForMessage(message.msgType))
-            subscriber->OnMessage(source,message);
+    //lock-free and allocation-free, snapshot for the message type is never modified after publishing
+    const auto subs=curSubs[message.msgType].load(std::memory_order_acquire);
+    for(const auto &subscriber: *subs)
+        subscriber->OnMessage(source,message);
 }
 
 #else
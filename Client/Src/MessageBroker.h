@@ -7,7 +7,8 @@
 #include "ILogger.h"
 
 #ifdef NDEBUG
-#include "ImmutableStorage.h"
+#include <atomic>
+#include <vector>
 #else
 #include <thread>
 #include <map>
@@ -22,7 +23,12 @@ class MessageBroker : public IMessageSender
     private:
         std::mutex opLock;
 #ifdef NDEBUG
-        ImmutableStorage<std::set<IMessageSubscriber*>> curSubs;
+        //precomputed subscribers per message type, published as immutable snapshots
+        std::set<IMessageSubscriber*> subscribers;
+        std::atomic<const std::vector<IMessageSubscriber*>*> curSubs[MSG_TYPE_COUNT];
+        //all published snapshots, kept until broker is destroyed, so senders never access released memory
+        std::vector<std::unique_ptr<const std::vector<IMessageSubscriber*>>> snapshots;
+        void Publish(IMessageSubscriber* const subscriber);
 #else
         std::set<IMessageSubscriber*> subscribers;
         std::map<std::thread::id,std::set<const void*>*> callers;
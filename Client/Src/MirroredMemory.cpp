@@ -0,0 +1,60 @@
+#include "MirroredMemory.h"
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+MirroredMemory::MirroredMemory(const size_t minSize)
+{
+    base=nullptr;
+    size=0;
+    const auto pageSz=static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const auto sz=(minSize+pageSz-1)/pageSz*pageSz;
+    if(sz<1)
+        return;
+
+    auto fd=memfd_create("DataBuffer",MFD_CLOEXEC);
+    if(fd<0)
+        return;
+    if(ftruncate(fd,static_cast<off_t>(sz))!=0)
+    {
+        close(fd);
+        return;
+    }
+
+    //reserve address space for both copies first, then map the same memfd at both halves
+    auto reserved=mmap(nullptr,sz*2,PROT_NONE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if(reserved==MAP_FAILED)
+    {
+        close(fd);
+        return;
+    }
+    auto first=static_cast<uint8_t*>(reserved);
+    if(mmap(first,sz,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_FIXED,fd,0)==MAP_FAILED ||
+       mmap(first+sz,sz,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_FIXED,fd,0)==MAP_FAILED)
+    {
+        munmap(reserved,sz*2);
+        close(fd);
+        return;
+    }
+
+    //mappings keep memfd alive
+    close(fd);
+    base=first;
+    size=sz;
+}
+
+MirroredMemory::~MirroredMemory()
+{
+    if(base!=nullptr)
+        munmap(base,size*2);
+}
+
+uint8_t* MirroredMemory::Get()
+{
+    return base;
+}
+
+size_t MirroredMemory::GetSize()
+{
+    return size;
+}
@@ -0,0 +1,22 @@
+#ifndef MIRROREDMEMORY_H
+#define MIRROREDMEMORY_H
+
+#include <cstdint>
+#include <cstddef>
+
+//memory region mapped twice back-to-back, so access at [base+i] and [base+size+i] points to the same byte
+//used to make ring-buffer regions always contiguous, size is rounded up to page size
+class MirroredMemory
+{
+    private:
+        uint8_t *base;
+        size_t size;
+    public:
+        MirroredMemory(const size_t minSize);
+        ~MirroredMemory();
+        //returns nullptr if mapping failed
+        uint8_t* Get();
+        size_t GetSize();
+};
+
+#endif // MIRROREDMEMORY_H
@@ -11,6 +11,7 @@
 #include <poll.h>
 #include <fcntl.h>
 #include <sys/inotify.h>
+#include <sys/epoll.h>
 
 class ShutdownMessage: public IShutdownMessage { public: ShutdownMessage(int _ec):IShutdownMessage(_ec){} };
 class PortOpenMessage: public IPortOpenMessage { public: PortOpenMessage(const size_t _id, std::shared_ptr<Connection> _client):IPortOpenMessage(_id, _client){} };
@@ -24,9 +25,13 @@ PTYListener::PTYListener(std::shared_ptr<ILogger> &_logger, IMessageSender &_sen
     shutdownPending.store(false);
     ptm=-1;
     pts=-1;
+    inoFd=-1;
+    inoWatchFd=-1;
+    openCount=0;
+    eventLoop=nullptr;
 }
 
-bool PTYListener::Startup()
+bool PTYListener::OpenPTY()
 {
     if(remoteConfig.ptsListener.empty()||remoteConfig.listener.port!=0)
     {
@@ -44,6 +49,13 @@ bool PTYListener::Startup()
     if(fcntl(ptm, F_SETFL, O_NONBLOCK) < 0)
         logger->Error()<<"Failed to set O_NONBLOCK option to ptm: "<<strerror(errno);
 
+    return true;
+}
+
+bool PTYListener::Startup()
+{
+    if(!OpenPTY())
+        return false;
     return WorkerBase::Startup();
 }
 
@@ -59,13 +71,13 @@ void PTYListener::HandleError(int ec, const std::string &message)
     sender.SendMessage(this,ShutdownMessage(ec));
 }
 
-void PTYListener::Worker()
+bool PTYListener::OpenListener()
 {
     auto ptrPTSName=ttyname(pts);
     if(ptrPTSName==nullptr)
     {
         HandleError(errno,"ttyname failed: ");
-        return;
+        return false;
     }
     std::string ptsName(ptrPTSName);
 
@@ -73,28 +85,28 @@ void PTYListener::Worker()
     if(close(pts)<0)
     {
         HandleError(errno,"Failed to close slave pty: ");
-        return;
+        return false;
     }
 
     //create inotify events
-    auto inoFd=inotify_init();
+    inoFd=inotify_init();
     if(inoFd<0)
     {
         HandleError(errno,"inotify_init failed: ");
-        return;
+        return false;
     }
 
     if(fcntl(inoFd, F_SETFL, O_NONBLOCK) < 0)
     {
         HandleError(errno,"fcntl for inoFd failed: ");
-        return;
+        return false;
     }
 
-    auto inoWatchFd=inotify_add_watch(inoFd,ptsName.c_str(),IN_OPEN|IN_CLOSE);
+    inoWatchFd=inotify_add_watch(inoFd,ptsName.c_str(),IN_OPEN|IN_CLOSE);
     if(inoWatchFd<0)
     {
         HandleError(errno,"inotify_add_watch failed: ");
-        return;
+        return false;
     }
 
     //create symlink, close ptm on error
@@ -102,15 +114,88 @@ void PTYListener::Worker()
     {
         close(ptm);
         HandleError(errno,"Failed to create symlink for slave pty: ");
-        return;
+        return false;
     }
 
     logger->Info()<<"Listening for incoming connection (PTY) at "<<remoteConfig.ptsListener<<" (PTS: "<<ptsName<<")"<<std::endl;
+    openCount=0;
+    return true;
+}
+
+bool PTYListener::ProcessEvents()
+{
+    //read all events awailable
+    while(true)
+    {
+        inotify_event event={};
+        if(read(inoFd,&event,sizeof(inotify_event))!=sizeof(inotify_event))
+        {
+            auto error=errno;
+            if(error!=EWOULDBLOCK)
+            {
+                HandleError(error,"Error reading inotify event: ");
+                return false;
+            }
+            else
+                break;
+        }
+        if((event.mask&IN_OPEN)!=0)
+            openCount++;
+        if((event.mask&IN_CLOSE)!=0)
+            openCount--;
+    }
+
+    if(openCount==1) //first client connected
+    {
+        logger->Info()<<"PTY client connected to "<<remoteConfig.ptsListener;
+        sender.SendMessage(this, PortOpenMessage(remoteConfig.portID,std::make_shared<PTYConnection>(ptm)));
+    }
+    else if(openCount==0) //last client disconnected
+    {
+        logger->Info()<<"PTY closed at "<<remoteConfig.ptsListener;
+        //nothing to do, should be processed
+    }
+    return true;
+}
+
+bool PTYListener::CloseListener()
+{
+    if(unlink(remoteConfig.ptsListener.c_str())!=0)
+    {
+        HandleError(errno,"Failed to remove PTY symlink: ");
+        return false;
+    }
+
+    if(inotify_rm_watch(inoFd,inoWatchFd)!=0)
+    {
+        HandleError(errno,"inotify_rm_watch failed: ");
+        return false;
+    }
+
+    if(close(inoFd)!=0)
+    {
+        HandleError(errno,"Failed to close inoFd: ");
+        return false;
+    }
+
+    if(close(ptm)!=0)
+    {
+        HandleError(errno,"Failed to close master PTY: ");
+        return false;
+    }
+
+    logger->Info()<<"Shuting down PTY listener"<<std::endl;
+    return true;
+}
+
+void PTYListener::Worker()
+{
+    if(!OpenListener())
+        return;
 
     pollfd lst={};
     lst.fd=inoFd;
     lst.events=POLLIN|POLLHUP;
-    int openCount=0;
 
     while(!shutdownPending)
     {
@@ -130,69 +215,42 @@ void PTYListener::Worker()
             HandleError("Error processing inotify watch: ");
             return;
         }
-        if((lst.revents&POLLIN)!=0)
-        {
-            //read all events awailable
-            while(true)
-            {
-                inotify_event event={};
-                if(read(inoFd,&event,sizeof(inotify_event))!=sizeof(inotify_event))
-                {
-                    auto error=errno;
-                    if(error!=EWOULDBLOCK)
-                    {
-                        HandleError(error,"Error reading inotify event: ");
-                        return;
-                    }
-                    else
-                        break;
-                }
-                if((event.mask&IN_OPEN)!=0)
-                    openCount++;
-                if((event.mask&IN_CLOSE)!=0)
-                    openCount--;
-            }
-        }
-        else
-            continue;
-
-        if(openCount==1) //first client connected
-        {
-            logger->Info()<<"PTY client connected to "<<remoteConfig.ptsListener;
-            sender.SendMessage(this, PortOpenMessage(remoteConfig.portID,std::make_shared<PTYConnection>(ptm)));
-        }
-        else if(openCount==0) //last client disconnected
-        {
-            logger->Info()<<"PTY closed at "<<remoteConfig.ptsListener;
-            //nothing to do, should be processed
-        }
+        if((lst.revents&POLLIN)!=0 && !ProcessEvents())
+            return;
     }
 
-    if(unlink(remoteConfig.ptsListener.c_str())!=0)
-    {
-        HandleError(errno,"Failed to remove PTY symlink: ");
-        return;
-    }
+    CloseListener();
+}
 
-    if(inotify_rm_watch(inoFd,inoWatchFd)!=0)
-    {
-        HandleError(errno,"inotify_rm_watch failed: ");
-        return;
-    }
+bool PTYListener::Attach(IEventLoop& loop)
+{
+    if(!OpenPTY() || !OpenListener())
+        return false;
+    if(!loop.AddFd(inoFd,EPOLLIN,this))
+        return false;
+    eventLoop=&loop;
+    return true;
+}
 
-    if(close(inoFd)!=0)
-    {
-        HandleError(errno,"Failed to close inoFd: ");
+void PTYListener::Detach()
+{
+    if(eventLoop==nullptr)
         return;
-    }
+    eventLoop->RemoveFd(inoFd);
+    eventLoop=nullptr;
+    CloseListener();
+}
 
-    if(close(ptm)!=0)
+void PTYListener::OnEvent(const int, const uint32_t events)
+{
+    if((events&(EPOLLHUP|EPOLLERR))!=0)
     {
-        HandleError(errno,"Failed to close master PTY: ");
+        HandleError("Error processing inotify watch: ");
+        eventLoop->RemoveFd(inoFd);
         return;
     }
-
-    logger->Info()<<"Shuting down PTY listener"<<std::endl;
+    if((events&EPOLLIN)!=0)
+        ProcessEvents();
 }
 
 void PTYListener::OnShutdown()
@@ -8,12 +8,13 @@
 #include "IMessageSender.h"
 #include "IMessageSubscriber.h"
 #include "IPEndpoint.h"
+#include "IEventLoop.h"
 
 #include <string>
 #include <atomic>
 #include <sys/time.h>
 
-class PTYListener final : public WorkerBase
+class PTYListener final : public WorkerBase, public IEventHandler
 {
     private:
         std::shared_ptr<ILogger> logger;
@@ -22,12 +23,24 @@ class PTYListener final : public WorkerBase
         const PortConfig &remoteConfig;
         std::atomic<bool> shutdownPending;
         int ptm, pts;
+        int inoFd, inoWatchFd;
+        int openCount;
+        IEventLoop* eventLoop;
         void HandleError(const std::string &message);
         void HandleError(int ec, const std::string &message);
+        bool OpenPTY();
+        bool OpenListener();
+        bool ProcessEvents();
+        bool CloseListener();
     public:
         PTYListener(std::shared_ptr<ILogger> &logger, IMessageSender &sender, const IConfig &config, const PortConfig &remoteConfig);
         //WorkerBase
         bool Startup() final;
+        //run listener inside event loop instead of separate thread
+        bool Attach(IEventLoop& loop);
+        void Detach();
+        //IEventHandler
+        void OnEvent(const int fd, const uint32_t events) final;
     protected:
         void Worker() final;
         void OnShutdown() final;
@@ -0,0 +1,130 @@
+#include "PackagePool.h"
+
+PackageHandle::PackageHandle()
+{
+    pool=nullptr;
+    index=0;
+    buffer=nullptr;
+}
+
+PackageHandle::PackageHandle(PackagePool * const _pool, const size_t _index, uint8_t * const _buffer)
+{
+    pool=_pool;
+    index=_index;
+    buffer=_buffer;
+}
+
+PackageHandle::PackageHandle(const PackageHandle& other)
+{
+    pool=other.pool;
+    index=other.index;
+    buffer=other.buffer;
+    if(pool!=nullptr)
+        pool->refs[index].fetch_add(1,std::memory_order_relaxed);
+}
+
+PackageHandle::PackageHandle(PackageHandle&& other) noexcept
+{
+    pool=other.pool;
+    index=other.index;
+    buffer=other.buffer;
+    other.pool=nullptr;
+    other.buffer=nullptr;
+}
+
+PackageHandle& PackageHandle::operator=(const PackageHandle& other)
+{
+    if(this==&other)
+        return *this;
+    if(other.pool!=nullptr)
+        other.pool->refs[other.index].fetch_add(1,std::memory_order_relaxed);
+    Release();
+    pool=other.pool;
+    index=other.index;
+    buffer=other.buffer;
+    return *this;
+}
+
+PackageHandle& PackageHandle::operator=(PackageHandle&& other) noexcept
+{
+    if(this==&other)
+        return *this;
+    Release();
+    pool=other.pool;
+    index=other.index;
+    buffer=other.buffer;
+    other.pool=nullptr;
+    other.buffer=nullptr;
+    return *this;
+}
+
+PackageHandle::~PackageHandle()
+{
+    Release();
+}
+
+void PackageHandle::Release()
+{
+    //buffer returns to the pool when last owner releases it
+    if(pool!=nullptr)
+        pool->refs[index].fetch_sub(1,std::memory_order_acq_rel);
+    pool=nullptr;
+    buffer=nullptr;
+}
+
+uint8_t* PackageHandle::Get() const
+{
+    return buffer;
+}
+
+bool PackageHandle::IsValid() const
+{
+    return buffer!=nullptr;
+}
+
+bool PackageHandle::IsUnique() const
+{
+    return pool!=nullptr && pool->refs[index].load(std::memory_order_acquire)==1;
+}
+
+PackagePool::PackagePool(const size_t _pkgSize, const size_t _count):
+    pkgSize(_pkgSize),
+    count(_count),
+    storage(std::make_unique<uint8_t[]>(_pkgSize*_count)),
+    refs(std::make_unique<std::atomic<uint32_t>[]>(_count))
+{
+    for(size_t i=0;i<count;++i)
+        refs[i].store(0);
+    nextHint.store(0);
+}
+
+PackageHandle PackagePool::Acquire()
+{
+    //start searching from the next buffer after previously acquired one, so free buffer is usually found at first attempt
+    const auto start=nextHint.load(std::memory_order_relaxed);
+    for(size_t i=0;i<count;++i)
+    {
+        const auto index=(start+i)%count;
+        uint32_t expected=0;
+        if(refs[index].compare_exchange_strong(expected,1,std::memory_order_acquire,std::memory_order_relaxed))
+        {
+            nextHint.store((index+1)%count,std::memory_order_relaxed);
+            return PackageHandle(this,index,storage.get()+index*pkgSize);
+        }
+    }
+    return PackageHandle();
+}
+
+size_t PackagePool::GetPackageSize()
+{
+    return pkgSize;
+}
+
+size_t PackagePool::GetUsedCount()
+{
+    size_t result=0;
+    for(size_t i=0;i<count;++i)
+        if(refs[i].load(std::memory_order_relaxed)>0)
+            ++result;
+    return result;
+}
@@ -0,0 +1,52 @@
+#ifndef PACKAGEPOOL_H
+#define PACKAGEPOOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+
+class PackagePool;
+
+//reference-counted ownership of single package buffer from PackagePool
+class PackageHandle
+{
+    private:
+        PackagePool *pool;
+        size_t index;
+        uint8_t *buffer;
+        void Release();
+    public:
+        PackageHandle();
+        PackageHandle(PackagePool * const pool, const size_t index, uint8_t * const buffer);
+        PackageHandle(const PackageHandle &other);
+        PackageHandle(PackageHandle &&other) noexcept;
+        PackageHandle& operator=(const PackageHandle &other);
+        PackageHandle& operator=(PackageHandle &&other) noexcept;
+        ~PackageHandle();
+        uint8_t* Get() const;
+        bool IsValid() const;
+        //true if there are no other owners, so buffer may be safely reused
+        bool IsUnique() const;
+};
+
+//preallocated lock-free pool of package buffers, no heap allocations after construction,
+//count must cover all packages that may be in use at the same time by data processor and transports
+class PackagePool
+{
+    friend class PackageHandle;
+    private:
+        const size_t pkgSize;
+        const size_t count;
+        std::unique_ptr<uint8_t[]> storage;
+        std::unique_ptr<std::atomic<uint32_t>[]> refs;
+        std::atomic<size_t> nextHint;
+    public:
+        PackagePool(const size_t pkgSize, const size_t count);
+        //returns invalid handle if all buffers are in use
+        PackageHandle Acquire();
+        size_t GetPackageSize();
+        size_t GetUsedCount();
+};
+
+#endif // PACKAGEPOOL_H
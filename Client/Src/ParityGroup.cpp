@@ -0,0 +1,133 @@
+#include "ParityGroup.h"
+#include "CRC8.h"
+#include "UARTEthernetBridge/protocol.h"
+
+#include <cstring>
+
+ParityEncoder::ParityEncoder(const size_t _groupSize, const size_t pkgSize):
+    groupSize(_groupSize),
+    data(pkgSize)
+{
+    Reset();
+}
+
+bool ParityEncoder::Add(const uint16_t seq, const uint8_t * const src, const size_t size)
+{
+    if(count<1)
+        firstSeq=seq;
+    for(size_t i=0;i<size;++i)
+        data[i]^=src[i];
+    if(size>dataSize)
+        dataSize=size;
+    sizeXor^=static_cast<uint16_t>(size);
+    return ++count>=groupSize;
+}
+
+size_t ParityEncoder::Write(uint8_t * const target)
+{
+    WriteParityHeader(target,firstSeq,sizeXor,static_cast<uint8_t>(count));
+    *(target+FEC_HDR_SIZE-1)=CRC8(target,FEC_HDR_SIZE-1);
+    std::memcpy(target+FEC_HDR_SIZE,data.data(),dataSize);
+    return FEC_HDR_SIZE+dataSize;
+}
+
+void ParityEncoder::Reset()
+{
+    std::fill(data.begin(),data.end(),0);
+    dataSize=0;
+    firstSeq=0;
+    sizeXor=0;
+    count=0;
+}
+
+ParityDecoder::ParityDecoder(const size_t pkgSize):
+    data(pkgSize)
+{
+    recoveredCount.store(0);
+    unrecoveredCount.store(0);
+    Reset();
+}
+
+size_t ParityDecoder::GetMissingCount() const
+{
+    return groupCount-static_cast<size_t>(__builtin_popcount(receivedMask));
+}
+
+void ParityDecoder::StartGroup(const uint16_t seq, const size_t count)
+{
+    std::fill(data.begin(),data.end(),0);
+    groupStart=seq;
+    groupCount=count;
+    receivedMask=0;
+    sizeXor=0;
+}
+
+void ParityDecoder::Add(const uint16_t seq, const uint8_t * const src, const size_t size)
+{
+    if(groupCount<1)
+        return;
+    auto distance=static_cast<uint16_t>(seq-groupStart);
+    //package of the group already passed
+    if(distance>=0x8000)
+        return;
+    //parity of the current group is lost or late, continue with the group of this package
+    if(distance>=groupCount)
+    {
+        if(receivedMask>0)
+            unrecoveredCount.fetch_add(GetMissingCount(),std::memory_order_relaxed);
+        StartGroup(static_cast<uint16_t>(groupStart+distance/groupCount*groupCount),groupCount);
+        distance=static_cast<uint16_t>(distance%groupCount);
+    }
+    if((receivedMask&(1u<<distance))!=0 || size>data.size())
+        return;
+    receivedMask=static_cast<uint16_t>(receivedMask|1u<<distance);
+    sizeXor^=static_cast<uint16_t>(size);
+    for(size_t i=0;i<size;++i)
+        data[i]^=src[i];
+}
+
+size_t ParityDecoder::Recover(const uint8_t * const parity, const size_t size, uint8_t * const target)
+{
+    if(!IsParityPackage(parity,static_cast<uint16_t>(size)) || *(parity+FEC_HDR_SIZE-1)!=CRC8(parity,FEC_HDR_SIZE-1))
+        return 0;
+    uint16_t firstSeq=0, parityXor=0;
+    const size_t count=ReadParityHeader(parity,firstSeq,parityXor);
+    if(count<1 || count>FEC_GROUP_MAX || size-FEC_HDR_SIZE>data.size())
+        return 0;
+    //late parity of the group already passed
+    if(groupCount>0 && static_cast<uint16_t>(firstSeq-groupStart)>=0x8000)
+        return 0;
+    size_t result=0;
+    if(groupCount>0 && firstSeq==groupStart && count==groupCount)
+    {
+        const auto missing=GetMissingCount();
+        const size_t pkgSize=sizeXor^parityXor;
+        if(missing==1 && pkgSize>0 && pkgSize<=size-FEC_HDR_SIZE)
+        {
+            for(size_t i=0;i<pkgSize;++i)
+                target[i]=parity[FEC_HDR_SIZE+i]^data[i];
+            recoveredCount.fetch_add(1,std::memory_order_relaxed);
+            result=pkgSize;
+        }
+        else if(missing>0)
+            unrecoveredCount.fetch_add(missing,std::memory_order_relaxed);
+    }
+    //next group is expected right after this one
+    StartGroup(static_cast<uint16_t>(firstSeq+count),count);
+    return result;
+}
+
+void ParityDecoder::Reset()
+{
+    StartGroup(0,0);
+}
+
+uint64_t ParityDecoder::GetRecoveredCount() const
+{
+    return recoveredCount.load(std::memory_order_relaxed);
+}
+
+uint64_t ParityDecoder::GetUnrecoveredCount() const
+{
+    return unrecoveredCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,53 @@
+#ifndef PARITYGROUP_H
+#define PARITYGROUP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+
+//XOR parity of groupSize sent UDP packages
+class ParityEncoder
+{
+    private:
+        const size_t groupSize;
+        std::vector<uint8_t> data;
+        size_t dataSize;
+        uint16_t firstSeq;
+        uint16_t sizeXor;
+        size_t count;
+    public:
+        ParityEncoder(const size_t groupSize, const size_t pkgSize);
+        //returns true when group is complete and parity package is ready
+        bool Add(const uint16_t seq, const uint8_t * const src, const size_t size);
+        //writes parity package, target must fit FEC_HDR_SIZE+pkgSize bytes, returns parity package size
+        size_t Write(uint8_t * const target);
+        void Reset();
+};
+
+//restores single lost package of the group from XOR parity of received ones,
+//group boundaries are learned from parity packages, so the group that follows every parity package is awaited
+class ParityDecoder
+{
+    private:
+        std::vector<uint8_t> data;
+        uint16_t groupStart;
+        uint16_t receivedMask;
+        uint16_t sizeXor;
+        size_t groupCount; //0 - group is not known yet
+        //statistics
+        std::atomic<uint64_t> recoveredCount;
+        std::atomic<uint64_t> unrecoveredCount;
+        size_t GetMissingCount() const;
+        void StartGroup(const uint16_t seq, const size_t count);
+    public:
+        ParityDecoder(const size_t pkgSize);
+        void Add(const uint16_t seq, const uint8_t * const src, const size_t size);
+        //restores missing package to target that must fit pkgSize bytes, returns size of restored package or 0
+        size_t Recover(const uint8_t * const parity, const size_t size, uint8_t * const target);
+        void Reset();
+        uint64_t GetRecoveredCount() const;
+        uint64_t GetUnrecoveredCount() const;
+};
+
+#endif // PARITYGROUP_H
@@ -0,0 +1,181 @@
+#include "PathSelector.h"
+#include "CRC8.h"
+#include "Command.h"
+
+PathSelector::PathSelector(std::shared_ptr<ILogger>& _logger, const IConfig& _config):
+    logger(_logger),
+    lossThreshold(static_cast<uint64_t>(_config.GetAutoPathLossPercent())),
+    rttThreshold(static_cast<uint64_t>(_config.GetAutoPathRTTMS())*1000),
+    startTime(std::chrono::steady_clock::now())
+{
+    useTCP.store(false);
+    resetPending.store(true);
+    probeTick=probeCount=goodRounds=0;
+    warmup=true;
+    tcpPending=false;
+    probeSeq=0;
+    lastRxCount=lastDropCount=0;
+    roundSeq.store(0);
+    echoCount.store(0);
+    rttSum.store(0);
+    udpMissing.store(0);
+    toTCPCount.store(0);
+    toUDPCount.store(0);
+    lastLoss.store(0);
+    lastRTT.store(0);
+}
+
+uint32_t PathSelector::GetTimestamp() const
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-startTime).count());
+}
+
+bool PathSelector::UseTCP() const
+{
+    return useTCP.load(std::memory_order_relaxed);
+}
+
+bool PathSelector::ProbeDue(const bool udpSettled)
+{
+    //new round is started with the first probe after reset
+    if(resetPending.exchange(false))
+    {
+        probeTick=probeCount=goodRounds=0;
+        warmup=true;
+        tcpPending=false;
+        roundSeq.store(probeSeq);
+        echoCount.store(0);
+        rttSum.store(0);
+    }
+    if(tcpPending && udpSettled)
+    {
+        tcpPending=false;
+        useTCP.store(true);
+        toTCPCount.fetch_add(1,std::memory_order_relaxed);
+    }
+    if(++probeTick<PATH_PROBE_INTERVAL)
+        return false;
+    probeTick=0;
+    return true;
+}
+
+void PathSelector::Evaluate(const uint64_t rxCount, const uint64_t dropCount)
+{
+    //late echoes of the previous round are not counted from now on
+    roundSeq.store(probeSeq);
+    const auto echoed=echoCount.exchange(0);
+    const auto rtt=rttSum.exchange(0);
+    const auto received=rxCount-lastRxCount;
+    const auto dropped=dropCount-lastDropCount;
+    lastRxCount=rxCount;
+    lastDropCount=dropCount;
+    //probes show raw loss of UDP path, data counters show loss left after retransmissions and parity,
+    //data counters are stopped while data goes via TCP, so probes alone are evaluated then
+    const auto probeLoss=(PATH_PROBE_ROUND-(echoed<PATH_PROBE_ROUND?echoed:PATH_PROBE_ROUND))*100/PATH_PROBE_ROUND;
+    const auto dataLoss=received+dropped>0?dropped*100/(received+dropped):0;
+    const auto loss=probeLoss>dataLoss?probeLoss:dataLoss;
+    const auto avgRTT=echoed>0?rtt/echoed:0;
+    lastLoss.store(loss,std::memory_order_relaxed);
+    lastRTT.store(avgRTT,std::memory_order_relaxed);
+    //first round after reset is not evaluated, echoes are delayed until new UDP connection is served by receiving thread
+    if(warmup)
+    {
+        warmup=false;
+        return;
+    }
+
+    const bool degraded=loss>lossThreshold || (rttThreshold>0 && avgRTT>rttThreshold);
+    const bool good=loss*2<=lossThreshold && (rttThreshold<1 || (echoed>0 && avgRTT*2<=rttThreshold));
+    if(!useTCP.load())
+    {
+        if(!degraded || tcpPending)
+            return;
+        tcpPending=true;
+        goodRounds=0;
+        logger->Warning()<<"UDP path degraded, moving data path to TCP, loss: "<<loss<<"%; round-trip time: "<<avgRTT<<" usec";
+        return;
+    }
+    goodRounds=good?goodRounds+1:0;
+    if(goodRounds<PATH_RECOVERY_ROUNDS)
+        return;
+    useTCP.store(false);
+    toUDPCount.fetch_add(1,std::memory_order_relaxed);
+    goodRounds=0;
+    logger->Info()<<"UDP path recovered, moving data path back to UDP, loss: "<<loss<<"%; round-trip time: "<<avgRTT<<" usec";
+}
+
+void PathSelector::WriteProbe(uint8_t * const target, const uint64_t rxCount, const uint64_t dropCount)
+{
+    if(probeCount>=PATH_PROBE_ROUND)
+    {
+        Evaluate(rxCount,dropCount);
+        probeCount=0;
+    }
+    else if(probeCount<1)
+    {
+        lastRxCount=rxCount;
+        lastDropCount=dropCount;
+    }
+    probeCount++;
+    WriteU16Value(probeSeq++,target);
+    const auto timestamp=GetTimestamp();
+    for(size_t i=0;i<4;++i)
+        target[2+i]=static_cast<uint8_t>(timestamp>>(8*i));
+    target[PROBE_MARKER_OFFSET]=PROBE_MARKER;
+    target[PROBE_SIZE-1]=CRC8(target,PROBE_SIZE-1);
+}
+
+bool PathSelector::OnProbeEcho(const uint8_t * const package, const size_t size)
+{
+    if(!IsProbePackage(package,static_cast<uint16_t>(size)) || package[PROBE_SIZE-1]!=CRC8(package,PROBE_SIZE-1))
+        return false;
+    //echo of the probe sent before the current round
+    const auto seq=static_cast<uint16_t>(package[0]|package[1]<<8);
+    if(static_cast<uint16_t>(seq-roundSeq.load())>=PATH_PROBE_ROUND)
+        return true;
+    uint32_t timestamp=0;
+    for(size_t i=0;i<4;++i)
+        timestamp|=static_cast<uint32_t>(package[2+i])<<(8*i);
+    rttSum.fetch_add(static_cast<uint32_t>(GetTimestamp()-timestamp),std::memory_order_relaxed);
+    echoCount.fetch_add(1,std::memory_order_relaxed);
+    return true;
+}
+
+void PathSelector::SetUDPMissing(const uint16_t seq, const uint8_t count)
+{
+    udpMissing.store(static_cast<uint32_t>(seq)<<8|count,std::memory_order_relaxed);
+}
+
+uint8_t PathSelector::GetUDPMissing(uint16_t &seq) const
+{
+    const auto value=udpMissing.load(std::memory_order_relaxed);
+    seq=static_cast<uint16_t>(value>>8);
+    return static_cast<uint8_t>(value&0xFF);
+}
+
+void PathSelector::Reset()
+{
+    useTCP.store(false);
+    resetPending.store(true);
+    udpMissing.store(0);
+}
+
+uint64_t PathSelector::GetSwitchToTCPCount() const
+{
+    return toTCPCount.load(std::memory_order_relaxed);
+}
+
+uint64_t PathSelector::GetSwitchToUDPCount() const
+{
+    return toUDPCount.load(std::memory_order_relaxed);
+}
+
+uint64_t PathSelector::GetLossPercent() const
+{
+    return lastLoss.load(std::memory_order_relaxed);
+}
+
+uint64_t PathSelector::GetRTTUS() const
+{
+    return lastRTT.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,75 @@
+#ifndef PATHSELECTOR_H
+#define PATHSELECTOR_H
+
+#include "IConfig.h"
+#include "ILogger.h"
+
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <atomic>
+
+//probe package is sent via UDP with every N-th outgoing package
+#define PATH_PROBE_INTERVAL 8
+//count of probes evaluated together, UDP data counters are evaluated at the same time
+#define PATH_PROBE_ROUND 16
+//count of good probe rounds in a row required to return data path to UDP
+#define PATH_RECOVERY_ROUNDS 3
+
+//selects UDP or TCP data path from loss and round-trip time of UDP path, measured with probe packages echoed by remote side,
+//data path moves to TCP after single degraded round, and returns to UDP only when loss and round-trip time stay below half of the thresholds,
+//move to TCP is delayed while UDP packages are held awaiting missing ones, so they are not overtaken by packages sent via TCP
+class PathSelector
+{
+    private:
+        std::shared_ptr<ILogger> logger;
+        const uint64_t lossThreshold;
+        const uint64_t rttThreshold;
+        const std::chrono::steady_clock::time_point startTime;
+        std::atomic<bool> useTCP;
+        std::atomic<bool> resetPending;
+        //current probe round, accessed only from sending thread
+        size_t probeTick;
+        size_t probeCount;
+        size_t goodRounds;
+        bool warmup;
+        bool tcpPending;
+        uint16_t probeSeq;
+        uint64_t lastRxCount;
+        uint64_t lastDropCount;
+        //echoed probes of the current round, updated from receiving thread
+        std::atomic<uint16_t> roundSeq;
+        std::atomic<uint64_t> echoCount;
+        std::atomic<uint64_t> rttSum;
+        //UDP packages sent before data path is moved to TCP and still awaited are requested via TCP, first seq and count packed
+        std::atomic<uint32_t> udpMissing;
+        //statistics
+        std::atomic<uint64_t> toTCPCount;
+        std::atomic<uint64_t> toUDPCount;
+        std::atomic<uint64_t> lastLoss;
+        std::atomic<uint64_t> lastRTT;
+        uint32_t GetTimestamp() const;
+        void Evaluate(const uint64_t rxCount, const uint64_t dropCount);
+    public:
+        PathSelector(std::shared_ptr<ILogger>& logger, const IConfig& config);
+        bool UseTCP() const;
+        //called for every outgoing package, returns true if probe must be sent with it,
+        //udpSettled - no UDP packages are held awaiting missing ones at both sides
+        bool ProbeDue(const bool udpSettled);
+        //writes probe package to target that must fit PROBE_SIZE bytes,
+        //previous round is evaluated with packages received and dropped by UDP transport before starting the new one
+        void WriteProbe(uint8_t * const target, const uint64_t rxCount, const uint64_t dropCount);
+        //returns false if package is not a valid probe
+        bool OnProbeEcho(const uint8_t * const package, const size_t size);
+        void SetUDPMissing(const uint16_t seq, const uint8_t count);
+        uint8_t GetUDPMissing(uint16_t &seq) const;
+        //data path returns to UDP on reconnect, because remote side starts UDP only with the port sent via TCP
+        void Reset();
+        uint64_t GetSwitchToTCPCount() const;
+        uint64_t GetSwitchToUDPCount() const;
+        uint64_t GetLossPercent() const;
+        uint64_t GetRTTUS() const;
+};
+
+#endif // PATHSELECTOR_H
@@ -43,8 +43,10 @@ struct PortConfig
         const IPEndpoint listener;
         const std::string ptsListener;
         const size_t portID;
-        PortConfig(const uint32_t _speed, const SerialMode _mode, const bool _resetOnConnect, const IPEndpoint& _listener, const std::string& _ptsSymlink, const size_t _portID):
-            speed(_speed), mode(_mode), resetOnConnect(_resetOnConnect), listener(_listener), ptsListener(_ptsSymlink), portID(_portID) {};
+        const uint8_t weight; //share of package payload space, used only when it is shared between ports
+        const uint16_t ioSize; //uart read and write size per remote poll, 0 - use PORT_IO_SIZE of the firmware
+        PortConfig(const uint32_t _speed, const SerialMode _mode, const bool _resetOnConnect, const IPEndpoint& _listener, const std::string& _ptsSymlink, const size_t _portID, const uint8_t _weight, const uint16_t _ioSize):
+            speed(_speed), mode(_mode), resetOnConnect(_resetOnConnect), listener(_listener), ptsListener(_ptsSymlink), portID(_portID), weight(_weight), ioSize(_ioSize) {};
 };
 
 #endif //REMOTE_CONFIG_H
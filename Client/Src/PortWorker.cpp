@@ -4,6 +4,20 @@
 #include <cerrno>
 #include <cstring>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+
+//remote side is asked to stop reading the uart when free space of local ring-buffer is less than this number of port payloads
+#define RX_PAUSE_MARGIN_PKGS 8
+
+static size_t GetRXRingBuffSize(const IConfig& config, const PortConfig& portConfig)
+{
+    if(config.GetLocalRingBufferSize()>0)
+        return static_cast<size_t>(config.GetLocalRingBufferSize());
+    return static_cast<size_t>(config.GetLocalRingBufferSec())*((portConfig.speed>8?portConfig.speed:8)/8);
+}
+
+class IdleStateMessage: public IIdleStateMessage { public: IdleStateMessage(const bool _idle):IIdleStateMessage(_idle){} };
 
 PortWorker::PortWorker(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config, const PortConfig& _portConfig, RemoteBufferTracker& _remoteBufferTracker):
     logger(_logger),
@@ -11,20 +25,31 @@ PortWorker::PortWorker(std::shared_ptr<ILogger>& _logger, IMessageSender& _sende
     config(_config),
     portConfig(_portConfig),
     remoteBufferTracker(_remoteBufferTracker),
-    rxRingBuff(static_cast<size_t>(_config.GetLocalRingBufferSec())*((_portConfig.speed>8?_portConfig.speed:8)/8))
+    rxRingBuff(GetRXRingBuffSize(_config,_portConfig),true)
 {
+    if(!rxRingBuff.IsMirrored())
+        logger->Warning()<<"Failed to setup mirrored RX ring-buffer, using regular one";
+    //margin covers data already sent or collected by the remote side when it receives the pause request
+    rxPauseMargin=static_cast<size_t>(config.GetPortPayloadMaxSz())*RX_PAUSE_MARGIN_PKGS;
+    if(rxPauseMargin>rxRingBuff.GetSize()/4)
+        rxPauseMargin=rxRingBuff.GetSize()/4;
+    rxPaused=false;
     shutdownPending.store(false);
     connected.store(false);
+    idle.store(false);
     openPending=true;
     client=nullptr;
     sessionId=0;
     resetPending=false;
     oldSessionPkgCount=0;
+    eventLoop=nullptr;
+    clientReadable=false;
+    clientWriteArmed=false;
 }
 
 bool PortWorker::ReadyForMessage(const MsgType msgType)
 {
-    return msgType==MSG_PORT_OPEN || msgType==MSG_CONNECTED;
+    return msgType==MSG_PORT_OPEN || msgType==MSG_CONNECTED || msgType==MSG_IDLE_STATE;
 }
 
 void PortWorker::OnMessage(const void* const, const IMessage& message)
@@ -33,6 +58,20 @@ void PortWorker::OnMessage(const void* const, const IMessage& message)
         OnPortOpen(static_cast<const IPortOpenMessage&>(message));
     if(message.msgType==MSG_CONNECTED)
         OnConnected(static_cast<const IConnectedMessage&>(message));
+    if(message.msgType==MSG_IDLE_STATE)
+    {
+        idle.store(static_cast<const IIdleStateMessage&>(message).idle);
+        //worker thread will start watching client on next wait
+        if(idle.load() && eventLoop==nullptr)
+            rxRingBuff.Wakeup();
+    }
+}
+
+void PortWorker::WakeupFromIdle()
+{
+    //clientLock must not be held by caller
+    if(idle.exchange(false))
+        sender.SendMessage(this,IdleStateMessage(false));
 }
 
 void PortWorker::OnConnected(const IConnectedMessage&)
@@ -45,15 +84,33 @@ void PortWorker::OnPortOpen(const IPortOpenMessage& message)
     //only process message from corresponding client connection
     if(message.id!=portConfig.portID)
         return;
-    std::lock_guard<std::mutex> clientGuard(clientLock);
+    {
+        std::lock_guard<std::mutex> clientGuard(clientLock);
+        SetupClient(message);
+    }
+    //reset request and client's first data should not wait for keepalive tick
+    WakeupFromIdle();
+}
+
+void PortWorker::SetupClient(const IPortOpenMessage& message)
+{
+    //clientLock must be held by caller
     //get rid of old client if it still not closed
     if(client!=nullptr)
     {
         logger->Info()<<"Disposing previous client connection, fd: "<<client->fd;
-        client->Dispose();
+        DisposeClient();
     }
     //setup new client
     client=message.connection;
+    if(eventLoop!=nullptr)
+    {
+        //edge-triggered, so readable flag is only dropped after reading less data than requested
+        clientReadable=true;
+        clientWriteArmed=false;
+        if(!eventLoop->AddFd(client->fd,EPOLLIN|EPOLLET,this))
+            DisposeClient();
+    }
     resetPending=portConfig.resetOnConnect;
     if(resetPending)
     {
@@ -61,13 +118,55 @@ void PortWorker::OnPortOpen(const IPortOpenMessage& message)
         if(sessionId>0x7F)
             sessionId=0x01;
         remoteBufferTracker.Reset();
-        std::lock_guard<std::mutex> ringBuffGuard(ringBuffLock);
         logger->Info()<<"Dumping RX ring-buffer contents";
-        rxRingBuff.Reset();
+        rxRingBuff.RequestReset();
     }
 }
 
-Request PortWorker::ProcessTX(uint32_t counter, uint8_t* txBuff)
+size_t PortWorker::GetTXDemand()
+{
+    if(!connected.load())
+        return 0;
+    if(openPending)
+        return GetOpenSize();
+    std::lock_guard<std::mutex> clientGuard(clientLock);
+    if(resetPending || client==nullptr || (eventLoop!=nullptr && !clientReadable))
+        return 0;
+    auto avail=remoteBufferTracker.GetAvailSpace();
+    int pending=0;
+    //use fair share if pending size is unknown, at least 1 byte is requested so client disconnect is still detected by ProcessTX
+    if(ioctl(client->fd,FIONREAD,&pending)!=0)
+        pending=config.GetPortPayloadSz();
+    else if(pending<1)
+        pending=1;
+    return static_cast<size_t>(pending)<avail?static_cast<size_t>(pending):avail;
+}
+
+size_t PortWorker::GetOpenSize() const
+{
+    //port speed, optionally followed by weight and io size
+    if(portConfig.ioSize>0)
+        return 7;
+    return config.GetSharedPayloadEnabled()?5:4;
+}
+
+bool PortWorker::IsRXPaused()
+{
+    //resume after there is twice the margin, so pause requests do not flip on every poll
+    const auto freeSz=rxRingBuff.GetSize()-rxRingBuff.UsedSize();
+    if(!rxPaused && freeSz<rxPauseMargin)
+        rxPaused=true;
+    else if(rxPaused && freeSz>=rxPauseMargin*2)
+        rxPaused=false;
+    return rxPaused;
+}
+
+uint8_t PortWorker::GetWeight() const
+{
+    return portConfig.weight;
+}
+
+Request PortWorker::ProcessTX(uint32_t counter, uint8_t* txBuff, const size_t maxSz)
 {
     //do not start processing until receiving first connect-confirmation
     if(!connected.load())
@@ -76,11 +175,19 @@ Request PortWorker::ProcessTX(uint32_t counter, uint8_t* txBuff)
     //port will be opened at first call
     if(openPending)
     {
+        //port weight and io size are sent after port speed, wait until there is enough space for all of them
+        const auto openSz=GetOpenSize();
+        if(openSz>4 && maxSz<openSz)
+            return Request{ReqType::NoCommand,0,0};
         openPending=false;
         //write port speed to txBuff;
         WriteU32Value(portConfig.speed,txBuff);
+        if(openSz>4)
+            txBuff[4]=portConfig.weight;
+        if(openSz>6)
+            WriteU16Value(portConfig.ioSize,txBuff+5);
         logger->Info()<<"Sending port open request, speed: "<<portConfig.speed<<"; mode: "<< static_cast<int>(portConfig.mode);
-        return Request{ReqType::Open,static_cast<uint8_t>(portConfig.mode),4};
+        return Request{ReqType::Open,static_cast<uint8_t>(portConfig.mode),static_cast<uint16_t>(openSz)};
     }
 
     //client operations must be interlocked, client's FD must be in non-blocking mode
@@ -96,7 +203,7 @@ Request PortWorker::ProcessTX(uint32_t counter, uint8_t* txBuff)
     //logger->Info()<<"Remote buffer fillup: "<<remoteBufferFillup;
 
     //calculate how much data we want to read from client
-    auto dataToRead=static_cast<size_t>(config.GetPortPayloadSz());
+    auto dataToRead=maxSz;
     if(dataToRead>remoteBufferTracker.GetAvailSpace())
         dataToRead=remoteBufferTracker.GetAvailSpace();
 
@@ -104,6 +211,10 @@ Request PortWorker::ProcessTX(uint32_t counter, uint8_t* txBuff)
     if(dataToRead<=0 || client==nullptr)
         return Request{ReqType::NoCommand,0,0};
 
+    //do not touch idle client when running inside event loop
+    if(eventLoop!=nullptr && !clientReadable)
+        return Request{ReqType::NoCommand,0,0};
+
     //poll data from client, client->fd must be marked nonblocking (O_NONBLOCK)
     auto dataRead=read(client->fd,txBuff,static_cast<size_t>(dataToRead));
     if(dataRead<=0)
@@ -115,15 +226,18 @@ Request PortWorker::ProcessTX(uint32_t counter, uint8_t* txBuff)
                 logger->Info()<<"Client disconnected while reading";
             else
                 logger->Info()<<"Client read failed, error: "<<strerror(error);
-            client->Dispose();
-            client=nullptr;
+            DisposeClient();
         }
+        clientReadable=false;
         return Request{ReqType::NoCommand,0,0};
     }
 
+    if(static_cast<size_t>(dataRead)<dataToRead)
+        clientReadable=false;
+
     //logger->Info()<<"Client bytes send: "<<dataRead;
     remoteBufferTracker.AddPackage(static_cast<size_t>(dataRead),counter);
-    return Request{ReqType::Data,0,static_cast<uint8_t>(dataRead)};
+    return Request{ReqType::Data,0,static_cast<uint16_t>(dataRead)};
 }
 
 void PortWorker::ProcessRX(const Response& response, const uint8_t* rxBuff)
@@ -131,7 +245,10 @@ void PortWorker::ProcessRX(const Response& response, const uint8_t* rxBuff)
     //client operations must be interlocked
     {
         std::lock_guard<std::mutex> clientGuard(clientLock);
-        remoteBufferTracker.ConfirmPackage(response.counter,(response.arg&0x80)!=0);
+        if(config.GetCreditsEnabled())
+            remoteBufferTracker.ConfirmPackage(response.counter,static_cast<size_t>(response.credits));
+        else
+            remoteBufferTracker.ConfirmPackage(response.counter,(response.arg&0x80)!=0);
         if(client==nullptr)
             return;
         if(sessionId!=(response.arg&0x7F))
@@ -149,25 +266,104 @@ void PortWorker::ProcessRX(const Response& response, const uint8_t* rxBuff)
 
     if(response.type==RespType::NoCommand)
         return;
-    //write data to ring-buffer
+    //write data to ring-buffer, worker thread is woken-up on commit only if it is sleeping
+    //with mirrored ring-buffer data is always written with a single copy
+    auto head=rxRingBuff.GetHead();
+    size_t szToWrite=response.plSz;
+    while (szToWrite>0 && head.maxSz>0)
     {
-        std::lock_guard<std::mutex> ringBuffGuard(ringBuffLock);
-        auto head=rxRingBuff.GetHead();
-        size_t szToWrite=response.plSz;
-        while (szToWrite>0 && head.maxSz>0)
+        auto sz=szToWrite>head.maxSz?head.maxSz:szToWrite;
+        memcpy(head.buffer,rxBuff+response.plSz-szToWrite,sz);
+        szToWrite-=sz;
+        rxRingBuff.CommitHead(head,sz);
+        //logger->Info()<<"Ring buffer bytes written: "<<sz;
+        head=rxRingBuff.GetHead();
+    }
+    if(szToWrite>0)
+        logger->Warning()<<"Ring buffer overrun detected, bytes lost: "<<szToWrite;
+    //write data to client directly when running inside event loop
+    if(eventLoop!=nullptr)
+        FlushRingBuffer();
+}
+
+void PortWorker::DisposeClient()
+{
+    //clientLock must be held by caller
+    if(client==nullptr)
+        return;
+    if(eventLoop!=nullptr)
+        eventLoop->RemoveFd(client->fd);
+    client->Dispose();
+    client=nullptr;
+    clientReadable=false;
+    clientWriteArmed=false;
+}
+
+void PortWorker::FlushRingBuffer()
+{
+    std::lock_guard<std::mutex> clientGuard(clientLock);
+    while(true)
+    {
+        auto tail=rxRingBuff.GetTail();
+        if(tail.maxSz<1)
+            break;
+        if(client==nullptr)
+        {
+            logger->Warning()<<"Write failed: client is not connected, bytes lost: "<<tail.maxSz;
+            rxRingBuff.CommitTail(tail,tail.maxSz);
+            continue;
+        }
+        auto dw=write(client->fd,tail.buffer,tail.maxSz);
+        if(dw<0)
         {
-            auto sz=szToWrite>head.maxSz?head.maxSz:szToWrite;
-            memcpy(head.buffer,rxBuff+response.plSz-szToWrite,sz);
-            szToWrite-=sz;
-            rxRingBuff.Commit(head,sz);
-            //logger->Info()<<"Ring buffer bytes written: "<<sz;
-            head=rxRingBuff.GetHead();
+            auto error=errno;
+            if(error==EINTR)
+                continue;
+            if(error==EWOULDBLOCK)
+            {
+                //wait for client to become writable
+                if(!clientWriteArmed && eventLoop->ModifyFd(client->fd,EPOLLIN|EPOLLOUT|EPOLLET))
+                    clientWriteArmed=true;
+                return;
+            }
+            logger->Warning()<<"Write failed, bytes lost: "<<tail.maxSz<<"; error: "<<strerror(error);
+            DisposeClient();
+            continue;
         }
-        if(szToWrite>0)
-            logger->Warning()<<"Ring buffer overrun detected, bytes lost: "<<szToWrite;
+        rxRingBuff.CommitTail(tail,static_cast<size_t>(dw));
     }
-    //signal worker to proceed
-    ringBuffTrigger.notify_one();
+    if(clientWriteArmed && eventLoop->ModifyFd(client->fd,EPOLLIN|EPOLLET))
+        clientWriteArmed=false;
+}
+
+bool PortWorker::Attach(IEventLoop& loop)
+{
+    eventLoop=&loop;
+    logger->Info()<<"PortWorker attached to event loop";
+    return true;
+}
+
+void PortWorker::Detach()
+{
+    std::lock_guard<std::mutex> clientGuard(clientLock);
+    if(client!=nullptr && eventLoop!=nullptr)
+        eventLoop->RemoveFd(client->fd);
+    eventLoop=nullptr;
+}
+
+void PortWorker::OnEvent(const int, const uint32_t events)
+{
+    //errors and hangups will be detected on next read attempt
+    if((events&(EPOLLIN|EPOLLHUP|EPOLLERR))!=0)
+    {
+        {
+            std::lock_guard<std::mutex> clientGuard(clientLock);
+            clientReadable=true;
+        }
+        WakeupFromIdle();
+    }
+    if((events&EPOLLOUT)!=0)
+        FlushRingBuffer();
 }
 
 void PortWorker::Worker()
@@ -176,12 +372,23 @@ void PortWorker::Worker()
     pollfd pfd={};
     while(!shutdownPending.load())
     {
-        std::unique_lock<std::mutex> lock(ringBuffLock);
-        while(rxRingBuff.UsedSize()<1 && !shutdownPending.load())
-            ringBuffTrigger.wait(lock);
+        //watch client for incoming data while idle
+        int watchFd=-1;
+        if(idle.load())
+        {
+            std::lock_guard<std::mutex> clientGuard(clientLock);
+            if(client!=nullptr)
+                watchFd=client->fd;
+        }
+        //sleep until producer commits new data, timeout used to check shutdown state
+        bool clientReady=false;
+        const bool dataReady=rxRingBuff.Wait(config.GetServiceIntervalMS(),watchFd,clientReady);
+        if(clientReady)
+            WakeupFromIdle();
+        if(!dataReady)
+            continue;
         auto tail=rxRingBuff.GetTail();
-        lock.unlock();
-        //just as precaution, may be triggered on shutdown
+        //may be triggered on shutdown, or after dropping buffer contents on reset
         if(tail.maxSz<1)
             continue;
         //get client
@@ -227,10 +434,7 @@ void PortWorker::Worker()
             std::this_thread::sleep_for(std::chrono::milliseconds(config.GetServiceIntervalMS()));
         }
         //free data that was read from ringBuffer
-        {
-            std::lock_guard<std::mutex> guard(ringBuffLock);
-            rxRingBuff.Commit(tail,szToWrite);
-        }
+        rxRingBuff.CommitTail(tail,szToWrite);
     }
     logger->Info()<<"PortWorker was shutdown";
 }
@@ -238,5 +442,5 @@ void PortWorker::Worker()
 void PortWorker::OnShutdown()
 {
     shutdownPending.store(true);
-    ringBuffTrigger.notify_one();
+    rxRingBuff.Wakeup();
 }
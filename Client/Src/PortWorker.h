@@ -9,15 +9,15 @@
 #include "PortConfig.h"
 #include "Command.h"
 #include "Connection.h"
-#include "DataBuffer.h"
+#include "SPSCDataBuffer.h"
 #include "RemoteBufferTracker.h"
+#include "IEventLoop.h"
 
 #include <memory>
 #include <atomic>
 #include <mutex>
-#include <condition_variable>
 
-class PortWorker :  public WorkerBase, public IMessageSubscriber
+class PortWorker :  public WorkerBase, public IMessageSubscriber, public IEventHandler
 {
     private:
         std::shared_ptr<ILogger> logger;
@@ -28,26 +28,48 @@ class PortWorker :  public WorkerBase, public IMessageSubscriber
     private:
         std::atomic<bool> shutdownPending;
         std::atomic<bool> connected;
+        //set while there is no data transfer, local client is watched for incoming data to wakeup the timer
+        std::atomic<bool> idle;
         bool openPending;
+        //used only by ProcessTX caller
+        bool rxPaused;
+        size_t rxPauseMargin;
         //params shared between OnPortOpen, ProcessTX, ProcessRX, and Worker threads
         std::mutex clientLock;
         std::shared_ptr<Connection> client;
         bool resetPending;
         uint8_t sessionId;
         int oldSessionPkgCount;
-        //ring buffer, shared between ProcessRX and Worker threads
-        std::mutex ringBuffLock;
-        DataBuffer rxRingBuff;
-        std::condition_variable ringBuffTrigger;
+        //lock-free ring buffer, ProcessRX is the only producer, Worker (or FlushRingBuffer inside event loop) is the only consumer
+        SPSCDataBuffer rxRingBuff;
+        //used only when running inside event loop
+        IEventLoop* eventLoop;
+        bool clientReadable;
+        bool clientWriteArmed;
+        void DisposeClient();
+        void FlushRingBuffer();
+        void WakeupFromIdle();
+        void SetupClient(const IPortOpenMessage& message);
+        size_t GetOpenSize() const;
     public:
         PortWorker(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config, const PortConfig& portConfig, RemoteBufferTracker& remoteBufferTracker);
-        Request ProcessTX(uint32_t counter, uint8_t * txBuff);
+        Request ProcessTX(uint32_t counter, uint8_t * txBuff, const size_t maxSz);
+        //bytes pending to be sent, used to share package payload space between ports
+        size_t GetTXDemand();
+        uint8_t GetWeight() const;
+        //local ring-buffer is almost full, so remote side should stop reading data from the uart
+        bool IsRXPaused();
         void ProcessRX(const Response& response, const uint8_t* rxBuff);
         //methods for ISubscriber
         bool ReadyForMessage(const MsgType msgType) final;
         void OnMessage(const void* const source, const IMessage& message) final;
         void OnPortOpen(const IPortOpenMessage& message);
         void OnConnected(const IConnectedMessage&);
+        //serve client connection from event loop instead of separate thread
+        bool Attach(IEventLoop& loop);
+        void Detach();
+        //IEventHandler
+        void OnEvent(const int fd, const uint32_t events) final;
     protected:
         //WorkerBase
         void Worker() final;
@@ -7,12 +7,24 @@ RemoteBufferTracker::RemoteBufferTracker(std::shared_ptr<ILogger>& _logger, cons
     bufferLimit(_bufferLimit)
 {
     isBlocked=false;
+    freeSpace=bufferLimit;
+    dataInFlight=0;
     //logger->Info()<<"Configured remote buffer size: "<<bufferLimit<<" bytes";
 }
 
 void RemoteBufferTracker::AddPackage(size_t size, uint32_t counter)
 {
     dataSent.push_back(RemoteBufferPkg{counter,size});
+    dataInFlight+=size;
+}
+
+void RemoteBufferTracker::Confirm(uint32_t refCounter)
+{
+    while (!dataSent.empty() && dataSent.front().counter<=refCounter)
+    {
+        dataInFlight-=dataSent.front().dataSize;
+        dataSent.pop_front();
+    }
 }
 
 void RemoteBufferTracker::ConfirmPackage(uint32_t refCounter, bool writeBlocked)
@@ -20,23 +32,27 @@ void RemoteBufferTracker::ConfirmPackage(uint32_t refCounter, bool writeBlocked)
     isBlocked=writeBlocked;
     //if(isBlocked)
     //    logger->Error()<<"Write blocked!";
-    while (!dataSent.empty() && dataSent.front().counter<=refCounter)
-        dataSent.pop_front();
+    Confirm(refCounter);
 }
 
-size_t RemoteBufferTracker::GetAvailSpace()
+void RemoteBufferTracker::ConfirmPackage(uint32_t refCounter, size_t credits)
 {
-    if(isBlocked)
-        return 0;
-    size_t totalSent=0;
-    for(const auto &pkg:dataSent)
-        totalSent+=pkg.dataSize;
-    if(totalSent>bufferLimit)
+    //configured buffer limit is still honored
+    freeSpace=credits<bufferLimit?credits:bufferLimit;
+    Confirm(refCounter);
+}
+
+size_t RemoteBufferTracker::GetAvailSpace() const
+{
+    if(isBlocked || dataInFlight>freeSpace)
         return 0;
-    return bufferLimit-totalSent;
+    return freeSpace-dataInFlight;
 }
 
 void RemoteBufferTracker::Reset()
 {
     dataSent.clear();
+    dataInFlight=0;
+    freeSpace=bufferLimit;
+    isBlocked=false;
 }
@@ -21,12 +21,19 @@ class RemoteBufferTracker
         const IConfig& config;
         const size_t bufferLimit;
         bool isBlocked;
+        //free space reported by remote side, or bufferLimit if remote side does not report it
+        size_t freeSpace;
+        //running total of data not yet confirmed by remote side
+        size_t dataInFlight;
         std::deque<RemoteBufferPkg> dataSent;
+        void Confirm(uint32_t refCounter);
     public:
         RemoteBufferTracker(std::shared_ptr<ILogger>& logger, const IConfig& config, const size_t bufferLimit);
         void AddPackage(size_t size, uint32_t counter);
         void ConfirmPackage(uint32_t refCounter, bool writeBlocked);
-        size_t GetAvailSpace();
+        //remote side reports exact free space of it's ring-buffer after processing all requests up to refCounter
+        void ConfirmPackage(uint32_t refCounter, size_t credits);
+        size_t GetAvailSpace() const;
         void Reset();
 };
 
@@ -0,0 +1,143 @@
+#include "ReorderWindow.h"
+
+ReorderWindow::ReorderWindow(const size_t _windowSize, const std::chrono::microseconds _holdTime):
+    windowSize(_windowSize),
+    holdTime(_holdTime),
+    slots(_windowSize+1)
+{
+    heldCount=0;
+    isSynced=false;
+    nextSeq=0;
+    reorderedCount.store(0);
+    lateCount.store(0);
+    lostCount.store(0);
+    missing.store(0);
+}
+
+ReorderSlot* ReorderWindow::FindNearest()
+{
+    ReorderSlot* result=nullptr;
+    for(auto &slot:slots)
+        if(slot.package.IsValid() && (result==nullptr || static_cast<uint16_t>(slot.seq-nextSeq)<static_cast<uint16_t>(result->seq-nextSeq)))
+            result=&slot;
+    return result;
+}
+
+void ReorderWindow::SetMissing(const uint16_t seq, const uint16_t count)
+{
+    missing.store(static_cast<uint32_t>(seq)<<8|(count>UINT8_MAX?UINT8_MAX:count),std::memory_order_relaxed);
+}
+
+uint8_t ReorderWindow::GetMissing(uint16_t &seq) const
+{
+    const auto value=missing.load(std::memory_order_relaxed);
+    seq=static_cast<uint16_t>(value>>8);
+    return static_cast<uint8_t>(value&0xFF);
+}
+
+bool ReorderWindow::Push(const uint16_t seq, const PackageHandle &package)
+{
+    //first package after reset defines the sequence
+    if(!isSynced)
+    {
+        isSynced=true;
+        nextSeq=seq;
+    }
+
+    //package is older than already delivered ones, or it's missing place was skipped
+    const auto distance=static_cast<uint16_t>(seq-nextSeq);
+    if(distance>=0x8000)
+    {
+        lateCount.fetch_add(1,std::memory_order_relaxed);
+        return false;
+    }
+
+    ReorderSlot* freeSlot=nullptr;
+    for(auto &slot:slots)
+    {
+        if(!slot.package.IsValid())
+            freeSlot=&slot;
+        else if(slot.seq==seq)
+        {
+            lateCount.fetch_add(1,std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    //should not happen, Pop releases packages until window is not overflowed
+    if(freeSlot==nullptr)
+    {
+        lostCount.fetch_add(1,std::memory_order_relaxed);
+        return false;
+    }
+
+    //missing package arrived after the ones already held
+    if(distance<1 && heldCount>0)
+        reorderedCount.fetch_add(1,std::memory_order_relaxed);
+    if(heldCount<1)
+        holdStart=std::chrono::steady_clock::now();
+    freeSlot->seq=seq;
+    freeSlot->package=package;
+    heldCount++;
+    return true;
+}
+
+PackageHandle ReorderWindow::Pop()
+{
+    auto slot=FindNearest();
+    if(slot==nullptr)
+    {
+        SetMissing(nextSeq,0);
+        return PackageHandle();
+    }
+
+    //wait for missing packages while window is not overflowed and hold time is not passed, then skip them
+    const auto distance=static_cast<uint16_t>(slot->seq-nextSeq);
+    if(distance>0)
+    {
+        if(heldCount<=windowSize && std::chrono::steady_clock::now()-holdStart<holdTime)
+        {
+            SetMissing(nextSeq,distance);
+            return PackageHandle();
+        }
+        lostCount.fetch_add(distance,std::memory_order_relaxed);
+    }
+
+    //hold time is counted from the moment when next missing package is awaited
+    nextSeq=static_cast<uint16_t>(slot->seq+1);
+    if(--heldCount>0)
+        holdStart=std::chrono::steady_clock::now();
+    return std::move(slot->package);
+}
+
+bool ReorderWindow::GetHoldDeadline(std::chrono::steady_clock::time_point &deadline) const
+{
+    if(heldCount<1)
+        return false;
+    deadline=holdStart+holdTime;
+    return true;
+}
+
+void ReorderWindow::Reset()
+{
+    for(auto &slot:slots)
+        slot.package=PackageHandle();
+    heldCount=0;
+    isSynced=false;
+    missing.store(0);
+}
+
+uint64_t ReorderWindow::GetReorderedCount() const
+{
+    return reorderedCount.load(std::memory_order_relaxed);
+}
+
+uint64_t ReorderWindow::GetLateCount() const
+{
+    return lateCount.load(std::memory_order_relaxed);
+}
+
+uint64_t ReorderWindow::GetLostCount() const
+{
+    return lostCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,55 @@
+#ifndef REORDERWINDOW_H
+#define REORDERWINDOW_H
+
+#include "PackagePool.h"
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <atomic>
+
+struct ReorderSlot
+{
+    uint16_t seq;
+    PackageHandle package;
+};
+
+//restores sequence order of incoming UDP packages, packages arrived ahead of missing ones are held for a while,
+//missing packages are considered lost when window is overflowed or hold time is passed
+class ReorderWindow
+{
+    private:
+        const size_t windowSize;
+        const std::chrono::microseconds holdTime;
+        //one extra slot for the package just pushed
+        std::vector<ReorderSlot> slots;
+        size_t heldCount;
+        std::chrono::steady_clock::time_point holdStart;
+        bool isSynced;
+        uint16_t nextSeq;
+        //statistics
+        std::atomic<uint64_t> reorderedCount;
+        std::atomic<uint64_t> lateCount;
+        std::atomic<uint64_t> lostCount;
+        //missing packages awaited right now, first seq and count packed for reading from other threads
+        std::atomic<uint32_t> missing;
+        ReorderSlot* FindNearest();
+        void SetMissing(const uint16_t seq, const uint16_t count);
+    public:
+        ReorderWindow(const size_t windowSize, const std::chrono::microseconds holdTime);
+        //returns false if package was dropped as late or duplicate
+        bool Push(const uint16_t seq, const PackageHandle &package);
+        //returns next package ready for delivery, or invalid handle if none
+        PackageHandle Pop();
+        //moment when packages held after Pop are released even if missing ones are not arrived, false if nothing is held
+        bool GetHoldDeadline(std::chrono::steady_clock::time_point &deadline) const;
+        //drop held packages, sequence is synced again with next package
+        void Reset();
+        //count of missing packages starting from seq, 0 - nothing is awaited
+        uint8_t GetMissing(uint16_t &seq) const;
+        uint64_t GetReorderedCount() const;
+        uint64_t GetLateCount() const;
+        uint64_t GetLostCount() const;
+};
+
+#endif // REORDERWINDOW_H
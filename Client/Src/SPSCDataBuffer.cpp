@@ -0,0 +1,129 @@
+#include "SPSCDataBuffer.h"
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+SPSCDataBuffer::SPSCDataBuffer(size_t _size, bool useMirror):
+    mirror(useMirror?_size:0),
+    storage(mirror.Get()==nullptr?std::make_unique<uint8_t[]>(_size):nullptr),
+    mirrored(mirror.Get()!=nullptr),
+    size(mirrored?mirror.GetSize():_size),
+    begin(mirrored?mirror.Get():storage.get())
+{
+    //if eventfd is not available, Wait will degrade to polling with timeout
+    wakeFd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    head.store(0);
+    tail.store(0);
+    consumerSleeping.store(false);
+    resetPending.store(false);
+}
+
+SPSCDataBuffer::~SPSCDataBuffer()
+{
+    if(wakeFd>=0)
+        close(wakeFd);
+}
+
+size_t SPSCDataBuffer::GetSize()
+{
+    return size;
+}
+
+bool SPSCDataBuffer::IsMirrored()
+{
+    return mirrored;
+}
+
+Handle SPSCDataBuffer::GetHead()
+{
+    const auto h=head.load(std::memory_order_relaxed);
+    const auto t=tail.load(std::memory_order_acquire);
+    if(mirrored)
+        return Handle{begin+h,size-1-(h>=t?h-t:size-(t-h))};
+    Handle result={begin+h,h<t?t-h-1:size-h-(t>0?0:1)};
+    return result;
+}
+
+void SPSCDataBuffer::CommitHead(const Handle& handle, size_t usedSz)
+{
+    auto h=static_cast<size_t>(handle.buffer-begin)+usedSz;
+    if(h>=size)
+        h-=size;
+    //seq_cst store paired with consumerSleeping check, so wake-up cannot be missed
+    head.store(h);
+    if(consumerSleeping.load())
+        Wakeup();
+}
+
+Handle SPSCDataBuffer::GetTail()
+{
+    if(resetPending.exchange(false))
+        tail.store(head.load(std::memory_order_acquire),std::memory_order_release);
+    const auto t=tail.load(std::memory_order_relaxed);
+    const auto h=head.load(std::memory_order_acquire);
+    if(mirrored)
+        return Handle{begin+t,h>=t?h-t:size-(t-h)};
+    Handle result={begin+t,h>=t?h-t:size-t};
+    return result;
+}
+
+void SPSCDataBuffer::CommitTail(const Handle& handle, size_t usedSz)
+{
+    auto t=static_cast<size_t>(handle.buffer-begin)+usedSz;
+    if(t>=size)
+        t-=size;
+    tail.store(t,std::memory_order_release);
+}
+
+size_t SPSCDataBuffer::UsedSize()
+{
+    const auto t=tail.load(std::memory_order_acquire);
+    const auto h=head.load(std::memory_order_acquire);
+    return h>=t?h-t:size-(t-h);
+}
+
+bool SPSCDataBuffer::IsHalfUsed()
+{
+    return UsedSize()>(size/2);
+}
+
+bool SPSCDataBuffer::Wait(const int timeoutMs)
+{
+    bool watchFdReady=false;
+    return Wait(timeoutMs,-1,watchFdReady);
+}
+
+bool SPSCDataBuffer::Wait(const int timeoutMs, const int watchFd, bool &watchFdReady)
+{
+    watchFdReady=false;
+    if(UsedSize()>0)
+        return true;
+    //announce sleeping first and re-check, producer checks the flag after publishing new head
+    consumerSleeping.store(true);
+    if(UsedSize()<1)
+    {
+        pollfd pfd[2]={{wakeFd,POLLIN,0},{watchFd,POLLIN,0}};
+        if(poll(pfd,2,timeoutMs)>0)
+        {
+            uint64_t counter=0;
+            if((pfd[0].revents&POLLIN)!=0 && read(wakeFd,&counter,sizeof(counter))<0)
+                counter=0;
+            watchFdReady=pfd[1].revents!=0;
+        }
+    }
+    consumerSleeping.store(false);
+    return UsedSize()>0;
+}
+
+void SPSCDataBuffer::Wakeup()
+{
+    const uint64_t counter=1;
+    if(wakeFd>=0 && write(wakeFd,&counter,sizeof(counter))<0)
+        return;
+}
+
+void SPSCDataBuffer::RequestReset()
+{
+    resetPending.store(true);
+}
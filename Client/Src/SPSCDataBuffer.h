@@ -0,0 +1,56 @@
+#ifndef SPSCDATABUFFER_H
+#define SPSCDATABUFFER_H
+
+#include "DataBuffer.h"
+#include "MirroredMemory.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+
+#define CACHE_LINE_SIZE 64
+
+//wait-free variant of DataBuffer for exactly one producer thread and one consumer thread
+//producer uses GetHead/CommitHead, consumer uses GetTail/CommitTail/Wait
+//in mirrored mode storage is mapped twice, so head and tail handles always cover all free or used space
+class SPSCDataBuffer
+{
+    private:
+        MirroredMemory mirror;
+        std::unique_ptr<uint8_t[]> storage;
+        const bool mirrored;
+        const size_t size;
+        uint8_t * const begin;
+        int wakeFd;
+        //written only by producer
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+        //written only by consumer
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+        std::atomic<bool> consumerSleeping;
+        std::atomic<bool> resetPending;
+    public:
+        //size may be rounded up to page size in mirrored mode, regular storage used if mirroring is not available
+        SPSCDataBuffer(size_t size, bool useMirror);
+        ~SPSCDataBuffer();
+        size_t GetSize();
+        bool IsMirrored();
+        //producer
+        Handle GetHead();
+        void CommitHead(const Handle &handle, size_t usedSz);
+        //consumer
+        Handle GetTail();
+        void CommitTail(const Handle &handle, size_t usedSz);
+        size_t UsedSize();
+        bool IsHalfUsed();
+        //wait for data, consumer is only woken-up by producer while sleeping here
+        bool Wait(const int timeoutMs);
+        //same as above, also returns when watchFd becomes readable, watchFd is ignored if negative
+        bool Wait(const int timeoutMs, const int watchFd, bool &watchFdReady);
+        //wake-up sleeping consumer, may be called from any thread
+        void Wakeup();
+        //drop all buffered data, performed by consumer on next GetTail call, may be called from any thread
+        void RequestReset();
+};
+
+#endif // SPSCDATABUFFER_H
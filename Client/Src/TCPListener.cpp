@@ -11,6 +11,7 @@
 #include <netinet/tcp.h>
 #include <poll.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
 
 class ShutdownMessage: public IShutdownMessage { public: ShutdownMessage(int _ec):IShutdownMessage(_ec){} };
 class PortOpenMessage: public IPortOpenMessage { public: PortOpenMessage(const size_t _id, std::shared_ptr<Connection> _client):IPortOpenMessage(_id, _client){} };
@@ -22,6 +23,8 @@ TCPListener::TCPListener(std::shared_ptr<ILogger> &_logger, IMessageSender &_sen
     remoteConfig(_remoteConfig)
 {
     shutdownPending.store(false);
+    lSockFd=-1;
+    eventLoop=nullptr;
 }
 
 void TCPListener::HandleError(const std::string &message)
@@ -71,20 +74,20 @@ static void SetSocketCustomTimeouts(std::shared_ptr<ILogger> &logger, int fd, co
         logger->Warning()<<"Failed to set SO_SNDTIMEO option to socket: "<<strerror(errno);
 }
 
-void TCPListener::Worker()
-{ 
+bool TCPListener::OpenListenSocket()
+{
     if(!remoteConfig.listener.address.isValid||remoteConfig.listener.port==0)
     {
         HandleError("Listen IP address or port is invalid");
-        return;
+        return false;
     }
 
     //create listen socket
-    auto lSockFd=socket(remoteConfig.listener.address.isV6?AF_INET6:AF_INET,SOCK_STREAM,0);
+    lSockFd=socket(remoteConfig.listener.address.isV6?AF_INET6:AF_INET,SOCK_STREAM,0);
     if(lSockFd==-1)
     {
         HandleError(errno,"Failed to create listen socket: ");
-        return;
+        return false;
     }
 
     //tune some some options
@@ -92,14 +95,14 @@ void TCPListener::Worker()
     if (setsockopt(lSockFd, SOL_SOCKET, SO_REUSEADDR, &sockReuseAddrEnabled, sizeof(int))!=0)
     {
         HandleError(errno,"Failed to set SO_REUSEADDR option: ");
-        return;
+        return false;
     }
 #ifdef SO_REUSEPORT
     int sockReusePortEnabled=1;
     if (setsockopt(lSockFd, SOL_SOCKET, SO_REUSEPORT, &sockReusePortEnabled, sizeof(int))!=0)
     {
         HandleError(errno,"Failed to set SO_REUSEPORT option: ");
-        return;
+        return false;
     }
 #endif
 
@@ -107,7 +110,7 @@ void TCPListener::Worker()
     if (setsockopt(lSockFd, SOL_SOCKET, SO_LINGER, &lLinger, sizeof(linger))!=0)
     {
         HandleError(errno,"Failed to set SO_LINGER option: ");
-        return;
+        return false;
     }
 
     sockaddr_in ipv4Addr = {};
@@ -134,16 +137,53 @@ void TCPListener::Worker()
     if (bind(lSockFd,target,len)!=0)
     {
         HandleError(errno,"Failed to bind listen socket: ");
-        return;
+        return false;
     }
 
     if (listen(lSockFd,1)!=0)
     {
         HandleError(errno,"Failed to setup listen socket: ");
-        return;
+        return false;
     }
 
     logger->Info()<<"Listening for incoming connection (TCP) at "<<remoteConfig.listener<<std::endl;
+    return true;
+}
+
+bool TCPListener::CloseListenSocket()
+{
+    if(lSockFd<0)
+        return true;
+    auto result=close(lSockFd);
+    lSockFd=-1;
+    if(result!=0)
+    {
+        HandleError(errno,"Failed to close listen socket: ");
+        return false;
+    }
+    return true;
+}
+
+void TCPListener::AcceptClient()
+{
+    auto cSockFd=accept(lSockFd,nullptr,nullptr);
+    if(cSockFd<1)
+    {
+        logger->Warning()<<"Failed to accept connection: "<<strerror(errno)<<std::endl;
+        return;
+    }
+
+    TuneSocketBaseParams(logger,cSockFd,config);
+    SetSocketCustomTimeouts(logger,cSockFd,config.GetServiceIntervalTV());
+
+    logger->Info()<<"New TCP client connected, fd: "<<cSockFd;
+    sender.SendMessage(this, PortOpenMessage(remoteConfig.portID, std::make_shared<TCPConnection>(cSockFd,0)));
+}
+
+void TCPListener::Worker()
+{ 
+    if(!OpenListenSocket())
+        return;
 
     pollfd lst;
     lst.fd=lSockFd;
@@ -165,29 +205,41 @@ void TCPListener::Worker()
             return;
         }
 
-        auto cSockFd=accept(lSockFd,nullptr,nullptr);
-        if(cSockFd<1)
-        {
-            logger->Warning()<<"Failed to accept connection: "<<strerror(errno)<<std::endl;
-            continue;
-        }
-
-        TuneSocketBaseParams(logger,cSockFd,config);
-        SetSocketCustomTimeouts(logger,cSockFd,config.GetServiceIntervalTV());
-
-        logger->Info()<<"New TCP client connected, fd: "<<cSockFd;
-        sender.SendMessage(this, PortOpenMessage(remoteConfig.portID, std::make_shared<TCPConnection>(cSockFd,0)));
+        AcceptClient();
     }
 
-    if(close(lSockFd)!=0)
-    {
-        HandleError(errno,"Failed to close listen socket: ");
+    if(!CloseListenSocket())
         return;
-    }
 
     logger->Info()<<"Shuting down TCP listener"<<std::endl;
 }
 
+bool TCPListener::Attach(IEventLoop& loop)
+{
+    if(!OpenListenSocket())
+        return false;
+    if(fcntl(lSockFd, F_SETFL, O_NONBLOCK) < 0)
+        logger->Warning()<<"Failed to set O_NONBLOCK option to listen socket: "<<strerror(errno);
+    if(!loop.AddFd(lSockFd,EPOLLIN,this))
+        return false;
+    eventLoop=&loop;
+    return true;
+}
+
+void TCPListener::Detach()
+{
+    if(eventLoop!=nullptr)
+        eventLoop->RemoveFd(lSockFd);
+    eventLoop=nullptr;
+    if(CloseListenSocket())
+        logger->Info()<<"Shuting down TCP listener"<<std::endl;
+}
+
+void TCPListener::OnEvent(const int, const uint32_t)
+{
+    AcceptClient();
+}
+
 void TCPListener::OnShutdown()
 {
     shutdownPending.store(true);
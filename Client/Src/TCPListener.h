@@ -8,12 +8,13 @@
 #include "IMessageSender.h"
 #include "IMessageSubscriber.h"
 #include "IPEndpoint.h"
+#include "IEventLoop.h"
 
 #include <string>
 #include <atomic>
 #include <sys/time.h>
 
-class TCPListener final : public WorkerBase
+class TCPListener final : public WorkerBase, public IEventHandler
 {
     private:
         std::shared_ptr<ILogger> logger;
@@ -21,10 +22,20 @@ class TCPListener final : public WorkerBase
         const IConfig &config;
         const PortConfig &remoteConfig;
         std::atomic<bool> shutdownPending;
+        int lSockFd;
+        IEventLoop* eventLoop;
         void HandleError(const std::string& message);
         void HandleError(int ec, const std::string& message);
+        bool OpenListenSocket();
+        bool CloseListenSocket();
+        void AcceptClient();
     public:
         TCPListener(std::shared_ptr<ILogger> &logger, IMessageSender &sender, const IConfig &config,  const PortConfig &remoteConfig);
+        //run listener inside event loop instead of separate thread
+        bool Attach(IEventLoop& loop);
+        void Detach();
+        //IEventHandler
+        void OnEvent(const int fd, const uint32_t events) final;
     protected:
         //WorkerBase
         void Worker() final;
@@ -11,20 +11,41 @@
 #include <netinet/tcp.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 class ShutdownMessage: public IShutdownMessage { public: ShutdownMessage(int _ec):IShutdownMessage(_ec){} };
 class ConnectedMessage: public IConnectedMessage { public: ConnectedMessage(const uint16_t _udpPort):IConnectedMessage(_udpPort){} };
-class IncomingPackageMessage: public IIncomingPackageMessage { public: IncomingPackageMessage(const uint8_t* const _package):IIncomingPackageMessage(_package){} };
+class IncomingPackageMessage: public IIncomingPackageMessage { public: IncomingPackageMessage(const PackageHandle& _handle):IIncomingPackageMessage(true,_handle){} };
 
-TCPTransport::TCPTransport(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config):
+#define URING_RECV_TAG 1
+#define URING_TIMEOUT_TAG 2
+#define URING_CANCEL_TAG 3
+#define URING_SEND_CANCEL_TAG 4
+#define URING_ENTRIES 16
+
+TCPTransport::TCPTransport(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config, PackagePool& _packagePool, PathSelector& _pathSelector):
     logger(_logger),
     sender(_sender),
     config(_config),
-    rxBuff(std::make_unique<uint8_t[]>(static_cast<size_t>(config.GetNetPackageSz())))
+    packagePool(_packagePool),
+    pathSelector(_pathSelector),
+    uring(IOURING_SEND_SLOTS)
 {
     shutdownPending.store(false);
+    uringActive.store(false);
+    rxPkgCount.store(0);
+    txPkgCount.store(0);
+    syscallCount.store(0);
     remoteConn=nullptr;
     udpPort=49152;
+    eventLoop=nullptr;
+    timerFd=-1;
+    pendingFd=-1;
+    pendingHello=false;
+    helloSz=0;
+    rxPaused=false;
+    ResetRx();
 }
 
 static IPAddress Lookup(const std::string &target)
@@ -73,6 +94,111 @@ static void SetSocketCustomTimeouts(std::shared_ptr<ILogger> &logger, int fd, co
         logger->Warning()<<"Failed to set SO_SNDTIMEO option to socket: "<<strerror(errno);
 }
 
+static int Connect(const int fd, const IPAddress &target, const uint16_t port)
+{
+    if(target.isV6)
+    {
+        sockaddr_in6 v6sa={};
+        target.ToSA(&v6sa);
+        v6sa.sin6_port=htons(port);
+        return connect(fd,reinterpret_cast<sockaddr*>(&v6sa), sizeof(v6sa));
+    }
+    sockaddr_in v4sa={};
+    target.ToSA(&v4sa);
+    v4sa.sin_port=htons(port);
+    return connect(fd,reinterpret_cast<sockaddr*>(&v4sa), sizeof(v4sa));
+}
+
+//remote side with handshake support replies with hello, legacy firmware waits for the rest of the request
+static bool SendHelloRequest(const int fd, const int flags)
+{
+    uint8_t rawBuffer[HELLO_REQUEST_SIZE];
+    HelloRequest::Write(rawBuffer);
+    return send(fd,rawBuffer,HELLO_REQUEST_SIZE,MSG_NOSIGNAL|flags)==HELLO_REQUEST_SIZE;
+}
+
+//receive hello using socket's receive timeout, returns number of bytes received
+static size_t RecvHello(const int fd, uint8_t * const rawBuffer)
+{
+    size_t sz=0;
+    while(sz<HELLO_SIZE)
+    {
+        auto dr=recv(fd,rawBuffer+sz,HELLO_SIZE-sz,0);
+        if(dr<0 && errno==EINTR)
+            continue;
+        if(dr<=0)
+            break;
+        sz+=static_cast<size_t>(dr);
+    }
+    return sz;
+}
+
+ProbeResult TCPTransport::Probe(const IConfig &config, Hello &hello)
+{
+    ImmutableStorage<IPAddress> target(IPAddress(config.GetRemoteAddr()));
+    if(!target.Get().isValid)
+    {
+        target.Set(Lookup(config.GetRemoteAddr()));
+        if(!target.Get().isValid)
+            return ProbeResult::NoConnection;
+    }
+    auto fd=socket(target.Get().isV6?AF_INET6:AF_INET,SOCK_STREAM,0);
+    if(fd<0)
+        return ProbeResult::NoConnection;
+    auto tv=config.GetServiceIntervalTV();
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if(Connect(fd,target.Get(),config.GetTCPPort())<0)
+    {
+        close(fd);
+        return ProbeResult::NoConnection;
+    }
+    //legacy firmware sends nothing until it receives the whole first request
+    uint8_t rawBuffer[HELLO_SIZE];
+    auto sz=SendHelloRequest(fd,0)?RecvHello(fd,rawBuffer):0;
+    close(fd);
+    if(sz<1)
+        return ProbeResult::NoHello;
+    if(sz<HELLO_SIZE || !Hello::Map(rawBuffer,hello))
+        return ProbeResult::InvalidHello;
+    return ProbeResult::HelloReceived;
+}
+
+bool TCPTransport::Handshake(const int fd)
+{
+    uint8_t rawBuffer[HELLO_SIZE];
+    if(!SendHelloRequest(fd,0) || RecvHello(fd,rawBuffer)<HELLO_SIZE)
+    {
+        logger->Warning()<<"Failed to receive hello from remote side";
+        return false;
+    }
+    return AcceptHello(fd,rawBuffer);
+}
+
+bool TCPTransport::AcceptHello(const int fd, const uint8_t * const rawBuffer)
+{
+    Hello hello={};
+    if(!Hello::Map(rawBuffer,hello))
+    {
+        logger->Warning()<<"Failed to receive hello from remote side";
+        return false;
+    }
+    //remote side was reflashed with another configuration while we were running
+    const auto features=config.GetPackageFeatures();
+    if(hello.portCount!=config.GetPortCount() || hello.payloadSize!=config.GetPortPayloadSz() || (hello.features&features)!=features)
+    {
+        HandleError("Remote side configuration is changed, restart is required");
+        return false;
+    }
+    uint8_t selectBuffer[SELECT_SIZE];
+    Select::Write(Select{features},selectBuffer);
+    if(send(fd,selectBuffer,SELECT_SIZE,MSG_NOSIGNAL|MSG_DONTWAIT)!=SELECT_SIZE)
+    {
+        logger->Warning()<<"Failed to send package format selection to remote side: "<<strerror(errno);
+        return false;
+    }
+    return true;
+}
+
 void TCPTransport::HandleError(const std::string &message)
 {
     logger->Error()<<message<<std::endl;
@@ -85,87 +211,184 @@ void TCPTransport::HandleError(int ec, const std::string &message)
     sender.SendMessage(this,ShutdownMessage(ec));
 }
 
-std::shared_ptr<TCPConnection> TCPTransport::GetConnection()
+//connects socket created for remote address, socket type may include SOCK_NONBLOCK, returns -1 on failure
+int TCPTransport::CreateSocket(const int type)
 {
-    std::lock_guard<std::mutex> opGuard(remoteConnLock);
-    if(remoteConn!=nullptr && remoteConn->GetStatus())
-        return remoteConn;
-
-    if(remoteConn!=nullptr)
-        remoteConn->Dispose();
-
     ImmutableStorage<IPAddress> target(IPAddress(config.GetRemoteAddr()));
     if(!target.Get().isValid)
     {
         target.Set(Lookup(config.GetRemoteAddr()));
         if(!target.Get().isValid)
-        {
-            remoteConn=nullptr;
-            return nullptr;
-        }
+            return -1;
     }
 
     //create socket
-    auto fd=socket(target.Get().isV6?AF_INET6:AF_INET,SOCK_STREAM,0);
+    auto fd=socket(target.Get().isV6?AF_INET6:AF_INET,type,0);
     if(fd<0)
     {
         HandleError(errno,"Failed to create new socket: ");
-        {
-            remoteConn=nullptr;
-            return nullptr;
-        }
+        return -1;
     }
 
     TuneSocketBaseParams(logger,fd,config);
     SetSocketCustomTimeouts(logger,fd,config.GetServiceIntervalTV());
 
-    int cr=-1;
-    if(target.Get().isV6)
-    {
-        sockaddr_in6 v6sa={};
-        target.Get().ToSA(&v6sa);
-        v6sa.sin6_port=htons(config.GetTCPPort());
-        cr=connect(fd,reinterpret_cast<sockaddr*>(&v6sa), sizeof(v6sa));
-    }
-    else
+    auto cr=Connect(fd,target.Get(),config.GetTCPPort());
+    if(cr<0 && errno!=EINPROGRESS)
     {
-        sockaddr_in v4sa={};
-        target.Get().ToSA(&v4sa);
-        v4sa.sin_port=htons(config.GetTCPPort());
-        cr=connect(fd,reinterpret_cast<sockaddr*>(&v4sa), sizeof(v4sa));
+        auto error=errno;
+        if(close(fd)!=0)
+            HandleError(error,"Failed to perform proper socket close after connection failure: ");
+        return -1;
     }
+    return fd;
+}
+
+//returns current connection, new connection is established only if requested
+std::shared_ptr<TCPConnection> TCPTransport::GetConnection(const bool establish)
+{
+    std::lock_guard<std::mutex> opGuard(remoteConnLock);
+    if(remoteConn!=nullptr && remoteConn->GetStatus())
+        return remoteConn;
+
+    if(remoteConn!=nullptr)
+        DisposeConnection(remoteConn);
+    remoteConn=nullptr;
+    if(!establish)
+        return nullptr;
+
+    auto fd=CreateSocket(SOCK_STREAM);
+    if(fd<0)
+        return nullptr;
 
-    if(cr<0)
+    if(config.GetHandshakeEnabled() && !Handshake(fd))
     {
         auto error=errno;
         if(close(fd)!=0)
-        {
             HandleError(error,"Failed to perform proper socket close after connection failure: ");
-            {
-                remoteConn=nullptr;
-                return nullptr;
-            }
-        }
-        remoteConn=nullptr;
         return nullptr;
     }
+    return EstablishConnection(fd);
+}
 
+//must be called with remoteConnLock held
+std::shared_ptr<TCPConnection> TCPTransport::EstablishConnection(const int fd)
+{
     remoteConn=std::make_shared<TCPConnection>(fd,udpPort++);
     if(udpPort<49152)
         udpPort=49152;
 
     logger->Info()<<"Remote connection established";
+    if(eventLoop!=nullptr)
+    {
+        ResetRx();
+        rxPaused=false;
+        if(!eventLoop->AddFd(fd,EPOLLIN,this))
+        {
+            DisposeConnection(remoteConn);
+            remoteConn=nullptr;
+            return nullptr;
+        }
+    }
     sender.SendMessage(this, ConnectedMessage(remoteConn->GetUDPTransportPort()));
     return remoteConn;
 }
 
+void TCPTransport::StartConnect()
+{
+    pendingFd=CreateSocket(SOCK_STREAM|SOCK_NONBLOCK);
+    if(pendingFd<0)
+        return;
+    //connection is complete when socket becomes writable
+    pendingHello=false;
+    helloSz=0;
+    if(!eventLoop->AddFd(pendingFd,EPOLLOUT,this))
+    {
+        close(pendingFd);
+        pendingFd=-1;
+    }
+}
+
+void TCPTransport::AbortConnect()
+{
+    eventLoop->RemoveFd(pendingFd);
+    close(pendingFd);
+    pendingFd=-1;
+}
+
+void TCPTransport::OnPendingEvent(const uint32_t events)
+{
+    if(!pendingHello)
+    {
+        int error=0;
+        socklen_t errorLen=sizeof(error);
+        if((events&(EPOLLERR|EPOLLHUP))!=0 || getsockopt(pendingFd,SOL_SOCKET,SO_ERROR,&error,&errorLen)!=0 || error!=0)
+        {
+            AbortConnect();
+            return;
+        }
+        //hello is sent by remote side in reply to hello request
+        if(config.GetHandshakeEnabled())
+        {
+            pendingHello=SendHelloRequest(pendingFd,MSG_DONTWAIT) && eventLoop->ModifyFd(pendingFd,EPOLLIN);
+            if(!pendingHello)
+                AbortConnect();
+            return;
+        }
+    }
+    else
+    {
+        auto dr=recv(pendingFd,helloBuff+helloSz,HELLO_SIZE-helloSz,MSG_DONTWAIT);
+        if(dr<0 && (errno==EINTR || errno==EWOULDBLOCK))
+            return;
+        if(dr<=0)
+        {
+            logger->Warning()<<"Failed to receive hello from remote side";
+            AbortConnect();
+            return;
+        }
+        helloSz+=static_cast<size_t>(dr);
+        if(helloSz<HELLO_SIZE)
+            return;
+        if(!AcceptHello(pendingFd,helloBuff))
+        {
+            AbortConnect();
+            return;
+        }
+    }
+    //connected socket is used in blocking mode with timeouts, as with regular worker
+    const auto fd=pendingFd;
+    pendingFd=-1;
+    const auto flags=fcntl(fd,F_GETFL);
+    if(flags<0 || fcntl(fd,F_SETFL,flags&~O_NONBLOCK)!=0)
+    {
+        logger->Warning()<<"Failed to switch socket to blocking mode: "<<strerror(errno);
+        eventLoop->RemoveFd(fd);
+        close(fd);
+        return;
+    }
+    std::lock_guard<std::mutex> opGuard(remoteConnLock);
+    EstablishConnection(fd);
+}
+
 void TCPTransport::Worker()
 {
+    if(config.GetIOURingEnabled())
+    {
+        if(uring.Setup(URING_ENTRIES))
+        {
+            URingWorker();
+            return;
+        }
+        logger->Warning()<<"Failed to setup io_uring, falling back to regular socket operations: "<<strerror(errno);
+        uring.Dispose();
+    }
+
     logger->Info()<<"Trying to connect: "<<config.GetRemoteAddr()<<":"<<config.GetTCPPort();
     while(!shutdownPending.load())
     {
         //get connection
-        auto conn=GetConnection();
+        auto conn=GetConnection(true);
         if(conn==nullptr)
         {
             //wait for a while and try again
@@ -173,12 +396,18 @@ void TCPTransport::Worker()
             continue;
         }
 
-        const size_t pkgSz=static_cast<size_t>(config.GetNetPackageSz());
-        auto dataLeft=pkgSz;
+        //start receiving from the package boundary with every new connection
+        ResetRx();
         while(!shutdownPending.load())
         {
+            if(!PrepareRxPackage())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(config.GetServiceIntervalMS()));
+                continue;
+            }
             //read package
-            auto dr=recv(conn->fd,rxBuff.get()+pkgSz-dataLeft,dataLeft,MSG_WAITALL);
+            syscallCount.fetch_add(1,std::memory_order_relaxed);
+            auto dr=recv(conn->fd,rxPkg.Get()+rxPkgSz-rxDataLeft,rxDataLeft,MSG_WAITALL);
             if(dr<=0)
             {
                 auto error=errno;
@@ -190,28 +419,102 @@ void TCPTransport::Worker()
                 conn->Dispose();
                 break;
             }
-            if(static_cast<size_t>(dr)<dataLeft)
-                logger->Warning()<<"Partial recv detected: "<<dr<<" bytes; requested: "<<dataLeft<<" bytes";
-            dataLeft-=static_cast<size_t>(dr);
-            if(dataLeft>0)
+            if(static_cast<size_t>(dr)<rxDataLeft)
+                logger->Warning()<<"Partial recv detected: "<<dr<<" bytes; requested: "<<rxDataLeft<<" bytes";
+            rxDataLeft-=static_cast<size_t>(dr);
+            if(rxDataLeft>0)
                 continue;
-            //verify CRC, disconnect on failure and drop data
-            if(*(rxBuff.get()+config.GetNetPackageMetaSz())!=CRC8(rxBuff.get(),static_cast<size_t>(config.GetNetPackageMetaSz())))
+            //verify CRC and process package, disconnect on failure and drop data
+            if(!HandleRxChunk())
             {
-                logger->Error()<<"Package CRC mismatch! This should not happen normally, check your configuration!";
                 conn->Dispose();
                 break;
             }
-            //TODO: extra check for payloads size at metadata block, disconnect if too big
-            //logger->Info()<<"New TCP package received";
-            //signal new package received
-            sender.SendMessage(this, IncomingPackageMessage(rxBuff.get()));
-            dataLeft=pkgSz;
         }
     }
     logger->Info()<<"TCP transport-worker shuting down";
 }
 
+bool TCPTransport::PrepareRxPackage()
+{
+    //current package may be reused if it was not retained by any subscriber
+    if(rxPkg.IsUnique())
+        return true;
+    rxPkg=packagePool.Acquire();
+    if(!rxPkg.IsValid())
+        logger->Warning()<<"No free package buffers left for receiving";
+    return rxPkg.IsValid();
+}
+
+void TCPTransport::ResetRx()
+{
+    rxPkgSz=static_cast<size_t>(config.GetNetPackageHdrSz());
+    rxDataLeft=rxPkgSz;
+}
+
+bool TCPTransport::HandleRxChunk()
+{
+    //header of variable-length package received, continue with payload
+    if(rxPkgSz==static_cast<size_t>(config.GetNetPackageHdrSz()) && config.GetVariableLengthEnabled())
+    {
+        if(*(rxPkg.Get()+config.GetNetPackageMetaSz())!=CRC8(rxPkg.Get(),static_cast<size_t>(config.GetNetPackageMetaSz())))
+        {
+            logger->Error()<<"Package CRC mismatch! This should not happen normally, check your configuration!";
+            return false;
+        }
+        auto plSz=Response::PayloadSize(config.GetPortCount(),config.GetPackageFeatures(),config.GetPortPayloadMaxSz(),rxPkg.Get());
+        if(plSz<0)
+        {
+            logger->Error()<<"Package payload size is too big! This should not happen normally, check your configuration!";
+            return false;
+        }
+        if(plSz>0)
+        {
+            rxPkgSz+=static_cast<size_t>(plSz);
+            rxDataLeft=static_cast<size_t>(plSz);
+            return true;
+        }
+    }
+    auto result=HandleIncomingPackage();
+    ResetRx();
+    return result;
+}
+
+bool TCPTransport::HandleIncomingPackage()
+{
+    //verify CRC
+    if(*(rxPkg.Get()+config.GetNetPackageMetaSz())!=CRC8(rxPkg.Get(),static_cast<size_t>(config.GetNetPackageMetaSz())))
+    {
+        logger->Error()<<"Package CRC mismatch! This should not happen normally, check your configuration!";
+        return false;
+    }
+    //verify payload sizes at metadata block
+    if(!config.GetVariableLengthEnabled() && Response::PayloadSize(config.GetPortCount(),config.GetPackageFeatures(),config.GetPortPayloadMaxSz(),rxPkg.Get())<0)
+    {
+        logger->Error()<<"Package payload size is too big! This should not happen normally, check your configuration!";
+        return false;
+    }
+    //verify payload CRC
+    if(config.GetPayloadCRCEnabled() && !VerifyPayloadCRC(config.GetNetPackageMetaSz(),rxPkgSz,rxPkg.Get()))
+    {
+        logger->Error()<<"Package payload CRC mismatch! This should not happen normally, check your network!";
+        return false;
+    }
+    //logger->Info()<<"New TCP package received";
+    //signal new package received
+    rxPkgCount.fetch_add(1,std::memory_order_relaxed);
+    sender.SendMessage(this, IncomingPackageMessage(rxPkg));
+    return true;
+}
+
+void TCPTransport::DisposeConnection(const std::shared_ptr<TCPConnection>& conn)
+{
+    //fd must be removed from epoll set before it is closed, because it's number may be reused right after close
+    if(eventLoop!=nullptr && conn->GetStatus())
+        eventLoop->RemoveFd(conn->fd);
+    conn->Dispose();
+}
+
 void TCPTransport::OnSendPackage(const ISendPackageMessage& message)
 {
     if(!message.useTCP)
@@ -219,20 +522,48 @@ void TCPTransport::OnSendPackage(const ISendPackageMessage& message)
 
     //try to get connection
     auto txBuff=message.package;
-    auto conn=GetConnection();
+    //inside event loop new connection is established without blocking by timer, see StartConnect,
+    //with io_uring it is established by worker after sends queued for previous connection are finished
+    auto conn=GetConnection(eventLoop==nullptr && !uringActive.load());
     if(conn==nullptr)
         return;
-    //write UDP transport port to header and calculate CRC
-    if(config.GetUDPEnabled())
+    //outgoing packages are sent from event loop thread, subscribers may have released package buffers already
+    if(rxPaused && eventLoop!=nullptr && PrepareRxPackage())
+        rxPaused=!eventLoop->ModifyFd(conn->fd,EPOLLIN);
+    //write UDP transport port to header and calculate CRC, zero port moves remote responses to TCP along with the data path
+    const bool tcpPath=pathSelector.UseTCP();
+    if(config.GetUDPEnabled() && !tcpPath)
         WriteU16Value(conn->GetUDPTransportPort(),txBuff);
     else
         WriteU16Value(0,txBuff);
+    //UDP packages that was missing when data path moved to TCP are still requested
+    if(tcpPath && config.GetNackEnabled())
+    {
+        uint16_t missingSeq=0;
+        const auto missingCount=pathSelector.GetUDPMissing(missingSeq);
+        WriteNack(txBuff,static_cast<uint8_t>(config.GetPortCount()),config.GetPackageFeatures(),missingSeq,missingCount);
+    }
+    if(config.GetPayloadCRCEnabled())
+        WritePayloadCRC(config.GetNetPackageMetaSz(),message.size,txBuff);
     *(txBuff+config.GetNetPackageMetaSz())=CRC8(txBuff,static_cast<size_t>(config.GetNetPackageMetaSz()));
     //send package
-    const size_t pkgSz=static_cast<size_t>(config.GetNetPackageSz());
+    const size_t pkgSz=message.size;
+    txPkgCount.fetch_add(1,std::memory_order_relaxed);
+    if(uringActive.load())
+    {
+        //send slot keeps the package buffer until send is complete, sender waits for free slot as with blocking send
+        if(!uring.SendStream(conn->fd,message.handle,pkgSz,MSG_WAITALL|MSG_NOSIGNAL,std::chrono::milliseconds(config.GetServiceIntervalMS())))
+        {
+            if(conn->GetStatus() && !shutdownPending.load())
+                logger->Warning()<<"Failed to queue package for sending with io_uring, reconnecting";
+            conn->Dispose();
+        }
+        return;
+    }
     auto dataLeft=pkgSz;
     while(dataLeft>0)
     {
+        syscallCount.fetch_add(1,std::memory_order_relaxed);
         auto dw=send(conn->fd,txBuff+pkgSz-dataLeft,dataLeft,0);
         if(dw<=0)
         {
@@ -241,7 +572,7 @@ void TCPTransport::OnSendPackage(const ISendPackageMessage& message)
                 continue;
             if(!shutdownPending.load())
                 logger->Warning()<<"TCP send failed: "<<strerror(error);
-            conn->Dispose();
+            DisposeConnection(conn);
             return;
         }
         if(static_cast<size_t>(dw)<dataLeft)
@@ -250,15 +581,240 @@ void TCPTransport::OnSendPackage(const ISendPackageMessage& message)
     }
 }
 
+void TCPTransport::URingWorker()
+{
+    logger->Info()<<"Using io_uring backend";
+    logger->Info()<<"Trying to connect: "<<config.GetRemoteAddr()<<":"<<config.GetTCPPort();
+    const auto interval=config.GetServiceIntervalTV();
+    const __kernel_timespec timeout={interval.tv_sec,interval.tv_usec*1000};
+    uringActive.store(true);
+    bool timeoutArmed=false;
+    while(!shutdownPending.load())
+    {
+        //get connection
+        auto conn=GetConnection(true);
+        if(conn==nullptr)
+        {
+            //wait for a while and try again
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.GetServiceIntervalMS()));
+            continue;
+        }
+
+        //start receiving from the package boundary with every new connection
+        ResetRx();
+        uring.OpenStream();
+        bool recvArmed=false;
+        bool cancelArmed=false;
+        bool streamClosed=false;
+        //keep receive operation armed until connection is closed, new connection is not created until pending send is finished
+        while(!shutdownPending.load() && (recvArmed || conn->GetStatus() || uring.IsStreamBusy()))
+        {
+            if(!recvArmed && conn->GetStatus() && PrepareRxPackage())
+                recvArmed=uring.PrepareRecv(conn->fd,rxPkg.Get()+rxPkgSz-rxDataLeft,rxDataLeft,MSG_WAITALL,URING_RECV_TAG);
+            //connection was closed from other thread, pending receive operation must be cancelled
+            if(recvArmed && !cancelArmed && !conn->GetStatus())
+                cancelArmed=uring.PrepareCancel(URING_RECV_TAG,URING_CANCEL_TAG);
+            if(!streamClosed && !conn->GetStatus())
+                streamClosed=uring.CloseStream(URING_SEND_CANCEL_TAG);
+            //timeout used to check shutdown state periodically
+            if(!timeoutArmed)
+                timeoutArmed=uring.PrepareTimeout(&timeout,URING_TIMEOUT_TAG);
+            auto wr=uring.SubmitAndWait(1);
+            if(wr<0 && wr!=-EINTR && wr!=-ETIME && wr!=-EBUSY)
+            {
+                HandleError(-wr,"io_uring_enter failed: ");
+                uringActive.store(false);
+                uring.Dispose();
+                return;
+            }
+            uint64_t tag=0;
+            int result=0;
+            size_t requested=0;
+            while(uring.PopCompletion(tag,result,requested))
+            {
+                if(tag==URING_TIMEOUT_TAG)
+                    timeoutArmed=false;
+                else if(tag==URING_CANCEL_TAG)
+                    cancelArmed=false;
+                else if(tag==IOURING_SEND_TAG)
+                {
+                    //rest of the stream cannot be sent after failed or short send, connection is reset
+                    if(result>=0 && static_cast<size_t>(result)==requested)
+                        continue;
+                    if(!shutdownPending.load() && conn->GetStatus() && result!=-ECANCELED)
+                    {
+                        if(result<0)
+                            logger->Warning()<<"TCP send failed: "<<strerror(-result);
+                        else
+                            logger->Warning()<<"Partial send detected: "<<result<<" bytes; requested: "<<requested<<" bytes";
+                    }
+                    conn->Dispose();
+                }
+                else if(tag==URING_RECV_TAG)
+                {
+                    recvArmed=false;
+                    if(result==-EINTR || result==-EAGAIN)
+                        continue;
+                    if(result<=0)
+                    {
+                        //socket was closed or errored, close connection from our side and stop reading
+                        if(!shutdownPending.load() && result==0)
+                            logger->Warning()<<"TCP connection closed by remote";
+                        else if(!shutdownPending.load() && result!=-ECANCELED)
+                            logger->Warning()<<"TCP recv failed: "<<strerror(-result);
+                        conn->Dispose();
+                        continue;
+                    }
+                    rxDataLeft-=static_cast<size_t>(result);
+                    if(rxDataLeft>0)
+                        continue;
+                    //verify CRC and process package, disconnect on failure and drop data
+                    if(!HandleRxChunk())
+                        conn->Dispose();
+                }
+            }
+        }
+    }
+    uringActive.store(false);
+    uring.Dispose();
+    logger->Info()<<"TCP transport-worker shuting down";
+}
+
+void TCPTransport::OnStats()
+{
+    const auto rxCount=rxPkgCount.load(std::memory_order_relaxed);
+    const auto txCount=txPkgCount.load(std::memory_order_relaxed);
+    const auto sysCount=syscallCount.load(std::memory_order_relaxed)+uring.GetSyscallCount();
+    logger->Info()<<"Packages received: "<<rxCount<<"; packages sent: "<<txCount<<"; socket syscalls: "<<sysCount<<
+        "; syscalls per package: "<<(rxCount+txCount>0?static_cast<double>(sysCount)/static_cast<double>(rxCount+txCount):0.0);
+}
+
 bool TCPTransport::ReadyForMessage(const MsgType msgType)
 {
-    return msgType==MSG_SEND_PACKAGE;
+    return msgType==MSG_SEND_PACKAGE || msgType==MSG_STATS;
 }
 
 void TCPTransport::OnMessage(const void* const, const IMessage& message)
 {
     if(message.msgType==MSG_SEND_PACKAGE)
         OnSendPackage(static_cast<const ISendPackageMessage&>(message));
+    if(message.msgType==MSG_STATS)
+        OnStats();
+}
+
+bool TCPTransport::Attach(IEventLoop& loop)
+{
+    //timer used to establish connection to remote and reconnect on failures
+    timerFd=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+    if(timerFd<0)
+    {
+        logger->Error()<<"Failed to create timerfd: "<<strerror(errno);
+        return false;
+    }
+    const auto interval=config.GetServiceIntervalTV();
+    const itimerspec its={{interval.tv_sec,interval.tv_usec*1000},{0,1}};
+    if(timerfd_settime(timerFd,0,&its,nullptr)!=0)
+    {
+        logger->Error()<<"Failed to setup timerfd: "<<strerror(errno);
+        return false;
+    }
+    if(!loop.AddFd(timerFd,EPOLLIN,this))
+        return false;
+    eventLoop=&loop;
+    logger->Info()<<"Trying to connect: "<<config.GetRemoteAddr()<<":"<<config.GetTCPPort();
+    return true;
+}
+
+void TCPTransport::Detach()
+{
+    shutdownPending.store(true);
+    if(eventLoop!=nullptr)
+    {
+        std::lock_guard<std::mutex> opGuard(remoteConnLock);
+        eventLoop->RemoveFd(timerFd);
+        if(pendingFd>=0)
+            AbortConnect();
+        if(remoteConn!=nullptr)
+            DisposeConnection(remoteConn);
+        eventLoop=nullptr;
+    }
+    if(timerFd>=0)
+        close(timerFd);
+    timerFd=-1;
+    logger->Info()<<"TCP transport shuting down";
+}
+
+void TCPTransport::OnEvent(const int fd, const uint32_t events)
+{
+    if(fd==timerFd)
+    {
+        uint64_t expirations=0;
+        if(read(timerFd,&expirations,sizeof(expirations))!=sizeof(expirations) || shutdownPending.load())
+            return;
+        //connection or handshake was not completed within service interval
+        if(pendingFd>=0)
+        {
+            if(pendingHello)
+                logger->Warning()<<"Failed to receive hello from remote side";
+            AbortConnect();
+            return;
+        }
+        if(GetConnection(false)==nullptr)
+            StartConnect();
+        return;
+    }
+
+    if(fd==pendingFd)
+    {
+        OnPendingEvent(events);
+        return;
+    }
+
+    std::shared_ptr<TCPConnection> conn=nullptr;
+    {
+        std::lock_guard<std::mutex> opGuard(remoteConnLock);
+        conn=remoteConn;
+    }
+    if(conn==nullptr || conn->fd!=fd || !conn->GetStatus())
+        return;
+
+    //read all data available without blocking, package may be received in several parts
+    while(true)
+    {
+        //level-triggered fd stays readable, so it is disarmed until package buffers are released
+        if(!PrepareRxPackage())
+        {
+            rxPaused=eventLoop->ModifyFd(fd,0);
+            return;
+        }
+        syscallCount.fetch_add(1,std::memory_order_relaxed);
+        auto dr=recv(fd,rxPkg.Get()+rxPkgSz-rxDataLeft,rxDataLeft,MSG_DONTWAIT);
+        if(dr<0)
+        {
+            auto error=errno;
+            if(error==EINTR)
+                continue;
+            if(error==EWOULDBLOCK)
+                return;
+            logger->Warning()<<"TCP recv failed: "<<strerror(error);
+            DisposeConnection(conn);
+            return;
+        }
+        if(dr==0)
+        {
+            logger->Warning()<<"TCP connection closed by remote";
+            DisposeConnection(conn);
+            return;
+        }
+        rxDataLeft-=static_cast<size_t>(dr);
+        if(rxDataLeft>0)
+            continue;
+        if(!HandleRxChunk())
+        {
+            DisposeConnection(conn);
+            return;
+        }
+    }
 }
 
 void TCPTransport::OnShutdown()
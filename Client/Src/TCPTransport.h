@@ -7,34 +7,90 @@
 #include "ILogger.h"
 #include "IMessageSender.h"
 #include "IMessageSubscriber.h"
+#include "IEventLoop.h"
+#include "IOURing.h"
+#include "PathSelector.h"
+#include "Command.h"
 
 #include <memory>
 #include <cstdint>
 #include <atomic>
 
-class TCPTransport final : public WorkerBase, public IMessageSubscriber
+enum struct ProbeResult
+{
+    NoConnection,
+    NoHello,
+    HelloReceived,
+    InvalidHello,
+};
+
+class TCPTransport final : public WorkerBase, public IMessageSubscriber, public IEventHandler
 {
     private: //fields setup via constructor
         std::shared_ptr<ILogger> logger;
         IMessageSender& sender;
         const IConfig& config;
-        std::unique_ptr<uint8_t[]> rxBuff;
+        PackagePool& packagePool;
+        PathSelector& pathSelector;
     private:
+        //package currently being received, replaced with new one if previous package is still in use by subscribers
+        PackageHandle rxPkg;
         std::atomic<bool> shutdownPending;
         //remote connection with it's management lock
         std::mutex remoteConnLock;
         std::shared_ptr<TCPConnection> remoteConn;
         uint16_t udpPort;
+        //size of the package part expected so far, grows after receiving header of variable-length package
+        size_t rxPkgSz;
+        size_t rxDataLeft;
+        //used only when running inside event loop
+        IEventLoop* eventLoop;
+        int timerFd;
+        //connection being established without blocking event loop, aborted if not completed until the next timer tick
+        int pendingFd;
+        bool pendingHello;
+        size_t helloSz;
+        uint8_t helloBuff[HELLO_SIZE];
+        //receiving is paused while there are no free package buffers, resumed with the next outgoing package
+        bool rxPaused;
+        //io_uring backend, used only if enabled and supported
+        IOURing uring;
+        std::atomic<bool> uringActive;
+        //statistics
+        std::atomic<uint64_t> rxPkgCount;
+        std::atomic<uint64_t> txPkgCount;
+        std::atomic<uint64_t> syscallCount;
         //service methods
-        std::shared_ptr<TCPConnection> GetConnection();
+        std::shared_ptr<TCPConnection> GetConnection(const bool establish);
+        int CreateSocket(const int type);
+        std::shared_ptr<TCPConnection> EstablishConnection(const int fd);
+        bool Handshake(const int fd);
+        bool AcceptHello(const int fd, const uint8_t * const rawBuffer);
+        void StartConnect();
+        void AbortConnect();
+        void OnPendingEvent(const uint32_t events);
+        void DisposeConnection(const std::shared_ptr<TCPConnection>& conn);
+        bool PrepareRxPackage();
+        bool HandleIncomingPackage();
+        bool HandleRxChunk();
+        void ResetRx();
         void HandleError(const std::string& message);
         void HandleError(int ec, const std::string& message);
         void OnSendPackage(const ISendPackageMessage& message);
+        void OnStats();
+        void URingWorker();
     public:
-        TCPTransport(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config);
+        TCPTransport(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config, PackagePool& packagePool, PathSelector& pathSelector);
+        //connect to the remote side and read it's configuration, used on startup before transport is created
+        static ProbeResult Probe(const IConfig& config, Hello& hello);
         //methods for ISubscriber
         bool ReadyForMessage(const MsgType msgType) final;
         void OnMessage(const void* const source, const IMessage& message) final;
+        //run transport inside event loop instead of separate thread
+        bool Attach(IEventLoop& loop);
+        void Detach();
+        //IEventHandler
+        void OnEvent(const int fd, const uint32_t events) final;
     protected:
         //WorkerBase
         void Worker() final;
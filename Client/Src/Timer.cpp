@@ -1,8 +1,28 @@
 #include "Timer.h"
 #include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <ctime>
 
 class TimerMessage: public ITimerMessage { public: TimerMessage(uint32_t _counter):ITimerMessage(_counter){} };
 
+static int64_t MonotonicNowNs()
+{
+    timespec ts={};
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return static_cast<int64_t>(ts.tv_sec)*1000000000L+ts.tv_nsec;
+}
+
+static timespec ToTimespec(const int64_t ns)
+{
+    return timespec{static_cast<time_t>(ns/1000000000L),static_cast<long>(ns%1000000000L)};
+}
+
 Timer::Timer(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config, const int64_t _intervalUsec):
     logger(_logger),
     sender(_sender),
@@ -12,19 +32,134 @@ Timer::Timer(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const I
     shutdownPending.store(false);
     connectPending.store(true);
     eventCounter=0;
+    idle.store(false);
+    //if eventfd is not available, wakeup from idle state will be delayed until next keepalive tick
+    wakeFd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    eventLoop=nullptr;
+    timerFd=-1;
+    nextDeadlineNs=0;
+    curIntervalNs=reqIntervalUsec*1000;
+    tickCount.store(0);
+    missedCount.store(0);
+    latenessSumNs.store(0);
+    latenessMaxNs.store(0);
+    idleWakeupCount.store(0);
+}
+
+Timer::~Timer()
+{
+    if(wakeFd>=0)
+        close(wakeFd);
 }
 
 bool Timer::ReadyForMessage(const MsgType msgType)
 {
-    return msgType==MSG_CONNECTED;
+    return msgType==MSG_CONNECTED || msgType==MSG_STATS || msgType==MSG_IDLE_STATE;
+}
+
+void Timer::OnMessage(const void* const /*source*/, const IMessage& message)
+{
+    if(message.msgType==MSG_CONNECTED)
+        connectPending.store(false);
+    if(message.msgType==MSG_STATS)
+        OnStats();
+    if(message.msgType==MSG_IDLE_STATE)
+        OnIdleState(static_cast<const IIdleStateMessage&>(message));
+}
+
+void Timer::OnIdleState(const IIdleStateMessage& message)
+{
+    //may be sent more than once by different components
+    if(idle.exchange(message.idle)==message.idle)
+        return;
+    if(!message.idle)
+        idleWakeupCount.fetch_add(1,std::memory_order_relaxed);
+    //all components are running at the event loop thread, so timerfd may be re-armed right there
+    if(eventLoop!=nullptr)
+    {
+        curIntervalNs=message.idle?static_cast<int64_t>(config.GetKeepaliveIntervalMS())*1000000L:reqIntervalUsec*1000;
+        //deadline in the past triggers tick right away on resuming full rate
+        nextDeadlineNs=MonotonicNowNs()+(message.idle?curIntervalNs:0);
+        if(!ArmTimerFD(timerFd,curIntervalNs,nextDeadlineNs))
+            logger->Error()<<"Failed to setup timerfd: "<<strerror(errno);
+        return;
+    }
+    const uint64_t counter=1;
+    if(!message.idle && wakeFd>=0 && write(wakeFd,&counter,sizeof(counter))<0)
+        return;
+}
+
+bool Timer::ArmTimerFD(const int fd, const int64_t intervalNs, const int64_t deadlineNs)
+{
+    const itimerspec its={ToTimespec(intervalNs),ToTimespec(deadlineNs)};
+    return timerfd_settime(fd,TFD_TIMER_ABSTIME,&its,nullptr)==0;
 }
 
-void Timer::OnMessage(const void* const /*source*/, const IMessage& /*message*/)
+void Timer::OnStats()
 {
-    connectPending.store(false);
+    const auto ticks=tickCount.load(std::memory_order_relaxed);
+    logger->Info()<<"Timer ticks: "<<ticks<<"; missed ticks: "<<missedCount.load(std::memory_order_relaxed)<<
+        "; average wakeup lateness: "<<(ticks>0?static_cast<double>(latenessSumNs.load(std::memory_order_relaxed))/static_cast<double>(ticks)/1000.0:0.0)<<
+        " usec; max wakeup lateness: "<<static_cast<double>(latenessMaxNs.load(std::memory_order_relaxed))/1000.0<<" usec; wakeups from idle state: "<<
+        idleWakeupCount.load(std::memory_order_relaxed);
+}
+
+void Timer::Tick(const int64_t latenessNs, const uint64_t missed)
+{
+    tickCount.fetch_add(1,std::memory_order_relaxed);
+    if(latenessNs>0)
+    {
+        latenessSumNs.fetch_add(static_cast<uint64_t>(latenessNs),std::memory_order_relaxed);
+        if(latenessNs>latenessMaxNs.load(std::memory_order_relaxed))
+            latenessMaxNs.store(latenessNs,std::memory_order_relaxed);
+    }
+    if(missed>0)
+    {
+        missedCount.fetch_add(missed,std::memory_order_relaxed);
+        if(!connectPending.load())
+            logger->Warning()<<"Processing takes too long, missed timer events: "<<missed<<"; event: "<<eventCounter;
+    }
+    sender.SendMessage(this,TimerMessage(++eventCounter));
+}
+
+void Timer::IdleWait()
+{
+    //sleep at keepalive rate, returns early on wakeup
+    pollfd pfd={wakeFd,POLLIN,0};
+    if(poll(&pfd,1,config.GetKeepaliveIntervalMS())>0)
+    {
+        uint64_t counter=0;
+        if(read(wakeFd,&counter,sizeof(counter))<0)
+            counter=0;
+    }
+    Tick(0,0);
 }
 
 void Timer::Worker()
+{
+    switch(config.GetTimerMode())
+    {
+        case TimerMode::TimerFD:
+            logger->Info()<<"Using timerfd timer";
+            TimerFDWorker();
+            break;
+        case TimerMode::NanoSleep:
+            logger->Info()<<"Using clock_nanosleep timer";
+            NanoSleepWorker(false);
+            break;
+        case TimerMode::HybridSpin:
+            logger->Info()<<"Using clock_nanosleep timer with busy-wait for last "<<config.GetTimerSpinUS()<<" usec";
+            NanoSleepWorker(true);
+            break;
+        case TimerMode::Sleep:
+        default:
+            SleepWorker();
+            break;
+    }
+    logger->Info()<<"Timer shutdown";
+}
+
+void Timer::SleepWorker()
 {
     const auto reqInterval=std::chrono::microseconds(reqIntervalUsec);
     const auto startTime=std::chrono::steady_clock::now();
@@ -33,12 +168,20 @@ void Timer::Worker()
     auto interval=reqInterval;
     while(!shutdownPending.load())
     {
+        if(idle.load())
+        {
+            IdleWait();
+            prev=std::chrono::steady_clock::now();
+            interval=std::chrono::duration_cast<std::chrono::microseconds>(reqInterval-(prev-startTime)%reqInterval);
+            continue;
+        }
         //wait for interval
+        const auto sleepStart=std::chrono::steady_clock::now();
         if(interval.count()>0)
             std::this_thread::sleep_for(interval);
 
         prev+=interval;
-        sender.SendMessage(this,TimerMessage(++eventCounter));
+        Tick(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-sleepStart-interval).count(),0);
 
         auto now=std::chrono::steady_clock::now();
         //if(profilingEnabled)
@@ -52,11 +195,130 @@ void Timer::Worker()
         interval=std::chrono::duration_cast<std::chrono::microseconds>(reqInterval-(now-startTime)%reqInterval);
         prev=now;
     }
+}
 
-    logger->Info()<<"Timer shutdown";
+void Timer::TimerFDWorker()
+{
+    auto fd=timerfd_create(CLOCK_MONOTONIC,TFD_CLOEXEC);
+    if(fd<0)
+    {
+        logger->Warning()<<"Failed to create timerfd, using sleep-based timer: "<<strerror(errno);
+        SleepWorker();
+        return;
+    }
+    const int64_t intervalNs=reqIntervalUsec*1000;
+    auto deadline=MonotonicNowNs()+intervalNs;
+    if(!ArmTimerFD(fd,intervalNs,deadline))
+    {
+        logger->Warning()<<"Failed to setup timerfd, using sleep-based timer: "<<strerror(errno);
+        close(fd);
+        SleepWorker();
+        return;
+    }
+    while(!shutdownPending.load())
+    {
+        if(idle.load())
+        {
+            IdleWait();
+            //re-arming also drops expirations accumulated while idle
+            deadline=MonotonicNowNs()+intervalNs;
+            if(!ArmTimerFD(fd,intervalNs,deadline))
+                logger->Warning()<<"Failed to setup timerfd: "<<strerror(errno);
+            continue;
+        }
+        uint64_t expirations=0;
+        if(read(fd,&expirations,sizeof(expirations))!=sizeof(expirations) || expirations<1)
+            continue;
+        //timerfd counts all expirations since last read, so missed ticks are reported as-is and not replayed
+        deadline+=static_cast<int64_t>(expirations-1)*intervalNs;
+        Tick(MonotonicNowNs()-deadline,expirations-1);
+        deadline+=intervalNs;
+    }
+    close(fd);
+}
+
+void Timer::NanoSleepWorker(const bool spin)
+{
+    const int64_t intervalNs=reqIntervalUsec*1000;
+    const int64_t spinNs=spin?static_cast<int64_t>(config.GetTimerSpinUS())*1000:0;
+    auto deadline=MonotonicNowNs()+intervalNs;
+    while(!shutdownPending.load())
+    {
+        if(idle.load())
+        {
+            IdleWait();
+            deadline=MonotonicNowNs()+intervalNs;
+            continue;
+        }
+        //sleep until absolute deadline, so processing time does not accumulate as drift
+        const auto wakeTs=ToTimespec(deadline-spinNs);
+        while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&wakeTs,nullptr)==EINTR) {}
+        auto now=MonotonicNowNs();
+        //busy-wait for the rest of interval to hide scheduler wakeup latency
+        while(now<deadline)
+            now=MonotonicNowNs();
+        //skip deadlines that already passed, missed ticks are not replayed
+        uint64_t missed=0;
+        if(now-deadline>=intervalNs)
+        {
+            missed=static_cast<uint64_t>((now-deadline)/intervalNs);
+            deadline+=static_cast<int64_t>(missed)*intervalNs;
+        }
+        Tick(now-deadline,missed);
+        deadline+=intervalNs;
+    }
+}
+
+bool Timer::Attach(IEventLoop& loop)
+{
+    timerFd=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+    if(timerFd<0)
+    {
+        logger->Error()<<"Failed to create timerfd: "<<strerror(errno);
+        return false;
+    }
+    curIntervalNs=reqIntervalUsec*1000;
+    nextDeadlineNs=MonotonicNowNs()+curIntervalNs;
+    if(!ArmTimerFD(timerFd,curIntervalNs,nextDeadlineNs))
+    {
+        logger->Error()<<"Failed to setup timerfd: "<<strerror(errno);
+        return false;
+    }
+    if(!loop.AddFd(timerFd,EPOLLIN,this))
+        return false;
+    eventLoop=&loop;
+    logger->Info()<<"Timer attached to event loop";
+    return true;
+}
+
+void Timer::Detach()
+{
+    if(eventLoop!=nullptr)
+        eventLoop->RemoveFd(timerFd);
+    eventLoop=nullptr;
+    if(timerFd>=0)
+        close(timerFd);
+    timerFd=-1;
+}
+
+void Timer::OnEvent(const int fd, const uint32_t)
+{
+    uint64_t expirations=0;
+    if(read(fd,&expirations,sizeof(expirations))!=sizeof(expirations) || expirations<1)
+        return;
+    //timerfd counts all expirations since last read, so missed ticks are reported as-is and not replayed
+    nextDeadlineNs+=static_cast<int64_t>(expirations-1)*curIntervalNs;
+    const auto latenessNs=MonotonicNowNs()-nextDeadlineNs;
+    //tick may change idle state and re-arm timerfd, so next deadline is updated first
+    nextDeadlineNs+=curIntervalNs;
+    Tick(latenessNs,expirations-1);
 }
 
 void Timer::OnShutdown()
 {
     shutdownPending.store(true);
+    //interrupt idle wait
+    const uint64_t counter=1;
+    if(wakeFd>=0 && write(wakeFd,&counter,sizeof(counter))<0)
+        return;
 }
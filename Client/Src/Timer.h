@@ -6,11 +6,12 @@
 #include "IMessageSender.h"
 #include "IMessageSubscriber.h"
 #include "WorkerBase.h"
+#include "IEventLoop.h"
 
 #include <cstdint>
 #include <atomic>
 
-class Timer : public WorkerBase, public IMessageSubscriber
+class Timer : public WorkerBase, public IMessageSubscriber, public IEventHandler
 {
     private:
         std::shared_ptr<ILogger> logger;
@@ -20,11 +21,39 @@ class Timer : public WorkerBase, public IMessageSubscriber
         std::atomic<bool> shutdownPending;
         std::atomic<bool> connectPending;
         uint32_t eventCounter;
+        //while idle, ticks are generated at keepalive rate, wakeFd used to resume full rate right away
+        std::atomic<bool> idle;
+        int wakeFd;
+        //used only when running inside event loop
+        IEventLoop* eventLoop;
+        int timerFd;
+        int64_t nextDeadlineNs;
+        int64_t curIntervalNs;
+        //statistics, updated only from timer thread
+        std::atomic<uint64_t> tickCount;
+        std::atomic<uint64_t> missedCount;
+        std::atomic<uint64_t> latenessSumNs;
+        std::atomic<int64_t> latenessMaxNs;
+        std::atomic<uint64_t> idleWakeupCount;
+        void Tick(const int64_t latenessNs, const uint64_t missed);
+        void IdleWait();
+        bool ArmTimerFD(const int fd, const int64_t intervalNs, const int64_t deadlineNs);
+        void SleepWorker();
+        void TimerFDWorker();
+        void NanoSleepWorker(const bool spin);
+        void OnStats();
+        void OnIdleState(const IIdleStateMessage& message);
     public:
         Timer(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config, const int64_t intervalUsec);
+        ~Timer();
         //methods for ISubscriber
         bool ReadyForMessage(const MsgType msgType) final;
         void OnMessage(const void* const source, const IMessage& message) final;
+        //run timer with timerfd inside event loop instead of separate thread
+        bool Attach(IEventLoop& loop);
+        void Detach();
+        //IEventHandler
+        void OnEvent(const int fd, const uint32_t events) final;
     protected:
         //WorkerBase
         void Worker() final;
@@ -9,7 +9,7 @@ UDPConnection::UDPConnection(const int _fd, const uint16_t _port):
     remotePort(_port)
 {
     isDisposed.store(false);
-    rxSeq=txSeq=UINT16_MAX;
+    txSeq=UINT16_MAX;
 }
 
 bool UDPConnection::GetStatus()
@@ -32,13 +32,3 @@ uint16_t UDPConnection::TXSeqIncrement()
 {
     return txSeq++;
 }
-
-bool UDPConnection::RXSeqCheckIncrement(uint16_t testSeq)
-{
-    if(static_cast<uint16_t>(rxSeq-testSeq)>static_cast<uint16_t>(testSeq-rxSeq))
-    {
-        rxSeq=testSeq;
-        return true;
-    }
-    return false;
-}
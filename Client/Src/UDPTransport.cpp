@@ -4,27 +4,78 @@
 #include "CRC8.h"
 #include "Command.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fcntl.h>
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 
 class ShutdownMessage: public IShutdownMessage { public: ShutdownMessage(int _ec):IShutdownMessage(_ec){} };
-class IncomingPackageMessage: public IIncomingPackageMessage { public: IncomingPackageMessage(const uint8_t* const _package):IIncomingPackageMessage(_package){} };
+class IncomingPackageMessage: public IIncomingPackageMessage { public: IncomingPackageMessage(const PackageHandle& _handle):IIncomingPackageMessage(false,_handle){} };
 
-UDPTransport::UDPTransport(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config):
+#define URING_RECV_TAG 1
+#define URING_TIMEOUT_TAG 2
+#define URING_CANCEL_TAG 3
+#define URING_HOLD_TAG 4
+#define URING_ENTRIES 16
+
+UDPTransport::UDPTransport(std::shared_ptr<ILogger>& _logger, IMessageSender& _sender, const IConfig& _config, PackagePool& _packagePool, PathSelector& _pathSelector):
     logger(_logger),
     sender(_sender),
     config(_config),
-    rxBuff(std::make_unique<uint8_t[]>(static_cast<size_t>(config.GetNetPackageSz())))
+    packagePool(_packagePool),
+    pathSelector(_pathSelector),
+    reorderWindow(static_cast<size_t>(_config.GetUDPReorderWindow()),std::chrono::microseconds(_config.GetUDPReorderWindow()*_config.GetRemotePollIntervalUS())),
+    uring(IOURING_SEND_SLOTS),
+    parityEncoder(static_cast<size_t>(_config.GetFECGroupSize()),static_cast<size_t>(_config.GetNetPackageSz())),
+    parityDecoder(static_cast<size_t>(_config.GetNetPackageSz()))
 {
     shutdownPending.store(false);
+    uringActive.store(false);
+    //package buffers also fit incoming parity packages
+    uringRxVec={nullptr,packagePool.GetPackageSize()};
+    uringRxHdr={};
+    uringHoldTimeout={};
+    rxPkgCount.store(0);
+    txPkgCount.store(0);
+    syscallCount.store(0);
+    rxBatchCount.store(0);
+    rxBatchPkgCount.store(0);
+    txBatchCount.store(0);
+    txBatchPkgCount.store(0);
+    retransmitCount.store(0);
+    parityCount.store(0);
+    rxDropCount.store(0);
+    remoteMissing.store(0);
+    remoteHeld.store(false);
+    //setup message headers for batched rx and tx, buffers are assigned from package pool later
+    const size_t pkgSz=packagePool.GetPackageSize();
+    for(size_t i=0;i<UDP_BATCH_SIZE;++i)
+    {
+        rxVecs[i]={nullptr,pkgSz};
+        rxMsgs[i]={};
+        rxMsgs[i].msg_hdr.msg_iov=&rxVecs[i];
+        rxMsgs[i].msg_hdr.msg_iovlen=1;
+        txVecs[i]={nullptr,pkgSz};
+        txMsgs[i]={};
+        txMsgs[i].msg_hdr.msg_iov=&txVecs[i];
+        txMsgs[i].msg_hdr.msg_iovlen=1;
+    }
+    txQueueLen=0;
+    txQueueConn=nullptr;
     remoteConn=nullptr;
     udpPort=0;
     droppedRxSeqCnt=0;
+    reorderWindowConn=nullptr;
+    rxTimeoutConn=nullptr;
+    rxTimeout=std::chrono::microseconds(0);
+    eventLoop=nullptr;
+    holdTimerFd=-1;
 }
 
 static IPAddress Lookup(const std::string &target)
@@ -96,7 +147,7 @@ std::shared_ptr<UDPConnection> UDPTransport::GetConnection()
         return remoteConn;
 
     if(remoteConn!=nullptr)
-        remoteConn->Dispose();
+        DisposeConnection(remoteConn);
 
     ImmutableStorage<IPAddress> target(IPAddress(config.GetRemoteAddr()));
     if(!target.Get().isValid)
@@ -156,6 +207,12 @@ std::shared_ptr<UDPConnection> UDPTransport::GetConnection()
 
     remoteConn=std::make_shared<UDPConnection>(fd,udpPort);
     logger->Info()<<"Remote connection created";
+    if(eventLoop!=nullptr && !eventLoop->AddFd(fd,EPOLLIN,this))
+    {
+        DisposeConnection(remoteConn);
+        remoteConn=nullptr;
+        return nullptr;
+    }
     return remoteConn;
 }
 
@@ -167,6 +224,17 @@ void UDPTransport::Worker()
         return;
     }
 
+    if(config.GetIOURingEnabled())
+    {
+        if(uring.Setup(URING_ENTRIES))
+        {
+            URingWorker();
+            return;
+        }
+        logger->Warning()<<"Failed to setup io_uring, falling back to regular socket operations: "<<strerror(errno);
+        uring.Dispose();
+    }
+
     logger->Info()<<"Starting transport";
     while(!shutdownPending.load())
     {
@@ -179,76 +247,357 @@ void UDPTransport::Worker()
             continue;
         }
 
-        const size_t pkgSz=static_cast<size_t>(config.GetNetPackageSz());
-        iovec pkgVec={rxBuff.get(),pkgSz};
-        msghdr pkgHdr={};
-        pkgHdr.msg_iov=&pkgVec;
-        pkgHdr.msg_iovlen=1;
+        auto batchSz=PrepareRxPackages();
+        if(batchSz<1)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.GetServiceIntervalMS()));
+            continue;
+        }
 
-        //read package
-        auto dr=recvmsg(conn->fd,&pkgHdr,0);
+        //wait for the first package, then read all other packages already queued at socket
+        UpdateRxTimeout(conn);
+        syscallCount.fetch_add(1,std::memory_order_relaxed);
+        auto dr=recvmmsg(conn->fd,rxMsgs,static_cast<unsigned>(batchSz),MSG_WAITFORONE,nullptr);
         if(dr<=0)
         {
             auto error=errno;
             if(error==EINTR || error==EAGAIN || error==EWOULDBLOCK)
+            {
+                //release packages held for too long
+                DeliverPackages();
                 continue;
+            }
             //socket was closed or errored, close connection from our side and stop reading
             if(!shutdownPending.load())
-                logger->Warning()<<"recvmsg failed: "<<strerror(error);
+                logger->Warning()<<"recvmmsg failed: "<<strerror(error);
             conn->Dispose();
             continue;
         }
-        if(static_cast<size_t>(dr)<pkgSz)
-        {
-            logger->Warning()<<"Dropping package with less bytes than expected: "<<dr<<" bytes, instead of: "<<pkgSz<<" bytes";
+        HandleIncomingBatch(conn,dr);
+    }
+
+    std::lock_guard<std::mutex> opGuard(remoteConnLock);
+    if(remoteConn!=nullptr)
+        remoteConn->Dispose();
+    logger->Info()<<"Transport shutdown";
+}
+
+int UDPTransport::PrepareRxPackages()
+{
+    //packages that was not retained by subscribers are reused, returns count of packages ready for receiving
+    for(size_t i=0;i<UDP_BATCH_SIZE;++i)
+    {
+        if(rxPkgs[i].IsUnique())
             continue;
-        }
-        if((pkgHdr.msg_flags&MSG_TRUNC)>0)
+        rxPkgs[i]=packagePool.Acquire();
+        rxVecs[i].iov_base=rxPkgs[i].Get();
+        if(!rxPkgs[i].IsValid())
         {
-            logger->Warning()<<"Dropping too big package";
-            continue;
+            if(i<1)
+                logger->Warning()<<"No free package buffers left for receiving";
+            return static_cast<int>(i);
         }
+    }
+    return UDP_BATCH_SIZE;
+}
+
+void UDPTransport::HandleIncomingBatch(const std::shared_ptr<UDPConnection>& conn, const int count)
+{
+    rxBatchCount.fetch_add(1,std::memory_order_relaxed);
+    rxBatchPkgCount.fetch_add(static_cast<uint64_t>(count),std::memory_order_relaxed);
+    for(size_t i=0;i<static_cast<size_t>(count);++i)
+        HandleIncomingPackage(conn,rxPkgs[i],static_cast<ssize_t>(rxMsgs[i].msg_len),rxMsgs[i].msg_hdr.msg_flags);
+}
+
+void UDPTransport::HandleIncomingPackage(const std::shared_ptr<UDPConnection>& conn, const PackageHandle& rxPkg, const ssize_t dr, const int msgFlags)
+{
+    const auto package=rxPkg.Get();
+    //probe echo is shorter than any package
+    if(config.GetAutoPathEnabled() && pathSelector.OnProbeEcho(package,static_cast<size_t>(dr)))
+        return;
+    const size_t hdrSz=static_cast<size_t>(config.GetNetPackageHdrSz());
+    if(static_cast<size_t>(dr)<hdrSz)
+    {
+        logger->Warning()<<"Dropping package with less bytes than expected: "<<dr<<" bytes, instead of: "<<hdrSz<<" bytes";
+        return;
+    }
+    if((msgFlags&MSG_TRUNC)>0)
+    {
+        logger->Warning()<<"Dropping too big package";
+        return;
+    }
 
-        //TODO: check remote port if needed
+    //TODO: check remote port if needed
+
+    //held packages and parity of the old connection are using sequence numbers that are not valid anymore
+    if(reorderWindowConn!=conn)
+    {
+        reorderWindow.Reset();
+        parityDecoder.Reset();
+        reorderWindowConn=conn;
+    }
 
-        //verify CRC, disconnect on failure and drop data
-        if(*(rxBuff.get()+config.GetNetPackageMetaSz())!=CRC8(rxBuff.get(),static_cast<size_t>(config.GetNetPackageMetaSz())))
+    //single lost package of the group is restored from parity package, and processed as received one
+    if(config.GetFECGroupSize()>0 && IsParityPackage(package,static_cast<uint16_t>(dr)))
+    {
+        auto recoveredPkg=packagePool.Acquire();
+        if(!recoveredPkg.IsValid())
         {
-            logger->Warning()<<"Dropping package with invalid control block checksum";
-            continue;
+            logger->Warning()<<"No free package buffers left for restoring lost package";
+            return;
         }
+        const auto recoveredSz=parityDecoder.Recover(package,static_cast<size_t>(dr),recoveredPkg.Get());
+        if(recoveredSz>0)
+            HandleIncomingPackage(conn,recoveredPkg,static_cast<ssize_t>(recoveredSz),0);
+        return;
+    }
 
-        //check for sequence number
-        if(!conn->RXSeqCheckIncrement(static_cast<uint16_t>(*rxBuff.get()|*(rxBuff.get()+1)<<8)))
+    //verify CRC, disconnect on failure and drop data
+    if(*(package+config.GetNetPackageMetaSz())!=CRC8(package,static_cast<size_t>(config.GetNetPackageMetaSz())))
+    {
+        logger->Warning()<<"Dropping package with invalid control block checksum";
+        return;
+    }
+
+    //verify payload sizes at metadata block
+    auto plSz=Response::PayloadSize(config.GetPortCount(),config.GetPackageFeatures(),config.GetPortPayloadMaxSz(),package);
+    if(plSz<0 || (config.GetVariableLengthEnabled() && static_cast<size_t>(dr)!=hdrSz+static_cast<size_t>(plSz)))
+    {
+        logger->Warning()<<"Dropping package with invalid payload size";
+        return;
+    }
+
+    //verify payload CRC
+    if(config.GetPayloadCRCEnabled() && !VerifyPayloadCRC(config.GetNetPackageMetaSz(),static_cast<size_t>(dr),package))
+    {
+        logger->Warning()<<"Dropping package with invalid payload checksum";
+        return;
+    }
+
+    //packages reported missing by remote side are retransmitted along with the next outgoing package
+    if(config.GetNackEnabled())
+    {
+        uint16_t missingSeq=0;
+        const auto missingCount=ReadNack(package,static_cast<uint8_t>(config.GetPortCount()),config.GetPackageFeatures(),missingSeq);
+        if(missingCount>0)
+            remoteMissing.store(static_cast<uint32_t>(missingSeq)<<8|missingCount,std::memory_order_relaxed);
+        remoteHeld.store(missingCount>0,std::memory_order_relaxed);
+    }
+
+    //packages are added to parity as received, restored package is ignored as it's group is already passed
+    const auto seq=static_cast<uint16_t>(*package|*(package+1)<<8);
+    if(config.GetFECGroupSize()>0)
+        parityDecoder.Add(seq,package,static_cast<size_t>(dr));
+
+    //check for sequence number, packages arrived ahead of missing ones are held at reorder window
+    if(!reorderWindow.Push(seq,rxPkg))
+    {
+        if(droppedRxSeqCnt<1)
+            logger->Warning()<<"Dropping incoming packages due to invalid sequence number!";
+        droppedRxSeqCnt++;
+        return;
+    }
+
+    if(droppedRxSeqCnt>0)
+    {
+        logger->Warning()<<"Dropped "<<droppedRxSeqCnt<<" packages with invalid sequence number";
+        droppedRxSeqCnt=0;
+    }
+
+    DeliverPackages();
+}
+
+void UDPTransport::DeliverPackages()
+{
+    //signal new packages received, in sequence order
+    for(auto rxPkg=reorderWindow.Pop();rxPkg.IsValid();rxPkg=reorderWindow.Pop())
+    {
+        rxPkgCount.fetch_add(1,std::memory_order_relaxed);
+        sender.SendMessage(this, IncomingPackageMessage(rxPkg));
+    }
+}
+
+void UDPTransport::UpdateRxTimeout(const std::shared_ptr<UDPConnection>& conn)
+{
+    //held packages are released when receive timeout is passed
+    auto timeout=std::chrono::microseconds(std::chrono::milliseconds(config.GetServiceIntervalMS()));
+    std::chrono::steady_clock::time_point deadline;
+    if(reorderWindow.GetHoldDeadline(deadline))
+    {
+        //zero SO_RCVTIMEO value means no timeout
+        const auto left=std::chrono::duration_cast<std::chrono::microseconds>(deadline-std::chrono::steady_clock::now());
+        timeout=std::min(timeout,std::max(left,std::chrono::microseconds(1)));
+    }
+    if(rxTimeoutConn==conn && rxTimeout==timeout)
+        return;
+    const timeval tv={static_cast<time_t>(timeout.count()/1000000),static_cast<suseconds_t>(timeout.count()%1000000)};
+    syscallCount.fetch_add(1,std::memory_order_relaxed);
+    if(setsockopt(conn->fd,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv))!=0)
+    {
+        logger->Warning()<<"Failed to set SO_RCVTIMEO option to socket: "<<strerror(errno);
+        return;
+    }
+    rxTimeoutConn=conn;
+    rxTimeout=timeout;
+}
+
+void UDPTransport::ArmHoldTimer()
+{
+    std::chrono::steady_clock::time_point deadline;
+    if(holdTimerFd<0 || !reorderWindow.GetHoldDeadline(deadline) || deadline==holdTimerDeadline)
+        return;
+    //zero timerfd value disarms the timer
+    const auto left=std::chrono::duration_cast<std::chrono::nanoseconds>(deadline-std::chrono::steady_clock::now()).count();
+    const auto value=left>0?left:1;
+    const itimerspec its={{0,0},{static_cast<time_t>(value/1000000000),static_cast<long>(value%1000000000)}};
+    syscallCount.fetch_add(1,std::memory_order_relaxed);
+    if(timerfd_settime(holdTimerFd,0,&its,nullptr)!=0)
+    {
+        logger->Warning()<<"Failed to setup timerfd: "<<strerror(errno);
+        return;
+    }
+    holdTimerDeadline=deadline;
+}
+
+void UDPTransport::DisposeConnection(const std::shared_ptr<UDPConnection>& conn)
+{
+    //fd must be removed from epoll set before it is closed, because it's number may be reused right after close
+    if(eventLoop!=nullptr && conn->GetStatus())
+        eventLoop->RemoveFd(conn->fd);
+    conn->Dispose();
+}
+
+void UDPTransport::URingWorker()
+{
+    logger->Info()<<"Starting transport, using io_uring backend";
+    const auto interval=config.GetServiceIntervalTV();
+    const __kernel_timespec timeout={interval.tv_sec,interval.tv_usec*1000};
+    uringActive.store(true);
+    bool timeoutArmed=false;
+    bool holdArmed=false;
+    while(!shutdownPending.load())
+    {
+        //get connection
+        auto conn=GetConnection();
+        if(conn==nullptr)
         {
-            if(droppedRxSeqCnt<1)
-                logger->Warning()<<"Dropping incoming packages due to invalid sequence number!";
-            droppedRxSeqCnt++;
+            //wait for a while and try again
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.GetServiceIntervalMS()));
             continue;
         }
 
-        if(droppedRxSeqCnt>0)
+        bool recvArmed=false;
+        bool cancelArmed=false;
+        //keep receive operation armed until connection is closed or recreated
+        while(!shutdownPending.load() && (recvArmed || conn->GetStatus()))
         {
-            logger->Warning()<<"Dropped "<<droppedRxSeqCnt<<" packages with invalid sequence number";
-            droppedRxSeqCnt=0;
+            if(!recvArmed && conn->GetStatus() && PrepareRxPackages()>0)
+            {
+                uringRxVec.iov_base=rxPkgs[0].Get();
+                uringRxHdr={};
+                uringRxHdr.msg_iov=&uringRxVec;
+                uringRxHdr.msg_iovlen=1;
+                recvArmed=uring.PrepareRecvMsg(conn->fd,&uringRxHdr,0,URING_RECV_TAG);
+            }
+            //connection was closed from other thread, pending receive operation must be cancelled
+            if(recvArmed && !cancelArmed && !conn->GetStatus())
+                cancelArmed=uring.PrepareCancel(URING_RECV_TAG,URING_CANCEL_TAG);
+            //timeout used to check shutdown state periodically
+            if(!timeoutArmed)
+                timeoutArmed=uring.PrepareTimeout(&timeout,URING_TIMEOUT_TAG);
+            //held packages are released at the hold deadline of reorder window
+            std::chrono::steady_clock::time_point deadline;
+            if(!holdArmed && reorderWindow.GetHoldDeadline(deadline))
+            {
+                const auto left=std::chrono::duration_cast<std::chrono::nanoseconds>(deadline-std::chrono::steady_clock::now()).count();
+                uringHoldTimeout={left>0?left/1000000000:0,left>0?left%1000000000:0};
+                holdArmed=uring.PrepareTimeout(&uringHoldTimeout,URING_HOLD_TAG);
+            }
+            auto wr=uring.SubmitAndWait(1);
+            if(wr<0 && wr!=-EINTR && wr!=-ETIME && wr!=-EBUSY)
+            {
+                HandleError(-wr,"io_uring_enter failed: ");
+                uringActive.store(false);
+                uring.Dispose();
+                return;
+            }
+            uint64_t tag=0;
+            int result=0;
+            size_t requested=0;
+            while(uring.PopCompletion(tag,result,requested))
+            {
+                if(tag==URING_TIMEOUT_TAG)
+                {
+                    timeoutArmed=false;
+                    //release packages held for too long
+                    DeliverPackages();
+                }
+                else if(tag==URING_HOLD_TAG)
+                {
+                    holdArmed=false;
+                    DeliverPackages();
+                }
+                else if(tag==URING_CANCEL_TAG)
+                    cancelArmed=false;
+                else if(tag==IOURING_SEND_TAG)
+                {
+                    if(result<0 && !shutdownPending.load())
+                        logger->Warning()<<"send failed: "<<strerror(-result);
+                }
+                else if(tag==URING_RECV_TAG)
+                {
+                    recvArmed=false;
+                    if(result==-EINTR || result==-EAGAIN || result==-ECANCELED)
+                        continue;
+                    if(result<0)
+                    {
+                        //socket was closed or errored, close connection from our side and stop reading
+                        if(!shutdownPending.load())
+                            logger->Warning()<<"recvmsg failed: "<<strerror(-result);
+                        DisposeConnection(conn);
+                        continue;
+                    }
+                    if(conn->GetStatus())
+                        HandleIncomingPackage(conn,rxPkgs[0],result,uringRxHdr.msg_flags);
+                }
+            }
         }
-
-        //TODO: extra check for payloads size at metadata block, disconnect if too big
-
-        //logger->Info()<<"New UDP package received";
-        //signal new package received
-        sender.SendMessage(this, IncomingPackageMessage(rxBuff.get()));
     }
-
+    uringActive.store(false);
+    uring.Dispose();
     std::lock_guard<std::mutex> opGuard(remoteConnLock);
     if(remoteConn!=nullptr)
         remoteConn->Dispose();
     logger->Info()<<"Transport shutdown";
 }
 
+void UDPTransport::OnStats()
+{
+    const auto rxCount=rxPkgCount.load(std::memory_order_relaxed);
+    const auto txCount=txPkgCount.load(std::memory_order_relaxed);
+    const auto sysCount=syscallCount.load(std::memory_order_relaxed)+uring.GetSyscallCount();
+    logger->Info()<<"Packages received: "<<rxCount<<"; packages sent: "<<txCount<<"; socket syscalls: "<<sysCount<<
+        "; syscalls per package: "<<(rxCount+txCount>0?static_cast<double>(sysCount)/static_cast<double>(rxCount+txCount):0.0)<<
+        "; packages dropped without free buffers: "<<rxDropCount.load(std::memory_order_relaxed);
+    const auto rxBatches=rxBatchCount.load(std::memory_order_relaxed);
+    const auto txBatches=txBatchCount.load(std::memory_order_relaxed);
+    logger->Info()<<"recvmmsg calls: "<<rxBatches<<"; average rx batch: "<<
+        (rxBatches>0?static_cast<double>(rxBatchPkgCount.load(std::memory_order_relaxed))/static_cast<double>(rxBatches):0.0)<<
+        "; sendmmsg calls: "<<txBatches<<"; average tx batch: "<<
+        (txBatches>0?static_cast<double>(txBatchPkgCount.load(std::memory_order_relaxed))/static_cast<double>(txBatches):0.0);
+    logger->Info()<<"Packages reordered: "<<reorderWindow.GetReorderedCount()<<"; late packages dropped: "<<reorderWindow.GetLateCount()<<
+        "; packages lost: "<<reorderWindow.GetLostCount()<<"; packages retransmitted: "<<retransmitCount.load(std::memory_order_relaxed);
+    logger->Info()<<"Parity packages sent: "<<parityCount.load(std::memory_order_relaxed)<<"; lost packages restored: "<<parityDecoder.GetRecoveredCount()<<
+        "; lost packages not restored: "<<parityDecoder.GetUnrecoveredCount();
+    if(config.GetAutoPathEnabled())
+        logger->Info()<<"Data path: "<<(pathSelector.UseTCP()?"TCP":"UDP")<<"; switches to TCP: "<<pathSelector.GetSwitchToTCPCount()<<
+            "; switches to UDP: "<<pathSelector.GetSwitchToUDPCount()<<"; last UDP loss: "<<pathSelector.GetLossPercent()<<
+            "%; last UDP round-trip time: "<<pathSelector.GetRTTUS()<<" usec";
+}
+
 bool UDPTransport::ReadyForMessage(const MsgType msgType)
 {
-    return msgType==MSG_SEND_PACKAGE || msgType==MSG_CONNECTED;
+    return msgType==MSG_SEND_PACKAGE || msgType==MSG_CONNECTED || msgType==MSG_STATS;
 }
 
 void UDPTransport::OnMessage(const void* const, const IMessage& message)
@@ -257,11 +606,16 @@ void UDPTransport::OnMessage(const void* const, const IMessage& message)
         OnSendPackage(static_cast<const ISendPackageMessage&>(message));
     if(message.msgType==MSG_CONNECTED)
         OnConnected(static_cast<const IConnectedMessage&>(message));
+    if(message.msgType==MSG_STATS)
+        OnStats();
 }
 
 void UDPTransport::OnSendPackage(const ISendPackageMessage& message)
 {
-    if(message.useTCP)
+    //UDP path is probed while data goes via any transport
+    uint16_t heldSeq=0;
+    const bool probeDue=config.GetAutoPathEnabled() && pathSelector.ProbeDue(reorderWindow.GetMissing(heldSeq)<1 && !remoteHeld.load());
+    if(message.useTCP && !probeDue)
         return;
 
     if(!config.GetUDPEnabled())
@@ -276,27 +630,189 @@ void UDPTransport::OnSendPackage(const ISendPackageMessage& message)
     if(conn==nullptr)
         return;
 
+    //drop queued packages if connection was recreated, they are using sequence numbers of the old connection
+    if(txQueueConn!=conn)
+    {
+        ClearTXQueue();
+        ClearTXHistory();
+        parityEncoder.Reset();
+        txQueueConn=conn;
+    }
+
+    if(probeDue)
+        SendProbe(conn);
+    if(message.useTCP)
+        return;
+
+    //missing packages are sent before the new one
+    if(config.GetNackEnabled())
+        Retransmit(conn);
+
     //write UDP sequence
-    WriteU16Value(conn->TXSeqIncrement(),txBuff);
+    const auto seq=conn->TXSeqIncrement();
+    WriteU16Value(seq,txBuff);
+
+    //request retransmission of remote packages missing before the ones held at reorder window
+    if(config.GetNackEnabled())
+    {
+        uint16_t missingSeq=0;
+        const auto missingCount=reorderWindow.GetMissing(missingSeq);
+        WriteNack(txBuff,static_cast<uint8_t>(config.GetPortCount()),config.GetPackageFeatures(),missingSeq,missingCount);
+    }
 
-    //generate checksum
+    //generate checksums, metadata CRC also covers the payload CRC
+    if(config.GetPayloadCRCEnabled())
+        WritePayloadCRC(config.GetNetPackageMetaSz(),message.size,txBuff);
     *(txBuff+config.GetNetPackageMetaSz())=CRC8(txBuff,static_cast<size_t>(config.GetNetPackageMetaSz()));
 
     //send package
-    auto dw=send(conn->fd,txBuff,static_cast<size_t>(config.GetNetPackageSz()),0);
-    if(dw<=0)
+    txPkgCount.fetch_add(1,std::memory_order_relaxed);
+    SendPackage(conn,message.handle,message.size);
+    if(config.GetNackEnabled())
+        txHistory[seq%UDP_TX_HISTORY_SIZE]=UDPSentPackage{seq,message.size,message.handle};
+    //parity package follows the last package of the group
+    if(config.GetFECGroupSize()>0 && parityEncoder.Add(seq,txBuff,message.size))
+        SendParity(conn);
+}
+
+void UDPTransport::SendProbe(const std::shared_ptr<UDPConnection>& conn)
+{
+    auto probePkg=packagePool.Acquire();
+    if(!probePkg.IsValid())
     {
+        logger->Warning()<<"No free package buffers left, probe package dropped";
+        return;
+    }
+    pathSelector.WriteProbe(probePkg.Get(),rxPkgCount.load(std::memory_order_relaxed),reorderWindow.GetLostCount()+reorderWindow.GetLateCount());
+    SendPackage(conn,probePkg,PROBE_SIZE);
+}
+
+void UDPTransport::SendParity(const std::shared_ptr<UDPConnection>& conn)
+{
+    auto parityPkg=packagePool.Acquire();
+    if(!parityPkg.IsValid())
+        logger->Warning()<<"No free package buffers left, parity package dropped";
+    else
+    {
+        const auto paritySz=parityEncoder.Write(parityPkg.Get());
+        parityCount.fetch_add(1,std::memory_order_relaxed);
+        SendPackage(conn,parityPkg,paritySz);
+    }
+    parityEncoder.Reset();
+}
+
+void UDPTransport::Retransmit(const std::shared_ptr<UDPConnection>& conn)
+{
+    const auto value=remoteMissing.exchange(0,std::memory_order_relaxed);
+    const auto missingSeq=static_cast<uint16_t>(value>>8);
+    for(uint16_t i=0;i<(value&0xFF);++i)
+    {
+        auto &entry=txHistory[static_cast<uint16_t>(missingSeq+i)%UDP_TX_HISTORY_SIZE];
+        if(!entry.package.IsValid() || entry.seq!=static_cast<uint16_t>(missingSeq+i))
+            continue;
+        //package is released from history, so it is not retransmitted again on repeated requests
+        const auto package=std::move(entry.package);
+        retransmitCount.fetch_add(1,std::memory_order_relaxed);
+        SendPackage(conn,package,entry.size);
+    }
+}
+
+void UDPTransport::ClearTXHistory()
+{
+    for(size_t i=0;i<UDP_TX_HISTORY_SIZE;++i)
+        txHistory[i].package=PackageHandle();
+    remoteMissing.store(0);
+    remoteHeld.store(false);
+}
+
+void UDPTransport::SendPackage(const std::shared_ptr<UDPConnection>& conn, const PackageHandle& package, const size_t pkgSz)
+{
+    if(uringActive.load())
+    {
+        //send slot keeps the package buffer until send is complete
+        if(!uring.Send(conn->fd,package,pkgSz,0))
+            logger->Warning()<<"Failed to queue package for sending with io_uring, package dropped";
+        return;
+    }
+    if(txQueueLen<1)
+    {
+        //nothing queued, send package right away
+        syscallCount.fetch_add(1,std::memory_order_relaxed);
+        auto dw=send(conn->fd,package.Get(),pkgSz,MSG_DONTWAIT);
+        if(dw>0)
+        {
+            //probe package is shorter than metadata block
+            if(static_cast<size_t>(dw)<pkgSz)
+                logger->Warning()<<"Partial send detected: "<<dw<<" bytes; instead of: "<<pkgSz<<" bytes";
+            return;
+        }
         auto error=errno;
-        if(error==EINTR)
+        if(error!=EINTR && error!=EWOULDBLOCK)
+        {
+            if(!shutdownPending.load())
+                logger->Warning()<<"send failed: "<<strerror(error);
+            DisposeConnection(conn);
             return;
-        if(!shutdownPending.load())
-            logger->Warning()<<"send failed: "<<strerror(error);
-        conn->Dispose();
+        }
+        //socket is not ready, keep the package to send it with the next batch
+        txQueue[0]=package;
+        txVecs[0]={txQueue[0].Get(),pkgSz};
+        txQueueLen=1;
         return;
     }
 
-    if(dw<config.GetNetPackageMetaSz())
-        logger->Warning()<<"Partial send detected: "<<dw<<" bytes; instead of: "<<config.GetNetPackageMetaSz()<<" bytes";
+    //there are packages waiting, append current package and send all of them with a single call
+    if(txQueueLen>=UDP_BATCH_SIZE)
+    {
+        logger->Warning()<<"Outgoing package queue is full, package dropped";
+        FlushTXQueue(conn);
+        return;
+    }
+    txQueue[txQueueLen]=package;
+    txVecs[txQueueLen]={txQueue[txQueueLen].Get(),pkgSz};
+    txQueueLen++;
+    FlushTXQueue(conn);
+}
+
+bool UDPTransport::FlushTXQueue(const std::shared_ptr<UDPConnection>& conn)
+{
+    size_t sent=0;
+    while(sent<txQueueLen)
+    {
+        syscallCount.fetch_add(1,std::memory_order_relaxed);
+        auto dw=sendmmsg(conn->fd,txMsgs+sent,static_cast<unsigned>(txQueueLen-sent),MSG_DONTWAIT);
+        if(dw<=0)
+        {
+            auto error=errno;
+            if(error==EINTR)
+                continue;
+            if(error==EWOULDBLOCK)
+                break;
+            if(!shutdownPending.load())
+                logger->Warning()<<"sendmmsg failed: "<<strerror(error);
+            DisposeConnection(conn);
+            ClearTXQueue();
+            return false;
+        }
+        txBatchCount.fetch_add(1,std::memory_order_relaxed);
+        txBatchPkgCount.fetch_add(static_cast<uint64_t>(dw),std::memory_order_relaxed);
+        sent+=static_cast<size_t>(dw);
+    }
+    //move packages that was not sent yet to the start of the queue, release sent ones
+    for(size_t i=0;sent>0 && i<txQueueLen;++i)
+    {
+        txQueue[i]=i+sent<txQueueLen?std::move(txQueue[i+sent]):PackageHandle();
+        txVecs[i]={txQueue[i].Get(),i+sent<txQueueLen?txVecs[i+sent].iov_len:0};
+    }
+    txQueueLen-=sent;
+    return true;
+}
+
+void UDPTransport::ClearTXQueue()
+{
+    for(size_t i=0;i<txQueueLen;++i)
+        txQueue[i]=PackageHandle();
+    txQueueLen=0;
 }
 
 void UDPTransport::OnConnected(const IConnectedMessage& message)
@@ -304,12 +820,115 @@ void UDPTransport::OnConnected(const IConnectedMessage& message)
     //destroy current connection, it will be recreated on next send/receive operation
     std::lock_guard<std::mutex> opGuard(remoteConnLock);
     udpPort=message.udpPort;
+    pathSelector.Reset();
     if(remoteConn!=nullptr)
-        remoteConn->Dispose();
+        DisposeConnection(remoteConn);
     if(config.GetUDPEnabled())
         logger->Info()<<"Connection reset pending";
 }
 
+bool UDPTransport::Attach(IEventLoop& loop)
+{
+    if(!config.GetUDPEnabled())
+    {
+        logger->Info()<<"Use of UDP transport is disabled";
+        return true;
+    }
+    //timer is needed only when packages may be held at reorder window
+    if(config.GetUDPReorderWindow()>0)
+    {
+        holdTimerFd=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+        if(holdTimerFd<0)
+        {
+            logger->Error()<<"Failed to create timerfd: "<<strerror(errno);
+            return false;
+        }
+        if(!loop.AddFd(holdTimerFd,EPOLLIN,this))
+            return false;
+    }
+    //connection will be registered at event loop when created
+    eventLoop=&loop;
+    logger->Info()<<"Starting transport";
+    return true;
+}
+
+void UDPTransport::Detach()
+{
+    shutdownPending.store(true);
+    std::lock_guard<std::mutex> opGuard(remoteConnLock);
+    if(remoteConn!=nullptr)
+        DisposeConnection(remoteConn);
+    if(holdTimerFd>=0)
+    {
+        if(eventLoop!=nullptr)
+            eventLoop->RemoveFd(holdTimerFd);
+        close(holdTimerFd);
+    }
+    holdTimerFd=-1;
+    eventLoop=nullptr;
+    logger->Info()<<"Transport shutdown";
+}
+
+void UDPTransport::OnEvent(const int fd, const uint32_t)
+{
+    if(fd==holdTimerFd)
+    {
+        uint64_t expirations=0;
+        if(read(holdTimerFd,&expirations,sizeof(expirations))!=sizeof(expirations))
+            return;
+        //release packages held for too long, then wait for the next deadline if packages are still held
+        holdTimerDeadline=std::chrono::steady_clock::time_point();
+        DeliverPackages();
+        ArmHoldTimer();
+        return;
+    }
+
+    std::shared_ptr<UDPConnection> conn=nullptr;
+    {
+        std::lock_guard<std::mutex> opGuard(remoteConnLock);
+        conn=remoteConn;
+    }
+    if(conn==nullptr || conn->fd!=fd || !conn->GetStatus())
+        return;
+
+    //read all queued packages without blocking, up to UDP_BATCH_SIZE packages per call
+    while(true)
+    {
+        auto batchSz=PrepareRxPackages();
+        if(batchSz<1)
+        {
+            //level-triggered fd stays readable, so queued packages are discarded, it is handled as regular loss
+            while(true)
+            {
+                syscallCount.fetch_add(1,std::memory_order_relaxed);
+                if(recv(fd,nullptr,0,MSG_DONTWAIT|MSG_TRUNC)>=0)
+                    rxDropCount.fetch_add(1,std::memory_order_relaxed);
+                else if(errno!=EINTR)
+                    return;
+            }
+        }
+        syscallCount.fetch_add(1,std::memory_order_relaxed);
+        auto dr=recvmmsg(fd,rxMsgs,static_cast<unsigned>(batchSz),MSG_DONTWAIT,nullptr);
+        if(dr<=0)
+        {
+            auto error=errno;
+            if(error==EINTR)
+                continue;
+            if(error==EWOULDBLOCK)
+                return;
+            if(!shutdownPending.load())
+                logger->Warning()<<"recvmmsg failed: "<<strerror(error);
+            DisposeConnection(conn);
+            return;
+        }
+        HandleIncomingBatch(conn,dr);
+        ArmHoldTimer();
+        //socket queue is drained, level-triggered epoll will report new packages
+        if(dr<batchSz)
+            return;
+    }
+}
+
 void UDPTransport::OnShutdown()
 {
     shutdownPending.store(true);
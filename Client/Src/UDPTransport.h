@@ -7,36 +7,124 @@
 #include "ILogger.h"
 #include "IMessageSender.h"
 #include "IMessageSubscriber.h"
+#include "IEventLoop.h"
+#include "IOURing.h"
+#include "PathSelector.h"
+#include "ReorderWindow.h"
+#include "ParityGroup.h"
 
 #include <memory>
 #include <cstdint>
 #include <atomic>
+#include <sys/socket.h>
 
-class UDPTransport final : public WorkerBase, public IMessageSubscriber
+//max packages processed with single recvmmsg/sendmmsg call
+#define UDP_BATCH_SIZE 16
+//count of last sent packages kept for retransmission with PKG_FEAT_NACK, must be a power of 2
+#define UDP_TX_HISTORY_SIZE 32
+
+struct UDPSentPackage
+{
+    uint16_t seq;
+    size_t size;
+    PackageHandle package;
+};
+
+class UDPTransport final : public WorkerBase, public IMessageSubscriber, public IEventHandler
 {
     private: //fields setup via constructor
         std::shared_ptr<ILogger> logger;
         IMessageSender& sender;
         const IConfig& config;
-        std::unique_ptr<uint8_t[]> rxBuff;
+        PackagePool& packagePool;
+        PathSelector& pathSelector;
     private:
+        //rx batch packages, replaced with new ones if still in use by subscribers
+        PackageHandle rxPkgs[UDP_BATCH_SIZE];
+        //queue for outgoing packages that was not sent immediately
+        PackageHandle txQueue[UDP_BATCH_SIZE];
         std::atomic<bool> shutdownPending;
         //remote connection with it's management lock
         std::mutex remoteConnLock;
         std::shared_ptr<UDPConnection> remoteConn;
         uint16_t udpPort;
         size_t droppedRxSeqCnt;
+        //incoming packages are delivered in sequence order, window is reset when connection is recreated
+        ReorderWindow reorderWindow;
+        std::shared_ptr<UDPConnection> reorderWindowConn;
+        //receive timeout of the socket, shortened to the hold deadline of reorder window
+        std::shared_ptr<UDPConnection> rxTimeoutConn;
+        std::chrono::microseconds rxTimeout;
+        //used only when running inside event loop
+        IEventLoop* eventLoop;
+        //releases held packages at the hold deadline of reorder window when running inside event loop
+        int holdTimerFd;
+        std::chrono::steady_clock::time_point holdTimerDeadline;
+        //io_uring backend, used only if enabled and supported
+        IOURing uring;
+        std::atomic<bool> uringActive;
+        iovec uringRxVec;
+        msghdr uringRxHdr;
+        __kernel_timespec uringHoldTimeout;
+        //batched rx/tx
+        iovec rxVecs[UDP_BATCH_SIZE];
+        mmsghdr rxMsgs[UDP_BATCH_SIZE];
+        iovec txVecs[UDP_BATCH_SIZE];
+        mmsghdr txMsgs[UDP_BATCH_SIZE];
+        size_t txQueueLen;
+        std::shared_ptr<UDPConnection> txQueueConn;
+        //sent packages indexed by sequence number, every package is retransmitted once at most
+        UDPSentPackage txHistory[UDP_TX_HISTORY_SIZE];
+        //missing packages reported by remote side, first seq and count packed, served with the next outgoing package
+        std::atomic<uint32_t> remoteMissing;
+        //remote side holds packages awaiting missing ones, as reported by the last received package
+        std::atomic<bool> remoteHeld;
+        //XOR parity of sent and received packages with PKG_FEAT_FEC
+        ParityEncoder parityEncoder;
+        ParityDecoder parityDecoder;
+        //statistics
+        std::atomic<uint64_t> rxPkgCount;
+        std::atomic<uint64_t> txPkgCount;
+        std::atomic<uint64_t> syscallCount;
+        std::atomic<uint64_t> rxBatchCount;
+        std::atomic<uint64_t> rxBatchPkgCount;
+        std::atomic<uint64_t> txBatchCount;
+        std::atomic<uint64_t> txBatchPkgCount;
+        std::atomic<uint64_t> retransmitCount;
+        std::atomic<uint64_t> parityCount;
+        std::atomic<uint64_t> rxDropCount;
     private: //service methods
         std::shared_ptr<UDPConnection> GetConnection();
+        void DisposeConnection(const std::shared_ptr<UDPConnection>& conn);
+        void HandleIncomingPackage(const std::shared_ptr<UDPConnection>& conn, const PackageHandle& rxPkg, const ssize_t dr, const int msgFlags);
+        int PrepareRxPackages();
+        void DeliverPackages();
+        void UpdateRxTimeout(const std::shared_ptr<UDPConnection>& conn);
+        void ArmHoldTimer();
+        void HandleIncomingBatch(const std::shared_ptr<UDPConnection>& conn, const int count);
+        bool FlushTXQueue(const std::shared_ptr<UDPConnection>& conn);
+        void ClearTXQueue();
+        void SendPackage(const std::shared_ptr<UDPConnection>& conn, const PackageHandle& package, const size_t pkgSz);
+        void Retransmit(const std::shared_ptr<UDPConnection>& conn);
+        void ClearTXHistory();
+        void SendParity(const std::shared_ptr<UDPConnection>& conn);
+        void SendProbe(const std::shared_ptr<UDPConnection>& conn);
         void HandleError(const std::string& message);
         void HandleError(int ec, const std::string& message);
         void OnSendPackage(const ISendPackageMessage& message);
         void OnConnected(const IConnectedMessage& message);
+        void OnStats();
+        void URingWorker();
     public:
-        UDPTransport(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config);
+        UDPTransport(std::shared_ptr<ILogger>& logger, IMessageSender& sender, const IConfig& config, PackagePool& packagePool, PathSelector& pathSelector);
         //methods for ISubscriber
         bool ReadyForMessage(const MsgType msgType) final;
         void OnMessage(const void* const source, const IMessage& message) final;
+        //run transport inside event loop instead of separate thread
+        bool Attach(IEventLoop& loop);
+        void Detach();
+        //IEventHandler
+        void OnEvent(const int fd, const uint32_t events) final;
     protected:
         //WorkerBase
         void Worker() final;
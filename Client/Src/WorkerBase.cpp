@@ -1,5 +1,8 @@
 #include "WorkerBase.h"
 
+#include <pthread.h>
+#include <cerrno>
+
 bool WorkerBase::Startup()
 {
     const std::lock_guard<std::mutex> guard(workerLock);
@@ -29,3 +32,31 @@ bool WorkerBase::RequestShutdown()
     OnShutdown();
     return true;
 }
+
+int WorkerBase::ApplyThreadParams(const ThreadParams& params)
+{
+    const std::lock_guard<std::mutex> guard(workerLock);
+    if(!workerStarted)
+        return ESRCH;
+    const auto handle=worker->native_handle();
+    int result=0;
+    if(!params.name.empty())
+        result=pthread_setname_np(handle,params.name.substr(0,15).c_str());
+    if(params.policy!=SCHED_OTHER)
+    {
+        sched_param sp={};
+        sp.sched_priority=params.priority;
+        auto sr=pthread_setschedparam(handle,params.policy,&sp);
+        result=result!=0?result:sr;
+    }
+    if(!params.cpus.empty())
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for(const auto cpu:params.cpus)
+            CPU_SET(static_cast<size_t>(cpu),&cpuSet);
+        auto ar=pthread_setaffinity_np(handle,sizeof(cpuSet),&cpuSet);
+        result=result!=0?result:ar;
+    }
+    return result;
+}
@@ -4,6 +4,17 @@
 #include "thread"
 #include "mutex"
 #include <memory>
+#include <string>
+#include <vector>
+#include <sched.h>
+
+struct ThreadParams
+{
+    std::string name; //up to 15 chars, longer names are truncated
+    int policy=SCHED_OTHER; //SCHED_OTHER, SCHED_FIFO or SCHED_RR
+    int priority=0; //static priority for SCHED_FIFO and SCHED_RR
+    std::vector<int> cpus; //CPU affinity, empty - do not change
+};
 
 class WorkerBase
 {
@@ -18,6 +29,7 @@ class WorkerBase
         virtual bool Startup(); //start separate thread from Worker method. Startup may be called from any thread
         virtual bool Shutdown(); //stop previously started thread, by invoking OnShutdown and awaiting Worker thread to complete
         virtual bool RequestShutdown(); //same as Shutdown, but only invoke OnShutdown and do not wait. Shutdown should be called next to collect thread
+        int ApplyThreadParams(const ThreadParams &params); //set name, scheduling policy and affinity for started thread, returns 0 or error code of the first failed operation
 };
 
 #endif // IWORKER_H
@@ -0,0 +1,10 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+//assertion that stays enabled with NDEBUG of release build, test is failed at the first failed check
+#define CHECK(condition) do { if(!(condition)) { std::fprintf(stderr,"%s:%d: check failed: %s\n",__FILE__,__LINE__,#condition); std::exit(1); } } while(false)
+
+#endif // CHECK_H
@@ -0,0 +1,139 @@
+//package codec round-trip for every package format of the firmware board profiles: layout offsets, command headers,
+//NACK block, path sequence, payload placement and payload CRC
+
+#include "Command.h"
+#include "Check.h"
+
+#include <algorithm>
+#include <vector>
+
+template<typename Layout>
+static void TestHeaders(const uint8_t features, std::vector<uint8_t> &buffer)
+{
+    const auto portCount=Layout::GetPortCount();
+    std::fill(buffer.begin(),buffer.end(),0xAA);
+    WriteU16Value(0xC1C2,buffer.data());
+    WriteU32Value(0xD1D2D3D4,buffer.data()+PKG_CNT_OFFSET);
+    //all fields are written first with values using every byte, so overlapping fields are detected on read
+    for(uint8_t i=0;i<portCount;++i)
+        WriteCmdHeader(buffer.data(),i,features,static_cast<uint8_t>(RespType::Data),static_cast<uint8_t>(0x80|i),
+                       static_cast<uint16_t>((features&PKG_FEAT_LEN16)?0x0181+i:0x81+i),static_cast<uint16_t>(0xE1E2+i));
+    if(features&PKG_FEAT_NACK)
+        WriteNack(buffer.data(),portCount,features,0xFFFE,0xF3);
+    if(features&PKG_FEAT_DUAL)
+        WritePathSeq(buffer.data(),portCount,features,0xB1B2);
+    for(uint8_t i=0;i<portCount;++i)
+    {
+        const auto response=Response::Map(i,features,buffer.data());
+        CHECK(response.type==RespType::Data);
+        CHECK(response.arg==(0x80|i));
+        CHECK(response.plSz==((features&PKG_FEAT_LEN16)?0x0181+i:0x81+i));
+        CHECK(response.counter==0xD1D2D3D4);
+        CHECK(response.credits==((features&PKG_FEAT_CREDITS)?0xE1E2+i:0));
+    }
+    uint16_t seq=0;
+    if(features&PKG_FEAT_NACK)
+    {
+        CHECK(ReadNack(buffer.data(),portCount,features,seq)==0xF3);
+        CHECK(seq==0xFFFE);
+    }
+    if(features&PKG_FEAT_DUAL)
+        CHECK(ReadPathSeq(buffer.data(),portCount,features)==0xB1B2);
+    CHECK(buffer[0]==0xC2 && buffer[1]==0xC1);
+    //metadata ends right before its CRC, nothing is written past it
+    for(size_t i=Layout::GetMetaSize(features);i<buffer.size();++i)
+        CHECK(buffer[i]==0xAA);
+}
+
+template<typename Layout>
+static void TestPackage(const uint8_t features, std::vector<uint8_t> &buffer)
+{
+    const auto portCount=Layout::GetPortCount();
+    const auto payloadSize=Layout::GetPayloadSize();
+    const bool varLen=features&PKG_FEAT_VARLEN;
+    std::fill(buffer.begin(),buffer.end(),0);
+    //requests with payload of different size for every port, placed like DataProcessor does
+    size_t offset=Layout::GetPortOffset(features,0);
+    int payloadSum=0;
+    for(uint8_t i=0;i<portCount;++i)
+    {
+        const auto plSz=static_cast<uint16_t>((i*37+5)%payloadSize+1);
+        const auto plOffset=varLen?offset:Layout::GetPortOffset(features,i);
+        for(uint16_t b=0;b<plSz;++b)
+            buffer[plOffset+b]=static_cast<uint8_t>(i+b);
+        Request::Write(Request{ReqType::Data,0,plSz},i,features,buffer.data());
+        offset+=plSz;
+        payloadSum+=plSz;
+    }
+    const size_t pkgSz=varLen?offset:Layout::GetPackageSize(features);
+    CHECK(pkgSz<=Layout::GetPackageSize(features));
+    CHECK(Response::PayloadSize(portCount,features,payloadSize,buffer.data())==payloadSum);
+    CHECK(Response::PayloadSize(portCount,features,1,buffer.data())==-1);
+
+    //payload is read back from the same place by the receiving side
+    offset=Layout::GetPortOffset(features,0);
+    for(uint8_t i=0;i<portCount;++i)
+    {
+        const auto request=Response::Map(i,features,buffer.data());
+        CHECK(request.type==static_cast<RespType>(ReqType::Data));
+        const auto plOffset=varLen?offset:Layout::GetPortOffset(features,i);
+        for(uint16_t b=0;b<request.plSz;++b)
+            CHECK(buffer[plOffset+b]==static_cast<uint8_t>(i+b));
+        offset+=request.plSz;
+    }
+
+    if(!(features&PKG_FEAT_PLCRC))
+        return;
+    const auto metaSz=static_cast<int>(Layout::GetMetaSize(features));
+    WritePayloadCRC(metaSz,pkgSz,buffer.data());
+    CHECK(VerifyPayloadCRC(metaSz,pkgSz,buffer.data()));
+    buffer[pkgSz-1]^=0x01;
+    CHECK(!VerifyPayloadCRC(metaSz,pkgSz,buffer.data()));
+    buffer[pkgSz-1]^=0x01;
+    //metadata CRC is not covered by payload CRC, so it may be written after it
+    buffer[static_cast<size_t>(metaSz)]^=0xFF;
+    CHECK(VerifyPayloadCRC(metaSz,pkgSz,buffer.data()));
+}
+
+template<typename Layout>
+static void TestLayout()
+{
+    std::vector<uint8_t> buffer(Layout::GetUDPPackageSizeMax());
+    for(int value=0;value<0x100;++value)
+    {
+        const auto features=static_cast<uint8_t>(value);
+        if((features&PKG_FEAT_SHARED) && !(features&PKG_FEAT_VARLEN))
+            continue;
+        //compile-time layout used by specialized codecs matches the runtime one
+        const auto portCount=Layout::GetPortCount();
+        const auto payloadSize=Layout::GetPayloadSize();
+        CHECK(Layout::GetPackageSize(features)==PackageSize(portCount,payloadSize,features));
+        CHECK(Layout::GetPayloadOffset(features)==Layout::GetMetaSize(features)+META_CRC_SZ);
+        for(uint8_t i=0;i<portCount;++i)
+            CHECK(Layout::GetPortOffset(features,i)==PortOffset(portCount,payloadSize,features,i));
+        CHECK(Layout::GetPackageSize(features)<=Layout::GetPackageSizeMax());
+        TestHeaders<Layout>(features,buffer);
+        TestPackage<Layout>(features,buffer);
+    }
+}
+
+static void TestParityHeader()
+{
+    uint8_t buffer[FEC_HDR_SIZE+1]={};
+    WriteParityHeader(buffer,0xFFF0,0x0123,FEC_GROUP_MAX);
+    CHECK(IsParityPackage(buffer,sizeof(buffer)));
+    CHECK(!IsParityPackage(buffer,FEC_HDR_SIZE));
+    uint16_t firstSeq=0;
+    uint16_t sizeXor=0;
+    CHECK(ReadParityHeader(buffer,firstSeq,sizeXor)==FEC_GROUP_MAX);
+    CHECK(firstSeq==0xFFF0);
+    CHECK(sizeXor==0x0123);
+}
+
+int main()
+{
+    TestLayout<ProMiniLayout>();
+    TestLayout<Mega2560Layout>();
+    TestParityHeader();
+    return 0;
+}
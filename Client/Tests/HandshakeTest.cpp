@@ -0,0 +1,205 @@
+//connect-time handshake against the firmware built for the host: client with HELLO/SELECT, then legacy client sending the first request
+//right after connection, both must open the port, get serial loopback data back and have every request counter echoed
+
+#include "Command.h"
+#include "CRC8.h"
+#include "Check.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+//TCP_PORT of the firmware configuration
+#define FIRMWARE_TCP_PORT 50000
+//serial port mode used by the client by default, SERIAL_8N1
+#define PORT_MODE 6
+
+struct Session
+{
+    int fd;
+    uint8_t features;
+    uint8_t portCount;
+    uint16_t payloadSize;
+};
+
+static pid_t firmwarePid=-1;
+
+static void StopFirmware()
+{
+    if(firmwarePid<0)
+        return;
+    kill(firmwarePid,SIGTERM);
+    waitpid(firmwarePid,nullptr,0);
+    firmwarePid=-1;
+}
+
+static int Connect(const char * const addr)
+{
+    sockaddr_in sockAddr={};
+    sockAddr.sin_family=AF_INET;
+    sockAddr.sin_port=htons(FIRMWARE_TCP_PORT);
+    CHECK(inet_pton(AF_INET,addr,&sockAddr.sin_addr)==1);
+    //firmware may be still starting
+    const auto deadline=std::chrono::steady_clock::now()+std::chrono::seconds(5);
+    while(std::chrono::steady_clock::now()<deadline)
+    {
+        const int fd=socket(AF_INET,SOCK_STREAM,0);
+        CHECK(fd>=0);
+        if(connect(fd,reinterpret_cast<sockaddr*>(&sockAddr),sizeof(sockAddr))==0)
+        {
+            const int noDelay=1;
+            setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&noDelay,sizeof(noDelay));
+            timeval timeout={3,0};
+            setsockopt(fd,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+            return fd;
+        }
+        close(fd);
+        usleep(50000);
+    }
+    CHECK(!"firmware is not accepting connections");
+    return -1;
+}
+
+static void Send(const int fd, const uint8_t * const data, const size_t size)
+{
+    CHECK(send(fd,data,size,MSG_NOSIGNAL)==static_cast<ssize_t>(size));
+}
+
+static void Receive(const int fd, uint8_t * const data, const size_t size)
+{
+    CHECK(recv(fd,data,size,MSG_WAITALL)==static_cast<ssize_t>(size));
+}
+
+//request with the command for the first port, other ports are idle
+static void SendRequest(const Session &session, const uint32_t counter, const ReqType type, const uint8_t arg, const std::vector<uint8_t> &payload)
+{
+    const bool varLen=session.features&PKG_FEAT_VARLEN;
+    const auto metaSz=MetaSize(session.portCount,session.features);
+    std::vector<uint8_t> package(PackageSize(session.portCount,session.payloadSize,session.features));
+    //zero UDP port keeps responses on TCP
+    WriteU16Value(0,package.data());
+    WriteU32Value(counter,package.data()+PKG_CNT_OFFSET);
+    Request::Write(Request{type,arg,static_cast<uint16_t>(payload.size())},0,session.features,package.data());
+    for(uint8_t i=1;i<session.portCount;++i)
+        Request::Write(Request{ReqType::NoCommand,0,0},i,session.features,package.data());
+    std::copy(payload.begin(),payload.end(),package.begin()+PortOffset(session.portCount,session.payloadSize,session.features,0));
+    if(varLen)
+        package.resize(PayloadOffset(session.portCount,session.features)+payload.size());
+    if(session.features&PKG_FEAT_PLCRC)
+        WritePayloadCRC(metaSz,package.size(),package.data());
+    package[metaSz]=CRC8(package.data(),metaSz);
+    Send(session.fd,package.data(),package.size());
+}
+
+//returns counter of the next response, data of the first port is appended to portData
+static uint32_t ReceiveResponse(const Session &session, std::string &portData)
+{
+    const auto metaSz=MetaSize(session.portCount,session.features);
+    std::vector<uint8_t> package(PackageSize(session.portCount,session.payloadSize,session.features));
+    size_t pkgSz=(session.features&PKG_FEAT_VARLEN)?PayloadOffset(session.portCount,session.features):package.size();
+    Receive(session.fd,package.data(),pkgSz);
+    CHECK(CRC8(package.data(),metaSz)==package[metaSz]);
+    const auto payloadSum=Response::PayloadSize(session.portCount,session.features,session.payloadSize,package.data());
+    CHECK(payloadSum>=0);
+    if(session.features&PKG_FEAT_VARLEN)
+    {
+        Receive(session.fd,package.data()+pkgSz,static_cast<size_t>(payloadSum));
+        pkgSz+=static_cast<size_t>(payloadSum);
+    }
+    if(session.features&PKG_FEAT_PLCRC)
+        CHECK(VerifyPayloadCRC(metaSz,pkgSz,package.data()));
+    const auto response=Response::Map(0,session.features,package.data());
+    if(response.type==RespType::Data)
+    {
+        const auto data=package.data()+PortOffset(session.portCount,session.payloadSize,session.features,0);
+        portData.append(reinterpret_cast<const char*>(data),response.plSz);
+    }
+    return response.counter;
+}
+
+static void ExchangeRequests(const Session &session)
+{
+    std::string portData;
+    //poll interval and default aggregate multiplier are sent with the port open request
+    const uint32_t speed=115200;
+    SendRequest(session,1000,ReqType::Open,PORT_MODE,{speed&0xFF,(speed>>8)&0xFF,(speed>>16)&0xFF,speed>>24});
+    while(ReceiveResponse(session,portData)!=0);
+    //serial port of the host firmware loops data back
+    const std::string ping="ping";
+    SendRequest(session,1,ReqType::Data,0,std::vector<uint8_t>(ping.begin(),ping.end()));
+    for(int i=0;i<100 && portData.size()<ping.size();++i)
+        ReceiveResponse(session,portData);
+    CHECK(portData==ping);
+    //every request is processed in order, so the stream stays aligned at package boundaries
+    for(uint32_t counter=2;counter<10;++counter)
+    {
+        SendRequest(session,counter,ReqType::NoCommand,0,{});
+        int responses=0;
+        while(ReceiveResponse(session,portData)!=counter)
+            CHECK(++responses<100);
+    }
+    CHECK(portData==ping);
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc<3)
+    {
+        std::fprintf(stderr,"Usage: %s <firmware built for the host> <IPv4 address to bind it>\n",argv[0]);
+        return 1;
+    }
+    char * const firmwareArgs[]={argv[1],argv[2],nullptr};
+    CHECK(posix_spawn(&firmwarePid,argv[1],nullptr,nullptr,firmwareArgs,environ)==0);
+    std::atexit(StopFirmware);
+
+    //client with handshake support selects package format from features announced with hello
+    Session session={Connect(argv[2]),0,0,0};
+    uint8_t helloRequest[HELLO_REQUEST_SIZE];
+    HelloRequest::Write(helloRequest);
+    Send(session.fd,helloRequest,sizeof(helloRequest));
+    uint8_t helloBuff[HELLO_SIZE];
+    Receive(session.fd,helloBuff,sizeof(helloBuff));
+    Hello hello={};
+    CHECK(Hello::Map(helloBuff,hello));
+    CHECK((hello.portCount==ProMiniLayout::GetPortCount() && hello.payloadSize==ProMiniLayout::GetPayloadSize()) ||
+          (hello.portCount==Mega2560Layout::GetPortCount() && hello.payloadSize==Mega2560Layout::GetPayloadSize()));
+    CHECK(hello.aggregateMultiplier>0);
+    CHECK(hello.ioSize*hello.aggregateMultiplier<=hello.payloadSize);
+    session.portCount=hello.portCount;
+    session.payloadSize=hello.payloadSize;
+    session.features=hello.features&(PKG_FEAT_VARLEN|PKG_FEAT_CREDITS|PKG_FEAT_PLCRC);
+    CHECK(session.features&PKG_FEAT_VARLEN);
+    uint8_t select[SELECT_SIZE];
+    Select::Write(Select{session.features},select);
+    Send(session.fd,select,sizeof(select));
+    ExchangeRequests(session);
+    close(session.fd);
+
+    //legacy client sends the first fixed-size request right after connection, part of it is read as hello request
+    session.fd=Connect(argv[2]);
+    session.features=0;
+    ExchangeRequests(session);
+    close(session.fd);
+
+    //invalid hello request is dropped without reply
+    session.fd=Connect(argv[2]);
+    helloRequest[2]=HS_VERSION+1;
+    helloRequest[HELLO_REQUEST_SIZE-1]=CRC8(helloRequest,HELLO_REQUEST_SIZE-1);
+    Send(session.fd,helloRequest,sizeof(helloRequest));
+    CHECK(recv(session.fd,helloBuff,sizeof(helloBuff),0)==0);
+    close(session.fd);
+
+    //firmware must not be restarted by watchdog on any of the sessions
+    CHECK(waitpid(firmwarePid,nullptr,WNOHANG)==0);
+    return 0;
+}
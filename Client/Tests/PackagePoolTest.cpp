@@ -0,0 +1,102 @@
+//package pool: reference counting of package handles, exhaustion and reuse of released buffers
+
+#include "PackagePool.h"
+#include "Check.h"
+
+#include <thread>
+#include <utility>
+#include <vector>
+
+static void TestRefCounting()
+{
+    PackagePool pool(16,2);
+    CHECK(pool.GetPackageSize()==16);
+    CHECK(!PackageHandle().IsValid());
+    CHECK(!PackageHandle().IsUnique());
+
+    auto first=pool.Acquire();
+    CHECK(first.IsValid());
+    CHECK(first.IsUnique());
+    CHECK(pool.GetUsedCount()==1);
+    {
+        //copies share the buffer, it is not unique until they are released
+        const auto copy=first;
+        CHECK(copy.Get()==first.Get());
+        CHECK(!first.IsUnique());
+        PackageHandle assigned;
+        assigned=copy;
+        CHECK(!assigned.IsUnique());
+        CHECK(pool.GetUsedCount()==1);
+    }
+    CHECK(first.IsUnique());
+
+    //moved handle transfers ownership without changing reference count
+    auto moved=std::move(first);
+    CHECK(!first.IsValid());
+    CHECK(moved.IsUnique());
+    PackageHandle moveAssigned;
+    moveAssigned=std::move(moved);
+    CHECK(!moved.IsValid());
+    CHECK(moveAssigned.IsUnique());
+
+    //self-assignment keeps the reference
+    auto &self=moveAssigned;
+    moveAssigned=self;
+    CHECK(moveAssigned.IsUnique());
+
+    //pool is exhausted while both buffers are owned
+    auto second=pool.Acquire();
+    CHECK(second.IsValid());
+    CHECK(second.Get()!=moveAssigned.Get());
+    CHECK(pool.GetUsedCount()==2);
+    CHECK(!pool.Acquire().IsValid());
+
+    //assignment releases the previous buffer of the target
+    const auto secondBuffer=second.Get();
+    second=moveAssigned;
+    CHECK(pool.GetUsedCount()==1);
+    const auto third=pool.Acquire();
+    CHECK(third.Get()==secondBuffer);
+    CHECK(third.IsUnique());
+
+    //buffer returns to the pool only after the last owner is released
+    moveAssigned=PackageHandle();
+    CHECK(pool.GetUsedCount()==2);
+    CHECK(second.IsUnique());
+    second=PackageHandle();
+    CHECK(pool.GetUsedCount()==1);
+}
+
+static void TestConcurrentOwners()
+{
+    //package is shared by transports running at different threads, as with dual path delivery
+    PackagePool pool(8,4);
+    std::vector<PackageHandle> packages;
+    for(int i=0;i<4;++i)
+        packages.push_back(pool.Acquire());
+    CHECK(!pool.Acquire().IsValid());
+    std::vector<std::thread> threads;
+    for(int t=0;t<4;++t)
+        threads.emplace_back([&packages]()
+        {
+            for(int i=0;i<100000;++i)
+            {
+                const auto copy=packages[static_cast<size_t>(i)%packages.size()];
+                CHECK(copy.IsValid());
+            }
+        });
+    for(auto &thread:threads)
+        thread.join();
+    for(const auto &package:packages)
+        CHECK(package.IsUnique());
+    packages.clear();
+    CHECK(pool.GetUsedCount()==0);
+    CHECK(pool.Acquire().IsValid());
+}
+
+int main()
+{
+    TestRefCounting();
+    TestConcurrentOwners();
+    return 0;
+}
@@ -0,0 +1,85 @@
+//automatic data path selection: move to TCP after single degraded probe round, delayed while UDP packages are held,
+//and return to UDP only after PATH_RECOVERY_ROUNDS good rounds in a row
+
+#include "PathSelector.h"
+#include "Config.h"
+#include "Command.h"
+#include "StdioLoggerFactory.h"
+#include "Check.h"
+
+//sends a round of probes echoing all but the first lost ones, previous round is evaluated with the first probe
+static void ProbeRound(PathSelector &selector, const size_t lost, const bool udpSettled=true)
+{
+    uint8_t probe[PROBE_SIZE];
+    for(size_t i=0;i<PATH_PROBE_ROUND;++i)
+    {
+        while(!selector.ProbeDue(udpSettled));
+        selector.WriteProbe(probe,0,0);
+        if(i>=lost)
+            CHECK(selector.OnProbeEcho(probe,PROBE_SIZE));
+    }
+}
+
+int main()
+{
+    StdioLoggerFactory logFactory;
+    auto logger=logFactory.CreateLogger("PathSelector");
+    Config config;
+    //round-trip time of loopback echoes is not evaluated, degraded above 20% loss, good at 10% loss or less
+    config.SetAutoPathLossPercent(20);
+    config.SetAutoPathRTTMS(0);
+    PathSelector selector(logger,config);
+
+    //corrupted probe is not taken for echo
+    uint8_t probe[PROBE_SIZE];
+    selector.WriteProbe(probe,0,0);
+    probe[0]^=0xFF;
+    CHECK(!selector.OnProbeEcho(probe,PROBE_SIZE));
+    selector.Reset();
+
+    //first round after reset is not evaluated
+    ProbeRound(selector,PATH_PROBE_ROUND);
+    ProbeRound(selector,0);
+    CHECK(!selector.UseTCP());
+
+    //loss between the thresholds keeps UDP
+    ProbeRound(selector,3);
+    ProbeRound(selector,0);
+    CHECK(selector.GetLossPercent()==18);
+    CHECK(!selector.UseTCP());
+
+    //degraded round moves data path to TCP, but not while UDP packages are held awaiting missing ones
+    ProbeRound(selector,8);
+    ProbeRound(selector,0,false);
+    CHECK(selector.GetLossPercent()==50);
+    CHECK(!selector.UseTCP());
+    CHECK(!selector.ProbeDue(true));
+    CHECK(selector.UseTCP());
+    CHECK(selector.GetSwitchToTCPCount()==1);
+
+    //loss between the thresholds is not good enough to return, and restarts counting of good rounds,
+    //round sent just before the move is good, so it is counted first
+    ProbeRound(selector,3);
+    ProbeRound(selector,0);
+    for(int i=0;i<PATH_RECOVERY_ROUNDS;++i)
+    {
+        CHECK(selector.UseTCP());
+        ProbeRound(selector,0);
+    }
+
+    //data path returns to UDP as soon as the last of good rounds in a row is evaluated
+    CHECK(!selector.UseTCP());
+    CHECK(selector.GetSwitchToUDPCount()==1);
+    CHECK(selector.GetSwitchToTCPCount()==1);
+
+    //data path returns to UDP on reconnect
+    ProbeRound(selector,8);
+    ProbeRound(selector,0);
+    CHECK(selector.UseTCP());
+    selector.Reset();
+    CHECK(!selector.UseTCP());
+    ProbeRound(selector,8);
+    ProbeRound(selector,0);
+    CHECK(!selector.UseTCP());
+    return 0;
+}
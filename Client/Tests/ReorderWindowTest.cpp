@@ -0,0 +1,126 @@
+//UDP reorder window: sequence wraparound, late and duplicate packages, window overflow and hold deadline
+
+#include "ReorderWindow.h"
+#include "Check.h"
+
+#include <thread>
+
+static PackagePool pool(2,16);
+
+static PackageHandle MakePackage(const uint16_t seq)
+{
+    auto package=pool.Acquire();
+    CHECK(package.IsValid());
+    package.Get()[0]=static_cast<uint8_t>(seq&0xFF);
+    package.Get()[1]=static_cast<uint8_t>(seq>>8);
+    return package;
+}
+
+static uint16_t PopSeq(ReorderWindow &window)
+{
+    const auto package=window.Pop();
+    CHECK(package.IsValid());
+    return static_cast<uint16_t>(package.Get()[0]|package.Get()[1]<<8);
+}
+
+static void TestWraparound()
+{
+    //hold time is long enough to never pass during the test
+    ReorderWindow window(2,std::chrono::seconds(60));
+    CHECK(window.Push(0xFFFE,MakePackage(0xFFFE)));
+    CHECK(PopSeq(window)==0xFFFE);
+    CHECK(!window.Pop().IsValid());
+
+    //0xFFFF is missing, package after the wraparound is held
+    CHECK(window.Push(0x0000,MakePackage(0x0000)));
+    CHECK(!window.Pop().IsValid());
+    uint16_t missingSeq=0;
+    CHECK(window.GetMissing(missingSeq)==1);
+    CHECK(missingSeq==0xFFFF);
+
+    //missing package arrives, both are delivered in order
+    CHECK(window.Push(0xFFFF,MakePackage(0xFFFF)));
+    CHECK(PopSeq(window)==0xFFFF);
+    CHECK(PopSeq(window)==0x0000);
+    CHECK(!window.Pop().IsValid());
+    CHECK(window.GetMissing(missingSeq)==0);
+    CHECK(window.GetReorderedCount()==1);
+
+    //delivered packages are late across the wraparound too
+    CHECK(!window.Push(0xFFFF,MakePackage(0xFFFF)));
+    CHECK(!window.Push(0x0000,MakePackage(0x0000)));
+    CHECK(window.GetLateCount()==2);
+
+    //held duplicate is dropped
+    CHECK(window.Push(0x0002,MakePackage(0x0002)));
+    CHECK(!window.Push(0x0002,MakePackage(0x0002)));
+    CHECK(window.GetLateCount()==3);
+    CHECK(window.GetLostCount()==0);
+    CHECK(pool.GetUsedCount()==1);
+    window.Reset();
+    CHECK(pool.GetUsedCount()==0);
+}
+
+static void TestOverflow()
+{
+    ReorderWindow window(2,std::chrono::seconds(60));
+    CHECK(window.Push(10,MakePackage(10)));
+    CHECK(PopSeq(window)==10);
+    //11 is missing, window holds 2 packages, the third one skips the missing place
+    CHECK(window.Push(12,MakePackage(12)));
+    CHECK(window.Push(13,MakePackage(13)));
+    CHECK(!window.Pop().IsValid());
+    CHECK(window.Push(14,MakePackage(14)));
+    CHECK(PopSeq(window)==12);
+    CHECK(PopSeq(window)==13);
+    CHECK(PopSeq(window)==14);
+    CHECK(window.GetLostCount()==1);
+    CHECK(!window.Push(11,MakePackage(11)));
+}
+
+static void TestHoldDeadline()
+{
+    const auto holdTime=std::chrono::milliseconds(100);
+    ReorderWindow window(4,holdTime);
+    std::chrono::steady_clock::time_point deadline;
+    CHECK(!window.GetHoldDeadline(deadline));
+    CHECK(window.Push(100,MakePackage(100)));
+    CHECK(PopSeq(window)==100);
+    CHECK(!window.GetHoldDeadline(deadline));
+
+    const auto start=std::chrono::steady_clock::now();
+    CHECK(window.Push(103,MakePackage(103)));
+    CHECK(window.GetHoldDeadline(deadline));
+    CHECK(deadline>=start+holdTime);
+    CHECK(deadline<=std::chrono::steady_clock::now()+holdTime);
+
+    //held package is released only after the deadline, missing ones are counted as lost
+    std::this_thread::sleep_until(deadline-holdTime/2);
+    CHECK(!window.Pop().IsValid());
+    std::this_thread::sleep_until(deadline);
+    CHECK(PopSeq(window)==103);
+    CHECK(window.GetLostCount()==2);
+    CHECK(!window.GetHoldDeadline(deadline));
+
+    //hold time restarts for the next missing package, when the one awaited before is delivered
+    CHECK(window.Push(106,MakePackage(106)));
+    std::this_thread::sleep_for(holdTime/2);
+    CHECK(window.Push(104,MakePackage(104)));
+    CHECK(window.GetReorderedCount()==1);
+    const auto popTime=std::chrono::steady_clock::now();
+    CHECK(PopSeq(window)==104);
+    CHECK(window.GetHoldDeadline(deadline));
+    CHECK(deadline>=popTime+holdTime);
+    CHECK(!window.Pop().IsValid());
+    std::this_thread::sleep_until(deadline);
+    CHECK(PopSeq(window)==106);
+    CHECK(window.GetLostCount()==3);
+}
+
+int main()
+{
+    TestWraparound();
+    TestOverflow();
+    TestHoldDeadline();
+    return 0;
+}
@@ -0,0 +1,4 @@
+// placeholder for Arduino IDE, no real code goes here, see main_loop.cpp for starting point
+
+//this firmware measures CPU cycles spent by package checksums of UARTEthernetBridge firmware on the target MCU,
+//results are printed to the serial port, see main_loop.cpp for more details
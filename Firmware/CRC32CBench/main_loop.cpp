@@ -0,0 +1,94 @@
+#include <Arduino.h>
+#include "main_loop.h"
+#include "crc8.h"
+#include "crc32c.h"
+
+//timer 1 counts CPU cycles without prescaler, so single measurement must not exceed 65535 cycles
+#define MAX_SIZE 256
+#define RUN_COUNT 8
+
+static uint8_t buffer[MAX_SIZE];
+static volatile uint32_t sink;
+
+static uint8_t __attribute__((noinline)) NoCRC(const uint8_t *source, size_t len)
+{
+    return source[len-1];
+}
+
+static uint8_t __attribute__((noinline)) CRC32CLow(const uint8_t *source, size_t len)
+{
+    const uint32_t crc=CRC32C(source,len);
+    sink=crc;
+    return static_cast<uint8_t>(crc);
+}
+
+//minimal cycle count of RUN_COUNT runs with interrupts disabled, 0 on timer overflow
+static uint16_t Measure(uint8_t (*func)(const uint8_t*, size_t), const size_t len)
+{
+    uint16_t best=0xFFFF;
+    for(uint8_t run=0;run<RUN_COUNT;++run)
+    {
+        noInterrupts();
+        TCNT1=0;
+        TIFR1=_BV(TOV1);
+        sink=func(buffer,len);
+        const uint16_t cycles=TCNT1;
+        const bool overflow=TIFR1&_BV(TOV1);
+        interrupts();
+        if(overflow)
+            return 0;
+        if(cycles<best)
+            best=cycles;
+    }
+    return best;
+}
+
+static void Report(const char *name, uint8_t (*func)(const uint8_t*, size_t), const size_t len, const uint16_t overhead)
+{
+    const uint16_t cycles=Measure(func,len);
+    Serial.print(name);
+    Serial.print(' ');
+    Serial.print(len);
+    Serial.print(" bytes: ");
+    if(cycles==0)
+    {
+        Serial.println("timer overflow");
+        return;
+    }
+    const uint16_t net=cycles>overhead?cycles-overhead:0;
+    Serial.print(net);
+    Serial.print(" cycles, ");
+    Serial.print(static_cast<float>(net)/len,2);
+    Serial.print(" cycles/byte, ");
+    Serial.print(static_cast<float>(net)*1000000.0f/F_CPU,1);
+    Serial.println(" us");
+}
+
+void setup()
+{
+    Serial.begin(115200,SERIAL_8N1);
+    for(size_t i=0;i<MAX_SIZE;++i)
+        buffer[i]=static_cast<uint8_t>(i*131+7);
+    //timer 1 in normal mode, clocked by CPU clock
+    TCCR1A=0;
+    TCCR1B=_BV(CS10);
+    TIMSK1=0;
+}
+
+void loop()
+{
+    //call and timer read overhead is subtracted from results
+    const uint16_t overhead=Measure(NoCRC,1);
+    Serial.print("F_CPU: ");
+    Serial.print(F_CPU);
+    Serial.print(", overhead: ");
+    Serial.print(overhead);
+    Serial.println(" cycles");
+    const size_t sizes[]={16,50,128,150,256};
+    for(const auto len:sizes)
+    {
+        Report("CRC8",CRC8,len,overhead);
+        Report("CRC32C",CRC32CLow,len,overhead);
+    }
+    delay(5000);
+}
@@ -0,0 +1,15 @@
+#ifndef MAIN_LOOP_H
+#define MAIN_LOOP_H
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+void setup();
+void loop();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+//minimal Arduino API for building the firmware on the host, board profile is selected with ARDUINO_AVR_* define of the build
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LED_BUILTIN 13
+#define PIN_SPI_SS 53
+#define PIN_SPI_MISO 50
+#define PIN_SPI_MOSI 51
+#define PIN_SPI_SCK 52
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t*>(addr))
+
+typedef bool boolean;
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+//serial port is looped back: data written to it is read back
+class HardwareSerial
+{
+    private:
+        uint8_t buffer[256];
+        size_t used;
+    public:
+        HardwareSerial();
+        void begin(unsigned long speed, uint8_t mode);
+        void end();
+        int available();
+        int availableForWrite();
+        size_t write(const uint8_t *data, size_t size);
+        size_t readBytes(uint8_t *data, size_t size);
+        void setTimeout(unsigned long timeout);
+};
+
+extern HardwareSerial Serial, Serial1, Serial2, Serial3;
+
+#endif
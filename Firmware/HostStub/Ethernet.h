@@ -0,0 +1,21 @@
+#ifndef ETHERNET_H
+#define ETHERNET_H
+
+#include <EthernetServer.h>
+#include <EthernetUdp.h>
+
+enum EthernetHardwareStatus { EthernetNoHardware, EthernetENC28J60 };
+enum EthernetLinkStatus { Unknown, LinkON, LinkOFF };
+
+class EthernetClass
+{
+    public:
+        void init(uint8_t csPin);
+        int begin(uint8_t *mac);
+        EthernetHardwareStatus hardwareStatus();
+        EthernetLinkStatus linkStatus();
+};
+
+extern EthernetClass Ethernet;
+
+#endif
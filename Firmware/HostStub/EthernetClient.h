@@ -0,0 +1,22 @@
+#ifndef ETHERNETCLIENT_H
+#define ETHERNETCLIENT_H
+
+#include <IPAddress.h>
+
+class EthernetClient
+{
+    private:
+        int fd;
+    public:
+        EthernetClient();
+        EthernetClient(int _fd);
+        operator bool();
+        int available();
+        int read(uint8_t *buffer, size_t size);
+        size_t write(const uint8_t *buffer, size_t size);
+        bool connected();
+        void stop();
+        IPAddress remoteIP();
+};
+
+#endif
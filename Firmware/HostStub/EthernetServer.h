@@ -0,0 +1,17 @@
+#ifndef ETHERNETSERVER_H
+#define ETHERNETSERVER_H
+
+#include <EthernetClient.h>
+
+class EthernetServer
+{
+    private:
+        const uint16_t port;
+        int fd;
+    public:
+        EthernetServer(uint16_t _port);
+        void begin();
+        EthernetClient accept();
+};
+
+#endif
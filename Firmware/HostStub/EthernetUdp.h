@@ -0,0 +1,33 @@
+#ifndef ETHERNETUDP_H
+#define ETHERNETUDP_H
+
+#include <IPAddress.h>
+
+class EthernetUDP
+{
+    private:
+        int fd;
+        uint8_t rxBuff[2048];
+        size_t rxSize;
+        size_t rxPos;
+        uint32_t rxAddr;
+        uint16_t rxPort;
+        uint8_t txBuff[2048];
+        size_t txSize;
+        uint32_t txAddr;
+        uint16_t txPort;
+    public:
+        EthernetUDP();
+        uint8_t begin(uint16_t port);
+        void stop();
+        int parsePacket();
+        int read(uint8_t *buffer, size_t size);
+        void flush();
+        uint16_t remotePort();
+        IPAddress remoteIP();
+        int beginPacket(IPAddress ip, uint16_t port);
+        size_t write(const uint8_t *buffer, size_t size);
+        int endPacket();
+};
+
+#endif
@@ -0,0 +1,264 @@
+//Arduino API backed by host sockets, so the firmware may be run on the host as remote side for the client:
+//ethernet server and UDP are bound to the address from command line (127.0.0.2 by default, so UDP port requested by client
+//on the same host does not collide with it's own socket), serial ports are looped back, watchdog is never armed
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+#include "main_loop.h"
+#include "watchdog_AVR.h"
+
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static in_addr bindAddr;
+
+static uint64_t MonotonicUS()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return static_cast<uint64_t>(ts.tv_sec)*1000000U+static_cast<uint64_t>(ts.tv_nsec)/1000U;
+}
+
+static const uint64_t startTime=MonotonicUS();
+
+//wrap around like on the board
+unsigned long micros() { return static_cast<unsigned long>(static_cast<uint32_t>(MonotonicUS()-startTime)); }
+unsigned long millis() { return static_cast<unsigned long>(static_cast<uint32_t>((MonotonicUS()-startTime)/1000U)); }
+void delay(unsigned long ms) { usleep(static_cast<useconds_t>(ms*1000U)); }
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+
+HardwareSerial Serial, Serial1, Serial2, Serial3;
+
+HardwareSerial::HardwareSerial():used(0) {}
+void HardwareSerial::begin(unsigned long, uint8_t) { used=0; }
+void HardwareSerial::end() {}
+int HardwareSerial::available() { return static_cast<int>(used); }
+int HardwareSerial::availableForWrite() { return static_cast<int>(sizeof(buffer)-used); }
+void HardwareSerial::setTimeout(unsigned long) {}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t size)
+{
+    if(size>sizeof(buffer)-used)
+        size=sizeof(buffer)-used;
+    memcpy(buffer+used,data,size);
+    used+=size;
+    return size;
+}
+
+size_t HardwareSerial::readBytes(uint8_t *data, size_t size)
+{
+    if(size>used)
+        size=used;
+    memcpy(data,buffer,size);
+    memmove(buffer,buffer+size,used-size);
+    used-=size;
+    return size;
+}
+
+EthernetClass Ethernet;
+
+void EthernetClass::init(uint8_t) {}
+int EthernetClass::begin(uint8_t*) { return 1; }
+EthernetHardwareStatus EthernetClass::hardwareStatus() { return EthernetENC28J60; }
+EthernetLinkStatus EthernetClass::linkStatus() { return LinkON; }
+
+EthernetServer::EthernetServer(uint16_t _port):port(_port),fd(-1) {}
+
+void EthernetServer::begin()
+{
+    fd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK,0);
+    const int reuse=1;
+    setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&reuse,sizeof(reuse));
+    sockaddr_in addr={};
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons(port);
+    addr.sin_addr=bindAddr;
+    if(bind(fd,reinterpret_cast<sockaddr*>(&addr),sizeof(addr))!=0||listen(fd,1)!=0)
+    {
+        perror("Failed to start TCP server");
+        exit(1);
+    }
+}
+
+EthernetClient EthernetServer::accept()
+{
+    const int clientFd=accept4(fd,nullptr,nullptr,SOCK_NONBLOCK);
+    if(clientFd<0)
+        return EthernetClient();
+    //ethernet adapter sends every write as separate segment
+    const int noDelay=1;
+    setsockopt(clientFd,IPPROTO_TCP,TCP_NODELAY,&noDelay,sizeof(noDelay));
+    return EthernetClient(clientFd);
+}
+
+EthernetClient::EthernetClient():fd(-1) {}
+EthernetClient::EthernetClient(int _fd):fd(_fd) {}
+EthernetClient::operator bool() { return fd>=0; }
+
+int EthernetClient::available()
+{
+    int avail=0;
+    return ioctl(fd,FIONREAD,&avail)==0?avail:0;
+}
+
+int EthernetClient::read(uint8_t *buffer, size_t size)
+{
+    const auto dr=recv(fd,buffer,size,0);
+    return dr>0?static_cast<int>(dr):0;
+}
+
+size_t EthernetClient::write(const uint8_t *buffer, size_t size)
+{
+    size_t dw=0;
+    while(dw<size)
+    {
+        const auto result=send(fd,buffer+dw,size-dw,MSG_NOSIGNAL);
+        if(result<0&&errno==EAGAIN)
+            continue;
+        if(result<0)
+            break;
+        dw+=static_cast<size_t>(result);
+    }
+    return dw;
+}
+
+bool EthernetClient::connected()
+{
+    uint8_t data;
+    const auto result=recv(fd,&data,1,MSG_PEEK);
+    return result>0||(result<0&&errno==EAGAIN);
+}
+
+void EthernetClient::stop()
+{
+    if(fd>=0)
+        close(fd);
+    fd=-1;
+}
+
+IPAddress EthernetClient::remoteIP()
+{
+    sockaddr_in addr={};
+    socklen_t len=sizeof(addr);
+    getpeername(fd,reinterpret_cast<sockaddr*>(&addr),&len);
+    return IPAddress(addr.sin_addr.s_addr);
+}
+
+EthernetUDP::EthernetUDP():fd(-1),rxSize(0),rxPos(0),rxAddr(0),rxPort(0),txSize(0),txAddr(0),txPort(0) {}
+
+uint8_t EthernetUDP::begin(uint16_t port)
+{
+    fd=socket(AF_INET,SOCK_DGRAM|SOCK_NONBLOCK,0);
+    sockaddr_in addr={};
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons(port);
+    addr.sin_addr=bindAddr;
+    if(bind(fd,reinterpret_cast<sockaddr*>(&addr),sizeof(addr))==0)
+        return 1;
+    perror("Failed to start UDP server");
+    stop();
+    return 0;
+}
+
+void EthernetUDP::stop()
+{
+    if(fd>=0)
+        close(fd);
+    fd=-1;
+}
+
+int EthernetUDP::parsePacket()
+{
+    if(fd<0)
+        return 0;
+    sockaddr_in addr={};
+    socklen_t len=sizeof(addr);
+    const auto dr=recvfrom(fd,rxBuff,sizeof(rxBuff),0,reinterpret_cast<sockaddr*>(&addr),&len);
+    if(dr<=0)
+        return 0;
+    rxSize=static_cast<size_t>(dr);
+    rxPos=0;
+    rxAddr=addr.sin_addr.s_addr;
+    rxPort=ntohs(addr.sin_port);
+    return static_cast<int>(rxSize);
+}
+
+int EthernetUDP::read(uint8_t *buffer, size_t size)
+{
+    if(size>rxSize-rxPos)
+        size=rxSize-rxPos;
+    memcpy(buffer,rxBuff+rxPos,size);
+    rxPos+=size;
+    return static_cast<int>(size);
+}
+
+void EthernetUDP::flush() { rxPos=rxSize; }
+uint16_t EthernetUDP::remotePort() { return rxPort; }
+IPAddress EthernetUDP::remoteIP() { return IPAddress(rxAddr); }
+
+int EthernetUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+    if(fd<0)
+        return 0;
+    txAddr=ip;
+    txPort=port;
+    txSize=0;
+    return 1;
+}
+
+size_t EthernetUDP::write(const uint8_t *buffer, size_t size)
+{
+    if(size>sizeof(txBuff)-txSize)
+        size=sizeof(txBuff)-txSize;
+    memcpy(txBuff+txSize,buffer,size);
+    txSize+=size;
+    return size;
+}
+
+int EthernetUDP::endPacket()
+{
+    sockaddr_in addr={};
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons(txPort);
+    addr.sin_addr.s_addr=txAddr;
+    return sendto(fd,txBuff,txSize,0,reinterpret_cast<sockaddr*>(&addr),sizeof(addr))==static_cast<ssize_t>(txSize);
+}
+
+WatchdogAVR::WatchdogAVR():srBootSig(nullptr),srBootFlag(true),isEnabled(false) {}
+bool WatchdogAVR::IsSystemResetBoot() { return srBootFlag; }
+bool WatchdogAVR::IsEnabled() { return isEnabled; }
+void WatchdogAVR::Enable(uint16_t) { isEnabled=true; }
+void WatchdogAVR::Disable() { isEnabled=false; }
+void WatchdogAVR::Ping() {}
+
+void WatchdogAVR::SystemReset()
+{
+    fprintf(stderr,"System reset requested\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    if(inet_pton(AF_INET,argc>1?argv[1]:"127.0.0.2",&bindAddr)!=1)
+    {
+        fprintf(stderr,"Usage: %s [IPv4 address to bind, default: 127.0.0.2]\n",argv[0]);
+        return 1;
+    }
+    setup();
+    //do not spin a whole core between iterations
+    while(true)
+    {
+        loop();
+        usleep(50);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+
+#include <Arduino.h>
+
+//IPv4 address in network byte order
+class IPAddress
+{
+    private:
+        uint32_t address;
+    public:
+        IPAddress():address(0) {}
+        IPAddress(uint32_t _address):address(_address) {}
+        operator uint32_t() const { return address; }
+};
+
+#define INADDR_NONE 0U
+
+#endif
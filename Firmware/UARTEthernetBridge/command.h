@@ -3,39 +3,70 @@
 
 #include <Arduino.h>
 #include "configuration.h"
+#include "crc32c.h"
+#include "protocol.h"
 
-enum struct ReqType : uint8_t
-{
-    NoCommand = 0x00,
-    Reset = 0x01,
-    Open = 0x02,
-    ResetOpen = 0x03,
-    Close = 0x04,
-    Data = 0x08,
-};
+//package layout for UART_COUNT and DATA_PAYLOAD_SIZE of the board profile, buffers fit only supported package formats
+typedef PackageLayout<UART_COUNT,DATA_PAYLOAD_SIZE,PKG_FEATURES> BoardLayout;
 
-enum struct RespType : uint8_t
-{
-    NoCommand = 0x00,
-    Data = 0x08,
-};
+#if (PKG_FEATURES&PKG_FEAT_SHARED) && !(PKG_FEATURES&PKG_FEAT_VARLEN)
+#error PKG_FEAT_SHARED requires PKG_FEAT_VARLEN
+#endif
+
+#if (PKG_FEATURES&PKG_FEAT_NACK) && (UDP_RETRANSMIT_HISTORY<1 || UDP_REORDER_WINDOW<1)
+#error PKG_FEAT_NACK requires UDP_RETRANSMIT_HISTORY and UDP_REORDER_WINDOW
+#endif
+
+#if (PKG_FEATURES&PKG_FEAT_FEC) && UDP_FEC_GROUP<1
+#error PKG_FEAT_FEC requires UDP_FEC_GROUP
+#endif
 
 struct Request
 {
     ReqType type;
     uint8_t arg;
-    uint8_t plSz;
+    uint16_t plSz;
 };
 
-
-
 struct Response
 {
     RespType type;
     uint8_t arg;
-    uint8_t plSz;
+    uint16_t plSz;
+    uint16_t credits;
 };
 
+inline bool FeaturesValid(const uint8_t features)
+{
+    return (features&~PKG_FEATURES)==0 && (!(features&PKG_FEAT_SHARED) || (features&PKG_FEAT_VARLEN));
+}
+
+//payload CRC is used only if it is supported, so CRC-32C table is not linked otherwise
+inline bool PayloadCRCEnabled(const uint8_t features)
+{
+    return (PKG_FEATURES&PKG_FEAT_PLCRC) && (features&PKG_FEAT_PLCRC);
+}
+
+//payload CRC is stored right before metadata CRC and covers everything after it
+inline uint32_t PayloadCRC(const uint8_t * const rawBuffer, const uint16_t metaSz, const uint16_t pkgSz)
+{
+    return CRC32C(rawBuffer+metaSz+META_CRC_SZ,pkgSz-metaSz-META_CRC_SZ);
+}
+
+inline bool PayloadCRCValid(const uint8_t * const rawBuffer, const uint16_t metaSz, const uint16_t pkgSz)
+{
+    const uint8_t * const crc=rawBuffer+metaSz-PL_CRC_SIZE;
+    return PayloadCRC(rawBuffer,metaSz,pkgSz)==(crc[0]|static_cast<uint32_t>(crc[1])<<8|static_cast<uint32_t>(crc[2])<<16|static_cast<uint32_t>(crc[3])<<24);
+}
 
+inline void WritePayloadCRC(uint8_t * const rawBuffer, const uint16_t metaSz, const uint16_t pkgSz)
+{
+    const uint32_t value=PayloadCRC(rawBuffer,metaSz,pkgSz);
+    uint8_t * const crc=rawBuffer+metaSz-PL_CRC_SIZE;
+    crc[0]=value&0xFF;
+    crc[1]=(value>>8)&0xFF;
+    crc[2]=(value>>16)&0xFF;
+    crc[3]=(value>>24)&0xFF;
+}
 
 #endif // COMMAND_H
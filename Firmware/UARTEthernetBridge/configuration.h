@@ -31,6 +31,8 @@
 
 #define DATA_PAYLOAD_SIZE (PORT_IO_SIZE*IO_AGGREGATE_MULTIPLIER)
 #define DEFAULT_ALARM_INTERVAL_MS 1000
+//poll interval used while client reports idle state, keepalive responses are sent at 1/4 of the alarm interval
+#define UART_POLL_INTERVAL_US_IDLE(aggregate_multiplier) (DEFAULT_ALARM_INTERVAL_MS*1000UL/4/aggregate_multiplier)
 
 //params for ENC28J60 ethernet shield
 #define ENC28J60_MACADDR { 0x00,0x16,0x3E,0x65,0xE3,0x66 }
@@ -46,17 +48,43 @@
 #define NET_NAME "ENC28J65E366"
 #define TCP_PORT 50000
 
+//UDP parity buffers are disabled on both boards by default: with UDP_FEC_GROUP 4 on ARDUINO_AVR_MEGA2560
+//they take about 0.4KiB of static RAM on top of UART_COUNT*DATA_BUFFER_SIZE bytes of ring-buffers, UIPEthernet state
+//reorder window and retransmit history, leaving too little for the stack, ARDUINO_AVR_PRO has no RAM for any of UDP package buffers
+
+//UDP reorder window: count of packages arrived ahead of missing ones held until missing ones arrive,
+//each held package takes BoardLayout::GetPackageSizeMax() bytes of RAM, 0 - drop out-of-order packages
+#ifdef ARDUINO_AVR_MEGA2560
+#define UDP_REORDER_WINDOW 2
+#else
+#define UDP_REORDER_WINDOW 0
+#endif
+//max time to wait for the missing package before it is considered lost
+#define UDP_REORDER_HOLD_MS 16
+//count of last sent UDP packages kept for retransmission on client's request with PKG_FEAT_NACK,
+//each takes BoardLayout::GetPackageSizeMax() bytes of RAM, must cover packages sent while client's request is on the way
+#ifdef ARDUINO_AVR_MEGA2560
+#define UDP_RETRANSMIT_HISTORY 2
+#else
+#define UDP_RETRANSMIT_HISTORY 0
+#endif
+//count of sent UDP packages followed by XOR parity package with PKG_FEAT_FEC, up to FEC_GROUP_MAX,
+//parity encoder and decoder take BoardLayout::GetPackageSizeMax() bytes of RAM each, 0 - parity is neither sent nor used
+#define UDP_FEC_GROUP 0
+
 //other params
 #define RESET_TIME_MS 100
 #define COLD_BOOT_WARMUP 1000
 
-//package format defines
-#define PKG_HDR_SZ 6
-#define PKG_CNT_OFFSET 2
-#define PKG_CNT_SIZE 4
-#define CMD_HDR_SIZE 3
-#define META_SZ (PKG_HDR_SZ+CMD_HDR_SIZE*UART_COUNT)
-#define META_CRC_SZ 1
-#define PACKAGE_SIZE (META_SZ+META_CRC_SZ+DATA_PAYLOAD_SIZE*UART_COUNT) //seq number 2 bytes, (1byte cmd + 2bytes payload)*UART_COUNT, 1 byte crc, uart payload -> DATA_PAYLOAD_SIZE*UART_COUNT
+//package format defines, package layout itself is defined at protocol.h shared with the client
+//supported package format features (PKG_FEAT_* from protocol.h), client selects from them on connect,
+//rx and tx buffers are sized for the largest package of supported formats,
+//PKG_FEAT_NACK needs UDP_RETRANSMIT_HISTORY and UDP_REORDER_WINDOW, PKG_FEAT_FEC needs UDP_FEC_GROUP
+#ifdef ARDUINO_AVR_MEGA2560
+#define PKG_FEATURES (PKG_FEAT_VARLEN|PKG_FEAT_SHARED|PKG_FEAT_LEN16|PKG_FEAT_CREDITS|PKG_FEAT_PLCRC|PKG_FEAT_NACK|PKG_FEAT_DUAL)
+#else
+//PKG_FEAT_PLCRC needs 1KiB of flash for CRC-32C table
+#define PKG_FEATURES (PKG_FEAT_VARLEN|PKG_FEAT_SHARED|PKG_FEAT_LEN16|PKG_FEAT_CREDITS|PKG_FEAT_DUAL)
+#endif
 
 #endif
@@ -0,0 +1,8 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <Arduino.h>
+
+uint32_t CRC32C(const uint8_t *source, size_t len);
+
+#endif
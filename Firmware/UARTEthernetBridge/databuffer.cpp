@@ -33,6 +33,12 @@ uint16_t DataBuffer::UsedSize()
     return static_cast<uint16_t>(head>=tail?head-tail:DATA_BUFFER_SIZE-(tail-head-1));
 }
 
+uint16_t DataBuffer::FreeSize()
+{
+    //one byte is always kept unused to tell full buffer from empty one
+    return static_cast<uint16_t>(head>=tail?DATA_BUFFER_SIZE-1-(head-tail):tail-head-1);
+}
+
 bool DataBuffer::IsHalfUsed()
 {
     return UsedSize()>(DATA_BUFFER_SIZE/2);
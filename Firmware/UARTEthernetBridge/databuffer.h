@@ -24,6 +24,8 @@ class DataBuffer
         Handle GetTail();
         void Commit(const Handle &handle, uint16_t usedSz);
         uint16_t UsedSize();
+        //exact number of bytes that may be written before the buffer is full
+        uint16_t FreeSize();
         bool IsHalfUsed();
         void Reset();
 };
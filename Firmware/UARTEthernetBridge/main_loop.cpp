@@ -14,25 +14,59 @@
 #include "command.h"
 
 //receive- and send- buffers
-static uint8_t rxBuff[PACKAGE_SIZE];
-static uint8_t txBuff[PACKAGE_SIZE];
+static uint8_t rxBuff[BoardLayout::GetUDPPackageSizeMax()];
+static uint8_t txBuff[BoardLayout::GetPackageSizeMax()];
 
 //helper classes
 static WatchdogAVR watchdog;
 static IntervalTimer pollTimer;
 static AlarmTimer alarmTimer;
-static TCPServer tcpServer(alarmTimer,rxBuff,txBuff,PACKAGE_SIZE,META_SZ,TCP_PORT);
-static UDPServer udpServer(alarmTimer,rxBuff,txBuff,PACKAGE_SIZE,META_SZ);
+static TCPServer tcpServer(alarmTimer,rxBuff,txBuff,TCP_PORT);
+static UDPServer udpServer(alarmTimer,rxBuff,txBuff);
 static ResetHelper rstHelper[UART_COUNT];
 static UARTWorker uartWorker[UART_COUNT];
 
 //current client state
 static bool tcpClientState;
 static bool pollIntervalSetPending;
+static unsigned long activePollInterval;
+static bool idleMode;
 static ClientEvent clientEvent;
-#if IO_AGGREGATE_MULTIPLIER > 1
+static uint8_t pkgFeatures;
+static uint16_t payloadOffset;
+//IO_AGGREGATE_MULTIPLIER and PORT_IO_SIZE are defaults, client may change them on connect and on port open
+static uint8_t aggregateMultiplier;
 static uint8_t segmentCounter;
-#endif
+//with PKG_FEAT_DUAL every package goes via both TCP and UDP, only the first copy of the request is processed
+static uint16_t rxPathSeq;
+static bool rxPathSynced;
+static uint16_t txPathSeq;
+
+//package format may be changed only while client is not connected,
+//TCP server selects it on its own while connecting, because it may already be reading the first request package
+static void set_features(const uint8_t features)
+{
+    pkgFeatures=features;
+    payloadOffset=BoardLayout::GetPayloadOffset(features);
+    udpServer.SetFeatures(features);
+    for(uint8_t i=0;i<UART_COUNT;++i)
+        uartWorker[i].SetTXDataBuff(txBuff+payloadOffset+DATA_PAYLOAD_SIZE*i);
+}
+
+//UDP copy ahead of the missing request is dropped, because TCP copy of the missing one is still on the way,
+//there is no RAM to hold it, so TCP copies are used until TCP catches up
+static bool accept_request(const bool viaTCP)
+{
+    if(!(pkgFeatures&PKG_FEAT_DUAL))
+        return true;
+    const uint16_t seq=ReadPathSeq(rxBuff,UART_COUNT,pkgFeatures);
+    const auto distance=static_cast<uint16_t>(seq-rxPathSeq);
+    if(rxPathSynced&&(distance>=0x8000||(distance>0&&!viaTCP)))
+        return false;
+    rxPathSeq=seq+1;
+    rxPathSynced=true;
+    return true;
+}
 
 static void blink(uint16_t blinkTime, uint16_t pauseTime, uint8_t count)
 {
@@ -77,7 +111,7 @@ void setup()
     {
         pinMode(extUARTPins[i],INPUT_PULLUP);
         rstHelper[i].Setup(extRSTPins[i]);
-        uartWorker[i].Setup(&(rstHelper[i]),extUARTs[i],rxBuff+META_SZ+META_CRC_SZ+DATA_PAYLOAD_SIZE*i,txBuff+META_SZ+META_CRC_SZ+DATA_PAYLOAD_SIZE*i);
+        uartWorker[i].Setup(&(rstHelper[i]),extUARTs[i],txBuff+BoardLayout::GetPortOffset(0,i));
     }
 
     //wait PSU to become stable on cold boot
@@ -126,16 +160,18 @@ void setup()
     }
 
     //start TCP server
+    set_features(PKG_FEATURES);
     tcpClientState=false;
     tcpServer.Start();
 
     blink(0,0,1);
 
     //setup timers
-#if IO_AGGREGATE_MULTIPLIER > 1
+    aggregateMultiplier=IO_AGGREGATE_MULTIPLIER;
     segmentCounter=0;
-#endif
     pollIntervalSetPending=false;
+    activePollInterval=UART_POLL_INTERVAL_US_DEFAULT;
+    idleMode=false;
     alarmTimer.SetAlarmDelay(DEFAULT_ALARM_INTERVAL_MS);
     pollTimer.SetInterval(UART_POLL_INTERVAL_US_DEFAULT);
     pollTimer.Reset();
@@ -154,18 +190,125 @@ static bool check_link_state()
     return true;
 }
 
-inline Request MapRequest(const int portIndex, const uint8_t * const rawBuffer)
+inline Request MapRequest(const uint8_t portIndex, const uint8_t * const rawBuffer)
+{
+    const auto offset=CmdHdrOffset(pkgFeatures,portIndex);
+    return Request{static_cast<ReqType>(*(rawBuffer+offset)),*(rawBuffer+offset+1),ReadCmdPayloadSize(rawBuffer,portIndex,pkgFeatures)};
+}
+
+inline void WriteResponse(const Response &source, const uint8_t portIndex, uint8_t * const rawBuffer)
+{
+    WriteCmdHeader(rawBuffer,portIndex,pkgFeatures,static_cast<uint8_t>(source.type),source.arg,source.plSz,source.credits);
+}
+
+//payload position for the port, variable-length packages have no gaps between payloads
+inline uint16_t RequestPayloadOffset(const int portIndex, const uint16_t varLenOffset)
+{
+    return (pkgFeatures&PKG_FEAT_VARLEN)?varLenOffset:payloadOffset+DATA_PAYLOAD_SIZE*portIndex;
+}
+
+//move payloads collected by UART workers at fixed slots right after each other, returns package size
+static uint16_t PackTXBuff()
+{
+    uint16_t offset=payloadOffset;
+    for(uint8_t i=0;i<UART_COUNT;++i)
+    {
+        const uint16_t slot=payloadOffset+DATA_PAYLOAD_SIZE*i;
+        const uint16_t plSz=ReadCmdPayloadSize(txBuff,i,pkgFeatures);
+        //destination offset never exceeds the slot offset, so data of the following slots is not overwritten
+        if(plSz>0 && offset!=slot)
+            memmove(txBuff+offset,txBuff+slot,plSz);
+        offset+=plSz;
+    }
+    return offset;
+}
+
+//weighted max-min fair share of payload space left unused, ports that need less than their share give the rest of it to other ports
+static void share_tx_space(uint16_t budget, const uint16_t * const demand, uint16_t * const extra)
+{
+    uint16_t weightSum=0;
+    for(uint8_t i=0;i<UART_COUNT;++i)
+    {
+        extra[i]=0;
+        if(demand[i]>0)
+            weightSum+=uartWorker[i].GetWeight();
+    }
+    //port with zero extra space and non-zero demand is not satisfied yet
+    bool changed=true;
+    while(changed && weightSum>0)
+    {
+        changed=false;
+        for(uint8_t i=0;i<UART_COUNT;++i)
+        {
+            const uint8_t weight=uartWorker[i].GetWeight();
+            if(demand[i]<1 || extra[i]>0 || static_cast<uint32_t>(demand[i])*weightSum>static_cast<uint32_t>(budget)*weight)
+                continue;
+            extra[i]=demand[i];
+            budget-=demand[i];
+            weightSum-=weight;
+            changed=true;
+        }
+    }
+    if(weightSum<1)
+        return;
+    for(uint8_t i=0;i<UART_COUNT;++i)
+        if(demand[i]>0 && extra[i]<1)
+            extra[i]=static_cast<uint16_t>(static_cast<uint32_t>(budget)*uartWorker[i].GetWeight()/weightSum);
+}
+
+//pack payloads and give space left unused by idle ports to the ports with more data pending at uart, returns package size
+static uint16_t ShareTXBuff()
+{
+    uint16_t demand[UART_COUNT];
+    uint16_t extra[UART_COUNT];
+    uint16_t target[UART_COUNT];
+    const uint16_t maxPlSz=(pkgFeatures&PKG_FEAT_LEN16)?0xFFFF:0xFF;
+    for(uint8_t i=0;i<UART_COUNT;++i)
+        demand[i]=uartWorker[i].GetTXDemand(maxPlSz);
+    share_tx_space(DATA_PAYLOAD_SIZE*UART_COUNT-BoardLayout::GetPayloadSum(txBuff,pkgFeatures),demand,extra);
+    uint16_t offset=payloadOffset;
+    for(uint8_t i=0;i<UART_COUNT;++i)
+    {
+        target[i]=offset;
+        offset+=ReadCmdPayloadSize(txBuff,i,pkgFeatures)+extra[i];
+    }
+    //blocks moving left are moved from left to right, then blocks moving right are moved from right to left, so no pending data is overwritten
+    for(uint8_t i=0;i<UART_COUNT;++i)
+    {
+        const uint16_t slot=payloadOffset+DATA_PAYLOAD_SIZE*i;
+        const uint16_t plSz=ReadCmdPayloadSize(txBuff,i,pkgFeatures);
+        if(plSz>0 && target[i]<slot)
+            memmove(txBuff+target[i],txBuff+slot,plSz);
+    }
+    for(uint8_t i=UART_COUNT;i>0;--i)
+    {
+        const uint16_t slot=payloadOffset+DATA_PAYLOAD_SIZE*(i-1);
+        const uint16_t plSz=ReadCmdPayloadSize(txBuff,i-1,pkgFeatures);
+        if(plSz>0 && target[i-1]>slot)
+            memmove(txBuff+target[i-1],txBuff+slot,plSz);
+    }
+    //read extra data from uarts right after the moved blocks
+    for(uint8_t i=0;i<UART_COUNT;++i)
+        if(extra[i]>0)
+            WriteResponse(uartWorker[i].ProcessExtraTX(txBuff+target[i]+ReadCmdPayloadSize(txBuff,i,pkgFeatures),extra[i]),i,txBuff);
+    return payloadOffset+BoardLayout::GetPayloadSum(txBuff,pkgFeatures);
+}
+
+static bool uarts_idle()
 {
-    const auto offset=PKG_HDR_SZ+portIndex*CMD_HDR_SIZE;
-    return Request{static_cast<ReqType>(*(rawBuffer+offset)),*(rawBuffer+offset+1),*(rawBuffer+offset+2)};
+    for(uint8_t i=0;i<UART_COUNT;++i)
+        if(!uartWorker[i].IsIdle())
+            return false;
+    return true;
 }
 
-inline void WriteResponse(const Response &source, const int portIndex, uint8_t * const rawBuffer)
+//switch between full and keepalive poll rate, partially aggregated data is kept
+static void set_idle_mode(const bool idle)
 {
-    const auto offset=PKG_HDR_SZ+portIndex*CMD_HDR_SIZE;
-    *(rawBuffer+offset)=static_cast<uint8_t>(source.type);
-    *(rawBuffer+offset+1)=source.arg;
-    *(rawBuffer+offset+2)=source.plSz;
+    if(idleMode==idle)
+        return;
+    idleMode=idle;
+    pollTimer.SetInterval(idle?UART_POLL_INTERVAL_US_IDLE(aggregateMultiplier):activePollInterval);
 }
 
 void loop()
@@ -179,71 +322,107 @@ void loop()
     //process TCP client event
     if (clientEvent.type==ClientEventType::Connected)
     {
+        set_features(tcpServer.GetFeatures());
         pollTimer.SetInterval(UART_POLL_INTERVAL_US_DEFAULT);
+        activePollInterval=UART_POLL_INTERVAL_US_DEFAULT;
+        idleMode=false;
         tcpClientState=true;
         pollIntervalSetPending=true;
-#if IO_AGGREGATE_MULTIPLIER > 1
+        aggregateMultiplier=IO_AGGREGATE_MULTIPLIER;
         segmentCounter=0;
-#endif
+        rxPathSynced=false;
+        txPathSeq=0;
     }
     else if(clientEvent.type==ClientEventType::Disconnected)
     {
         pollTimer.SetInterval(UART_POLL_INTERVAL_US_DEFAULT);
+        activePollInterval=UART_POLL_INTERVAL_US_DEFAULT;
+        idleMode=false;
         tcpClientState=false;
         pollIntervalSetPending=false;
     }
 
     //process incoming data from UDP, with respect to TCP client event
+    const bool tcpRequest=clientEvent.type==ClientEventType::NewRequest;
     clientEvent=udpServer.ProcessRX(clientEvent);
 
-    //process incoming request
-    if(clientEvent.type==ClientEventType::NewRequest)
+    //process incoming request, duplicate copy is dropped
+    if(clientEvent.type==ClientEventType::NewRequest&&accept_request(tcpRequest))
     {
+        uint16_t offset=payloadOffset;
+        bool clientIdle=true;
+        bool openRequested=false;
         for(uint8_t i=0;i<UART_COUNT;++i)
-            uartWorker[i].ProcessRequest(MapRequest(i,rxBuff));
+        {
+            auto request=MapRequest(i,rxBuff);
+            uartWorker[i].ProcessRequest(request,rxBuff+RequestPayloadOffset(i,offset));
+            offset+=request.plSz;
+            clientIdle&=request.type==ReqType::NoCommand&&(request.arg&REQ_ARG_IDLE)!=0;
+            openRequested|=request.type==ReqType::Open;
+        }
         //save new counter to the txbuff
         txBuff[PKG_CNT_OFFSET]=rxBuff[PKG_CNT_OFFSET];
         txBuff[PKG_CNT_OFFSET+1]=rxBuff[PKG_CNT_OFFSET+1];
         txBuff[PKG_CNT_OFFSET+2]=rxBuff[PKG_CNT_OFFSET+2];
         txBuff[PKG_CNT_OFFSET+3]=rxBuff[PKG_CNT_OFFSET+3];
-        //or save new poll interval
-        if(pollIntervalSetPending)
+        //or save new poll interval, client sends it along with port open requests,
+        //requests encoded by client before it was notified about connection may come first and carry the counter
+        if(pollIntervalSetPending&&openRequested)
         {
             pollIntervalSetPending=false;
             txBuff[PKG_CNT_OFFSET]=txBuff[PKG_CNT_OFFSET+1]=txBuff[PKG_CNT_OFFSET+2]=txBuff[PKG_CNT_OFFSET+3]=0;
+            //lower 3 bytes: interval between packages, top byte: optional aggregate multiplier
             auto interval=(static_cast<unsigned long>(rxBuff[PKG_CNT_OFFSET]))|(static_cast<unsigned long>(rxBuff[PKG_CNT_OFFSET+1])<<8)|
-                    (static_cast<unsigned long>(rxBuff[PKG_CNT_OFFSET+2])<<16)|(static_cast<unsigned long>(rxBuff[PKG_CNT_OFFSET+2])<<24);
-            interval/=IO_AGGREGATE_MULTIPLIER;
+                    (static_cast<unsigned long>(rxBuff[PKG_CNT_OFFSET+2])<<16);
+            if(rxBuff[PKG_CNT_OFFSET+3]>0)
+            {
+                aggregateMultiplier=rxBuff[PKG_CNT_OFFSET+3];
+                segmentCounter=0;
+            }
+            interval/=aggregateMultiplier;
             if(interval>0)
+            {
+                activePollInterval=interval;
                 pollTimer.SetInterval(interval);
+            }
         }
+        //poll uarts at keepalive rate while client is idle, and resume full rate on first request with data
+        if(!clientIdle)
+            set_idle_mode(false);
+        else if(uarts_idle())
+            set_idle_mode(true);
     }
 
     //process other tasks of UART worker -> finish running reset, write data from ring-buffer to uart
     for(uint8_t i=0;i<UART_COUNT;++i)
         uartWorker[i].ProcessRX();
 
+    //resume full poll rate on first data from uart
+    if(idleMode && !uarts_idle())
+        set_idle_mode(false);
+
     //if poll interval has passed, read available data from UART and send it to the client via UDP or TCP
     if(pollTimer.Update())
     {
         pollTimer.Next();
-#if IO_AGGREGATE_MULTIPLIER > 1
         segmentCounter++;
         for(uint8_t i=0;i<UART_COUNT;++i)
             uartWorker[i].FillTXBuff(segmentCounter==1);
-        if(segmentCounter<IO_AGGREGATE_MULTIPLIER)
+        if(segmentCounter<aggregateMultiplier)
             return;
         for(uint8_t i=0;i<UART_COUNT;++i)
             WriteResponse(uartWorker[i].ProcessTX(),i,txBuff);
         segmentCounter=0;
-#else
-        for(uint8_t i=0;i<UART_COUNT;++i)
+        const uint16_t txSz=(pkgFeatures&PKG_FEAT_SHARED)?ShareTXBuff():((pkgFeatures&PKG_FEAT_VARLEN)?PackTXBuff():BoardLayout::GetPackageSize(pkgFeatures));
+        //if tcpClientConnected, send data via both UDP and TCP with PKG_FEAT_DUAL,
+        //or try to send data via UDP first, and via TCP if send via UDP is not possible
+        if(tcpClientState&&(pkgFeatures&PKG_FEAT_DUAL))
         {
-            uartWorker[i].FillTXBuff(true);
-            WriteResponse(uartWorker[i].ProcessTX(),i,txBuff);
+            WritePathSeq(txBuff,UART_COUNT,pkgFeatures,txPathSeq++);
+            udpServer.ProcessTX(txSz);
+            tcpServer.ProcessTX(txSz,0);
         }
-#endif
-        //if tcpClientConnected, try to send data via UDP first, and via TCP if send via UDP is not possible;
-        !tcpClientState||udpServer.ProcessTX()||tcpServer.ProcessTX();
+        else
+            !tcpClientState||udpServer.ProcessTX(txSz)||tcpServer.ProcessTX(txSz,udpServer.TakePathBarrier());
     }
 }
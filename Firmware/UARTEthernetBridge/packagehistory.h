@@ -0,0 +1,54 @@
+#ifndef PACKAGEHISTORY_H
+#define PACKAGEHISTORY_H
+
+#include <Arduino.h>
+
+//last Size sent UDP packages up to PkgSize bytes each, kept for retransmission on client's request
+template<uint8_t Size, uint16_t PkgSize>
+class PackageHistory
+{
+    private:
+        uint16_t seqs[Size];
+        uint16_t sizes[Size]; //0 - free slot, or package already retransmitted
+        uint8_t data[Size][PkgSize];
+        uint8_t pos = 0;
+    public:
+        PackageHistory() { Clear(); }
+        void Store(const uint16_t seq, const uint8_t * const src, const uint16_t size)
+        {
+            seqs[pos]=seq;
+            sizes[pos]=size;
+            memcpy(data[pos],src,size);
+            pos=static_cast<uint8_t>((pos+1)%Size);
+        }
+        //package is returned only once, nullptr if it is not found or already taken
+        const uint8_t* Take(const uint16_t seq, uint16_t &size)
+        {
+            for(uint8_t i=0;i<Size;++i)
+                if(sizes[i]>0&&seqs[i]==seq)
+                {
+                    size=sizes[i];
+                    sizes[i]=0;
+                    return data[i];
+                }
+            return nullptr;
+        }
+        void Clear()
+        {
+            for(uint8_t i=0;i<Size;++i)
+                sizes[i]=0;
+            pos=0;
+        }
+};
+
+//retransmission disabled
+template<uint16_t PkgSize>
+class PackageHistory<0,PkgSize>
+{
+    public:
+        void Store(const uint16_t, const uint8_t * const, const uint16_t) {}
+        const uint8_t* Take(const uint16_t, uint16_t &) { return nullptr; }
+        void Clear() {}
+};
+
+#endif // PACKAGEHISTORY_H
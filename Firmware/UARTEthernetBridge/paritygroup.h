@@ -0,0 +1,143 @@
+#ifndef PARITYGROUP_H
+#define PARITYGROUP_H
+
+#include <Arduino.h>
+#include "protocol.h"
+
+//XOR parity of GroupSize sent UDP packages up to PkgSize bytes each
+template<uint8_t GroupSize, uint16_t PkgSize>
+class ParityEncoder
+{
+    private:
+        uint8_t data[PkgSize];
+        uint16_t dataSize = 0;
+        uint16_t firstSeq = 0;
+        uint16_t sizeXor = 0;
+        uint8_t count = 0;
+    public:
+        ParityEncoder() { Clear(); }
+        //returns true when group is complete and parity package is ready
+        bool Add(const uint16_t seq, const uint8_t * const src, const uint16_t size)
+        {
+            if(count<1)
+                firstSeq=seq;
+            for(uint16_t i=0;i<size;++i)
+                data[i]^=src[i];
+            if(size>dataSize)
+                dataSize=size;
+            sizeXor^=size;
+            return ++count>=GroupSize;
+        }
+        void WriteHeader(uint8_t * const header) const { WriteParityHeader(header,firstSeq,sizeXor,count); }
+        const uint8_t* GetData() const { return data; }
+        uint16_t GetDataSize() const { return dataSize; }
+        void Clear()
+        {
+            memset(data,0,PkgSize);
+            dataSize=sizeXor=0;
+            count=0;
+        }
+};
+
+//parity is not sent
+template<uint16_t PkgSize>
+class ParityEncoder<0,PkgSize>
+{
+    public:
+        bool Add(const uint16_t, const uint8_t * const, const uint16_t) { return false; }
+        void WriteHeader(uint8_t * const) const {}
+        const uint8_t* GetData() const { return nullptr; }
+        uint16_t GetDataSize() const { return 0; }
+        void Clear() {}
+};
+
+//restores single lost package of the group from XOR parity of received ones,
+//group boundaries are learned from parity packages, so the group that follows every parity package is awaited,
+//GroupSize of own parity groups only enables decoding, groups up to FEC_GROUP_MAX packages are accepted
+template<uint8_t GroupSize, uint16_t PkgSize>
+class ParityDecoder
+{
+    private:
+        uint8_t data[PkgSize];
+        uint16_t groupStart = 0;
+        uint16_t receivedMask = 0;
+        uint16_t sizeXor = 0;
+        uint8_t groupCount = 0; //0 - group is not known yet
+        uint8_t GetMissingCount() const { return static_cast<uint8_t>(groupCount-__builtin_popcount(receivedMask)); }
+        void StartGroup(const uint16_t seq, const uint8_t count)
+        {
+            memset(data,0,PkgSize);
+            groupStart=seq;
+            groupCount=count;
+            receivedMask=sizeXor=0;
+        }
+    public:
+        ParityDecoder() { Clear(); }
+        //unrecovered is increased by missing packages of the group that was left without parity
+        void Add(const uint16_t seq, const uint8_t * const src, const uint16_t size, uint16_t &unrecovered)
+        {
+            if(groupCount<1)
+                return;
+            auto distance=static_cast<uint16_t>(seq-groupStart);
+            //package of the group already passed
+            if(distance>=0x8000)
+                return;
+            //parity of the current group is lost or late, continue with the group of this package
+            if(distance>=groupCount)
+            {
+                if(receivedMask>0)
+                    unrecovered+=GetMissingCount();
+                StartGroup(static_cast<uint16_t>(groupStart+distance/groupCount*groupCount),groupCount);
+                distance%=groupCount;
+            }
+            if(receivedMask&(1u<<distance))
+                return;
+            receivedMask|=static_cast<uint16_t>(1u<<distance);
+            sizeXor^=size;
+            for(uint16_t i=0;i<size;++i)
+                data[i]^=src[i];
+        }
+        //restores missing package in place of the parity package at buff, returns size of restored package or 0,
+        //unrecovered is increased if more than one package of the group is missing
+        uint16_t Recover(uint8_t * const buff, const uint16_t size, uint16_t &unrecovered)
+        {
+            uint16_t firstSeq=0, parityXor=0;
+            const uint8_t count=ReadParityHeader(buff,firstSeq,parityXor);
+            if(count<1||count>FEC_GROUP_MAX||size-FEC_HDR_SIZE>PkgSize)
+                return 0;
+            //late parity of the group already passed
+            if(groupCount>0&&static_cast<uint16_t>(firstSeq-groupStart)>=0x8000)
+                return 0;
+            uint16_t result=0;
+            if(groupCount>0&&firstSeq==groupStart&&count==groupCount)
+            {
+                const uint8_t missing=GetMissingCount();
+                const uint16_t pkgSize=static_cast<uint16_t>(sizeXor^parityXor);
+                if(missing==1&&pkgSize>0&&pkgSize<=size-FEC_HDR_SIZE)
+                {
+                    //restored package is written over the parity header, so data is moved forward only
+                    for(uint16_t i=0;i<pkgSize;++i)
+                        buff[i]=buff[FEC_HDR_SIZE+i]^data[i];
+                    result=pkgSize;
+                }
+                else if(missing>0)
+                    unrecovered+=missing;
+            }
+            //next group is expected right after this one
+            StartGroup(static_cast<uint16_t>(firstSeq+count),count);
+            return result;
+        }
+        void Clear() { StartGroup(0,0); }
+};
+
+//parity packages are not expected
+template<uint16_t PkgSize>
+class ParityDecoder<0,PkgSize>
+{
+    public:
+        void Add(const uint16_t, const uint8_t * const, const uint16_t, uint16_t &) {}
+        uint16_t Recover(uint8_t * const, const uint16_t, uint16_t &) { return 0; }
+        void Clear() {}
+};
+
+#endif // PARITYGROUP_H
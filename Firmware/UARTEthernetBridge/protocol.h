@@ -0,0 +1,258 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+//network package layout shared by firmware and client, header-only, must stay compatible with C++11 used by avr-gcc
+
+#include <stdint.h>
+
+//package format features
+#define PKG_FEAT_VARLEN 0x01 //package carries only used payload bytes, payload of every port placed right after the previous one
+#define PKG_FEAT_SHARED 0x02 //payload space of the package is shared between ports instead of fixed slot per port, requires PKG_FEAT_VARLEN
+#define PKG_FEAT_LEN16 0x04 //command header carries 16-bit payload size, so port payload may exceed 255 bytes
+#define PKG_FEAT_CREDITS 0x08 //command header carries exact free space of the port's ring-buffer, unused in requests
+#define PKG_FEAT_PLCRC 0x10 //CRC-32C of the payload at the end of metadata block, covered by metadata CRC
+#define PKG_FEAT_NACK 0x20 //metadata carries range of missing UDP packages the other side should retransmit, unused with TCP
+#define PKG_FEAT_FEC 0x40 //groups of UDP packages are followed by XOR parity package, so single lost package of the group is restored, unused with TCP
+#define PKG_FEAT_DUAL 0x80 //every package is sent via both UDP and TCP with the same path sequence number at metadata block, receiver uses the first copy
+
+//connect-time handshake: server announces its configuration, client answers with selected package format features
+#define HS_MAGIC_0 0x55
+#define HS_MAGIC_1 0x42
+#define HS_VERSION 2
+#define HELLO_REQUEST_SIZE 4 //magic 2 bytes, version, crc, sent by client right after connection, legacy client sends first request instead
+#define HELLO_SIZE 13 //magic 2 bytes, version, features, UART_COUNT, DATA_PAYLOAD_SIZE 2 bytes, DATA_BUFFER_SIZE 2 bytes, PORT_IO_SIZE 2 bytes, IO_AGGREGATE_MULTIPLIER, crc
+#define SELECT_SIZE 4 //magic 2 bytes, selected features, crc
+
+//package layout: header, command header for every port, optional NACK block, optional path sequence, optional payload CRC, metadata CRC, payload
+#define PKG_HDR_SZ 6 //seq number or client's UDP port 2 bytes, counter 4 bytes
+//request via TCP with zero client's UDP port after UDP is started moves responses to TCP, until the next request via UDP,
+//such responses carry path flags with lower bits of next UDP sequence number instead of zero, so client delivers UDP responses sent before them first,
+//and the last of them is marked, so client delivers UDP responses sent after it later
+#define PKG_PATH_BARRIER 0x8000
+#define PKG_PATH_LAST 0x4000
+#define PKG_PATH_SEQ_MASK 0x3FFF
+#define PKG_CNT_OFFSET 2
+#define PKG_CNT_SIZE 4
+#define CMD_HDR_SIZE 3 //type, arg, payload size
+#define CMD_HDR_SIZE_LEN16 4 //command header with 16-bit payload size, used with PKG_FEAT_LEN16
+#define CMD_CREDITS_SIZE 2 //free space of the port's ring-buffer at the end of command header, used with PKG_FEAT_CREDITS
+#define NACK_SIZE 3 //first missing sequence number of the other side 2 bytes, count of missing packages, used with PKG_FEAT_NACK
+#define PATH_SEQ_SIZE 2 //sequence number shared by UDP and TCP copies of the package, used with PKG_FEAT_DUAL
+#define PL_CRC_SIZE 4 //CRC-32C of the payload at the end of metadata block, used with PKG_FEAT_PLCRC
+#define META_CRC_SZ 1
+
+//probe package layout: probe seq 2 bytes, sender's timestamp 4 bytes, marker, crc,
+//echoed back unchanged by the other side, so loss and round-trip time of UDP path are measured without data
+#define PROBE_SIZE 8
+#define PROBE_MARKER_OFFSET 6
+#define PROBE_MARKER 0xFD
+
+//parity package layout: first seq of the group 2 bytes, XOR of package sizes 2 bytes, package count, reserved, marker, header crc,
+//then XOR of all group packages padded with zeros to the longest one
+#define FEC_HDR_SIZE 8
+#define FEC_MARKER_OFFSET 6 //placed instead of command type of the first port, so parity package is never taken for data package
+#define FEC_MARKER 0xFE
+#define FEC_GROUP_MAX 16 //max packages covered by single parity package
+
+enum struct ReqType : uint8_t
+{
+    NoCommand = 0x00,
+    Reset = 0x01,
+    Open = 0x02,
+    ResetOpen = 0x03,
+    Close = 0x04,
+    Data = 0x08,
+};
+
+//NoCommand request arg flag: client is idle, so uarts may be polled at keepalive rate
+#define REQ_ARG_IDLE 0x01
+//NoCommand and Data request arg flag: client can't accept more data from the port, so uart should not be read
+#define REQ_ARG_PAUSE 0x02
+
+enum struct RespType : uint8_t
+{
+    NoCommand = 0x00,
+    Data = 0x08,
+};
+
+constexpr uint8_t CmdHdrSize(const uint8_t features)
+{
+    return static_cast<uint8_t>(((features&PKG_FEAT_LEN16)?CMD_HDR_SIZE_LEN16:CMD_HDR_SIZE)+((features&PKG_FEAT_CREDITS)?CMD_CREDITS_SIZE:0));
+}
+
+constexpr uint16_t MetaSize(const uint8_t portCount, const uint8_t features)
+{
+    return static_cast<uint16_t>(PKG_HDR_SZ+CmdHdrSize(features)*portCount+((features&PKG_FEAT_NACK)?NACK_SIZE:0)+((features&PKG_FEAT_DUAL)?PATH_SEQ_SIZE:0)+
+                                 ((features&PKG_FEAT_PLCRC)?PL_CRC_SIZE:0));
+}
+
+//offset of the first payload byte
+constexpr uint16_t PayloadOffset(const uint8_t portCount, const uint8_t features)
+{
+    return static_cast<uint16_t>(MetaSize(portCount,features)+META_CRC_SZ);
+}
+
+//size of the package with all payload slots filled, max size of variable-length package
+constexpr uint16_t PackageSize(const uint8_t portCount, const uint16_t payloadSize, const uint8_t features)
+{
+    return static_cast<uint16_t>(PayloadOffset(portCount,features)+payloadSize*portCount);
+}
+
+//payload slot of the port at fixed-size package
+constexpr uint16_t PortOffset(const uint8_t portCount, const uint16_t payloadSize, const uint8_t features, const uint8_t portIndex)
+{
+    return static_cast<uint16_t>(PayloadOffset(portCount,features)+payloadSize*portIndex);
+}
+
+constexpr uint16_t CmdHdrOffset(const uint8_t features, const uint8_t portIndex)
+{
+    return static_cast<uint16_t>(PKG_HDR_SZ+CmdHdrSize(features)*portIndex);
+}
+
+//NACK block placed right after command headers
+constexpr uint16_t NackOffset(const uint8_t portCount, const uint8_t features)
+{
+    return static_cast<uint16_t>(PKG_HDR_SZ+CmdHdrSize(features)*portCount);
+}
+
+//count of missing packages starting from seq, 0 - nothing to retransmit
+inline uint8_t ReadNack(const uint8_t * const rawBuffer, const uint8_t portCount, const uint8_t features, uint16_t &seq)
+{
+    const uint8_t * const nack=rawBuffer+NackOffset(portCount,features);
+    seq=static_cast<uint16_t>(nack[0]|nack[1]<<8);
+    return nack[2];
+}
+
+inline void WriteNack(uint8_t * const rawBuffer, const uint8_t portCount, const uint8_t features, const uint16_t seq, const uint8_t count)
+{
+    uint8_t * const nack=rawBuffer+NackOffset(portCount,features);
+    nack[0]=static_cast<uint8_t>(seq&0xFF);
+    nack[1]=static_cast<uint8_t>(seq>>8);
+    nack[2]=count;
+}
+
+//path sequence placed right after NACK block
+constexpr uint16_t PathSeqOffset(const uint8_t portCount, const uint8_t features)
+{
+    return static_cast<uint16_t>(NackOffset(portCount,features)+((features&PKG_FEAT_NACK)?NACK_SIZE:0));
+}
+
+inline uint16_t ReadPathSeq(const uint8_t * const rawBuffer, const uint8_t portCount, const uint8_t features)
+{
+    const uint8_t * const pathSeq=rawBuffer+PathSeqOffset(portCount,features);
+    return static_cast<uint16_t>(pathSeq[0]|pathSeq[1]<<8);
+}
+
+inline void WritePathSeq(uint8_t * const rawBuffer, const uint8_t portCount, const uint8_t features, const uint16_t seq)
+{
+    uint8_t * const pathSeq=rawBuffer+PathSeqOffset(portCount,features);
+    pathSeq[0]=static_cast<uint8_t>(seq&0xFF);
+    pathSeq[1]=static_cast<uint8_t>(seq>>8);
+}
+
+inline bool IsParityPackage(const uint8_t * const rawBuffer, const uint16_t size)
+{
+    return size>FEC_HDR_SIZE&&rawBuffer[FEC_MARKER_OFFSET]==FEC_MARKER;
+}
+
+//probe crc must be verified separately
+inline bool IsProbePackage(const uint8_t * const rawBuffer, const uint16_t size)
+{
+    return size==PROBE_SIZE&&rawBuffer[PROBE_MARKER_OFFSET]==PROBE_MARKER;
+}
+
+//count of packages covered by parity package, header crc must be verified separately
+inline uint8_t ReadParityHeader(const uint8_t * const rawBuffer, uint16_t &firstSeq, uint16_t &sizeXor)
+{
+    firstSeq=static_cast<uint16_t>(rawBuffer[0]|rawBuffer[1]<<8);
+    sizeXor=static_cast<uint16_t>(rawBuffer[2]|rawBuffer[3]<<8);
+    return rawBuffer[4];
+}
+
+//header crc is not written
+inline void WriteParityHeader(uint8_t * const rawBuffer, const uint16_t firstSeq, const uint16_t sizeXor, const uint8_t count)
+{
+    rawBuffer[0]=static_cast<uint8_t>(firstSeq&0xFF);
+    rawBuffer[1]=static_cast<uint8_t>(firstSeq>>8);
+    rawBuffer[2]=static_cast<uint8_t>(sizeXor&0xFF);
+    rawBuffer[3]=static_cast<uint8_t>(sizeXor>>8);
+    rawBuffer[4]=count;
+    rawBuffer[5]=0;
+    rawBuffer[FEC_MARKER_OFFSET]=FEC_MARKER;
+}
+
+//command header fields of request or response for the port
+inline uint16_t ReadCmdPayloadSize(const uint8_t * const rawBuffer, const uint8_t portIndex, const uint8_t features)
+{
+    const uint8_t * const plSz=rawBuffer+CmdHdrOffset(features,portIndex)+2;
+    return (features&PKG_FEAT_LEN16)?static_cast<uint16_t>(plSz[0]|plSz[1]<<8):plSz[0];
+}
+
+inline uint16_t ReadCmdCredits(const uint8_t * const rawBuffer, const uint8_t portIndex, const uint8_t features)
+{
+    const uint8_t * const credits=rawBuffer+CmdHdrOffset(features,portIndex)+CmdHdrSize(features)-CMD_CREDITS_SIZE;
+    return (features&PKG_FEAT_CREDITS)?static_cast<uint16_t>(credits[0]|credits[1]<<8):0;
+}
+
+inline void WriteCmdHeader(uint8_t * const rawBuffer, const uint8_t portIndex, const uint8_t features, const uint8_t type, const uint8_t arg, const uint16_t plSz, const uint16_t credits)
+{
+    uint8_t * const cmdHdr=rawBuffer+CmdHdrOffset(features,portIndex);
+    cmdHdr[0]=type;
+    cmdHdr[1]=arg;
+    cmdHdr[2]=static_cast<uint8_t>(plSz&0xFF);
+    if(features&PKG_FEAT_LEN16)
+        cmdHdr[3]=static_cast<uint8_t>(plSz>>8);
+    if(features&PKG_FEAT_CREDITS)
+    {
+        cmdHdr[CmdHdrSize(features)-CMD_CREDITS_SIZE]=static_cast<uint8_t>(credits&0xFF);
+        cmdHdr[CmdHdrSize(features)-CMD_CREDITS_SIZE+1]=static_cast<uint8_t>(credits>>8);
+    }
+}
+
+//calls f(portIndex) for port indices Index..Count-1, unrolled at compile time
+template<uint8_t Index, uint8_t Count>
+struct PortLoop
+{
+    template<typename F> static void Run(F &f)
+    {
+        f(Index);
+        PortLoop<Index+1,Count>::Run(f);
+    }
+};
+
+template<uint8_t Count>
+struct PortLoop<Count,Count>
+{
+    template<typename F> static void Run(F &) {}
+};
+
+//layout for fixed port count and payload size, package format features are still selected on connect from Features
+template<uint8_t PortCount, uint16_t PayloadSize, uint8_t Features = 0xFF>
+struct PackageLayout
+{
+    static constexpr uint8_t GetPortCount() { return PortCount; }
+    static constexpr uint16_t GetPayloadSize() { return PayloadSize; }
+    static constexpr uint16_t GetMetaSize(const uint8_t features) { return MetaSize(PortCount,features); }
+    static constexpr uint16_t GetPayloadOffset(const uint8_t features) { return PayloadOffset(PortCount,features); }
+    static constexpr uint16_t GetPackageSize(const uint8_t features) { return PackageSize(PortCount,PayloadSize,features); }
+    static constexpr uint16_t GetPortOffset(const uint8_t features, const uint8_t portIndex) { return PortOffset(PortCount,PayloadSize,features,portIndex); }
+    //buffer size for package of any format
+    static constexpr uint16_t GetPackageSizeMax() { return GetPackageSize(Features&(PKG_FEAT_LEN16|PKG_FEAT_CREDITS|PKG_FEAT_NACK|PKG_FEAT_DUAL|PKG_FEAT_PLCRC)); }
+    //buffer size for incoming UDP package of any format, including parity package
+    static constexpr uint16_t GetUDPPackageSizeMax() { return static_cast<uint16_t>(GetPackageSizeMax()+((Features&PKG_FEAT_FEC)?FEC_HDR_SIZE:0)); }
+    template<typename F> static void ForEachPort(F &&f) { PortLoop<0,PortCount>::Run(f); }
+    //sum of payload sizes from request or response headers of all ports
+    static uint16_t GetPayloadSum(const uint8_t * const rawBuffer, const uint8_t features)
+    {
+        uint16_t result=0;
+        for(uint8_t i=0;i<PortCount;++i)
+            result=static_cast<uint16_t>(result+ReadCmdPayloadSize(rawBuffer,i,features));
+        return result;
+    }
+};
+
+//default layouts of the firmware board profiles, client has specialized codecs for them
+typedef PackageLayout<1,128> ProMiniLayout; //ARDUINO_AVR_PRO: UART_COUNT 1, PORT_IO_SIZE 64 x IO_AGGREGATE_MULTIPLIER 2
+typedef PackageLayout<3,50> Mega2560Layout; //ARDUINO_AVR_MEGA2560: UART_COUNT 3, PORT_IO_SIZE 25 x IO_AGGREGATE_MULTIPLIER 2
+
+#endif // PROTOCOL_H
@@ -0,0 +1,97 @@
+#ifndef REORDERBUFFER_H
+#define REORDERBUFFER_H
+
+#include <Arduino.h>
+
+//storage for UDP packages arrived ahead of missing ones, Size packages up to PkgSize bytes each
+template<uint8_t Size, uint16_t PkgSize>
+class ReorderBuffer
+{
+    private:
+        uint16_t seqs[Size];
+        uint16_t sizes[Size]; //0 - free slot
+        uint8_t data[Size][PkgSize];
+        uint8_t count = 0;
+    public:
+        ReorderBuffer() { Clear(); }
+        uint8_t GetCount() const { return count; }
+        bool IsFull() const { return count>=Size; }
+        bool Contains(const uint16_t seq) const
+        {
+            for(uint8_t i=0;i<Size;++i)
+                if(sizes[i]>0&&seqs[i]==seq)
+                    return true;
+            return false;
+        }
+        //buffer must not be full
+        void Store(const uint16_t seq, const uint8_t * const src, const uint16_t size)
+        {
+            for(uint8_t i=0;i<Size;++i)
+                if(sizes[i]<1)
+                {
+                    seqs[i]=seq;
+                    sizes[i]=size;
+                    memcpy(data[i],src,size);
+                    count++;
+                    return;
+                }
+        }
+        //slot of the package with lowest sequence number starting from nextSeq, buffer must not be empty
+        uint8_t FindNearest(const uint16_t nextSeq) const
+        {
+            uint8_t result=0;
+            uint16_t minDistance=UINT16_MAX;
+            for(uint8_t i=0;i<Size;++i)
+                if(sizes[i]>0&&static_cast<uint16_t>(seqs[i]-nextSeq)<=minDistance)
+                {
+                    minDistance=static_cast<uint16_t>(seqs[i]-nextSeq);
+                    result=i;
+                }
+            return result;
+        }
+        uint16_t GetSeq(const uint8_t slot) const { return seqs[slot]; }
+        void Take(const uint8_t slot, uint8_t * const dst)
+        {
+            memcpy(dst,data[slot],sizes[slot]);
+            sizes[slot]=0;
+            count--;
+        }
+        //exchange held package with the one at buff, so no extra RAM needed
+        void Swap(const uint8_t slot, const uint16_t seq, uint8_t * const buff, const uint16_t size)
+        {
+            const uint16_t heldSize=sizes[slot];
+            const uint16_t swapSize=heldSize>size?heldSize:size;
+            for(uint16_t i=0;i<swapSize;++i)
+            {
+                const uint8_t tmp=buff[i];
+                buff[i]=data[slot][i];
+                data[slot][i]=tmp;
+            }
+            seqs[slot]=seq;
+            sizes[slot]=size;
+        }
+        void Clear()
+        {
+            for(uint8_t i=0;i<Size;++i)
+                sizes[i]=0;
+            count=0;
+        }
+};
+
+//reordering disabled, out-of-order packages are never held
+template<uint16_t PkgSize>
+class ReorderBuffer<0,PkgSize>
+{
+    public:
+        uint8_t GetCount() const { return 0; }
+        bool IsFull() const { return true; }
+        bool Contains(const uint16_t) const { return false; }
+        void Store(const uint16_t, const uint8_t * const, const uint16_t) {}
+        uint8_t FindNearest(const uint16_t) const { return 0; }
+        uint16_t GetSeq(const uint8_t) const { return 0; }
+        void Take(const uint8_t, uint8_t * const) {}
+        void Swap(const uint8_t, const uint16_t, uint8_t * const, const uint16_t) {}
+        void Clear() {}
+};
+
+#endif // REORDERBUFFER_H
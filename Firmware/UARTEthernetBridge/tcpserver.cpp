@@ -1,16 +1,18 @@
 #include "tcpserver.h"
 #include "crc8.h"
 #include "configuration.h"
+#include "command.h"
 
-TCPServer::TCPServer(AlarmTimer& _alarmTimer, uint8_t* const _rxBuff, uint8_t* const _txBuff, const uint16_t _pkgSz, const uint16_t _metaSz, const uint16_t _netPort):
+TCPServer::TCPServer(AlarmTimer& _alarmTimer, uint8_t* const _rxBuff, uint8_t* const _txBuff, const uint16_t _netPort):
     alarmTimer(_alarmTimer),
-    pkgSz(_pkgSz),
-    metaSz(_metaSz),
     rxBuff(_rxBuff),
     txBuff(_txBuff),
     server(EthernetServer(_netPort))
 {
     connected=false;
+    helloPending=false;
+    selectPending=false;
+    SetFeatures(PKG_FEATURES);
 }
 
 void TCPServer::Start()
@@ -19,6 +21,39 @@ void TCPServer::Start()
     server.begin();
 }
 
+void TCPServer::SetFeatures(const uint8_t _features)
+{
+    features=_features;
+    pkgSz=BoardLayout::GetPackageSize(features);
+    metaSz=BoardLayout::GetMetaSize(features);
+    //payload size of variable-length package is known only after reading the metadata
+    hdrSz=(features&PKG_FEAT_VARLEN)?metaSz+META_CRC_SZ:pkgSz;
+    rxSz=pkgLeft=hdrSz;
+}
+
+uint8_t TCPServer::GetFeatures() const
+{
+    return features;
+}
+
+bool TCPServer::SendHello()
+{
+    uint8_t hello[HELLO_SIZE]={HS_MAGIC_0,HS_MAGIC_1,HS_VERSION,PKG_FEATURES,UART_COUNT,
+                               DATA_PAYLOAD_SIZE&0xFF,DATA_PAYLOAD_SIZE>>8,DATA_BUFFER_SIZE&0xFF,DATA_BUFFER_SIZE>>8,
+                               PORT_IO_SIZE&0xFF,PORT_IO_SIZE>>8,IO_AGGREGATE_MULTIPLIER,0};
+    hello[HELLO_SIZE-1]=CRC8(hello,HELLO_SIZE-1);
+    return client.write(hello,HELLO_SIZE)==HELLO_SIZE;
+}
+
+ClientEvent TCPServer::Disconnect()
+{
+    connected=false;
+    helloPending=false;
+    selectPending=false;
+    client.stop();
+    return ClientEvent{ClientEventType::Disconnected,{.remoteAddr=INADDR_NONE}};
+}
+
 ClientEvent TCPServer::ProcessRX()
 {
     //not connected
@@ -28,55 +63,100 @@ ClientEvent TCPServer::ProcessRX()
         if(!client)
             return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
         connected=true;
-        pkgLeft=pkgSz;
+        //client with handshake support starts with hello request, legacy client starts with the first request package
+        helloPending=true;
+        rxSz=pkgLeft=HELLO_REQUEST_SIZE;
         alarmTimer.SetAlarmDelay(DEFAULT_ALARM_INTERVAL_MS);
         alarmTimer.SnoozeAlarm();
-        return ClientEvent{ClientEventType::Connected,{.remoteAddr=client.remoteIP()}};
+        return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
     }
 
     //check client is still connected and alive
     if(alarmTimer.AlarmTriggered() || !client.connected())
-    {
-        connected=false;
-        client.stop();
-        return ClientEvent{ClientEventType::Disconnected,{.remoteAddr=INADDR_NONE}};
-    }
+        return Disconnect();
 
     unsigned int avail=client.available();
 
     if(avail<1)
-        return ClientEvent{ClientEventType::NoEvent,{.pkgReading=pkgLeft<pkgSz}};
+        return ClientEvent{ClientEventType::NoEvent,{.pkgReading=rxSz>hdrSz||pkgLeft<hdrSz}};
 
     if(pkgLeft>0)
-        pkgLeft-=client.read(rxBuff+pkgSz-pkgLeft,pkgLeft>avail?avail:pkgLeft);
+        pkgLeft-=client.read(rxBuff+rxSz-pkgLeft,pkgLeft>avail?avail:pkgLeft);
 
     if(pkgLeft>0)
         return ClientEvent{ClientEventType::NoEvent,{.pkgReading=true}};
 
-    //check crc and disconnect on fail
-    if(CRC8(rxBuff,metaSz)!=*(rxBuff+metaSz))
+    if(helloPending)
     {
-        connected=false;
-        client.stop();
-        return ClientEvent{ClientEventType::Disconnected,{.remoteAddr=INADDR_NONE}};
+        helloPending=false;
+        if(rxBuff[0]==HS_MAGIC_0&&rxBuff[1]==HS_MAGIC_1)
+        {
+            //client is considered connected only after it selects package format features in reply to hello
+            if(rxBuff[2]!=HS_VERSION||CRC8(rxBuff,HELLO_REQUEST_SIZE-1)!=rxBuff[HELLO_REQUEST_SIZE-1]||!SendHello())
+                return Disconnect();
+            selectPending=true;
+            rxSz=pkgLeft=SELECT_SIZE;
+            return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
+        }
+        //legacy client, bytes already read are the beginning of the first fixed-size request package
+        SetFeatures(0);
+        pkgLeft-=HELLO_REQUEST_SIZE;
+        return ClientEvent{ClientEventType::Connected,{.remoteAddr=client.remoteIP()}};
     }
 
+    if(selectPending)
+    {
+        if(rxBuff[0]!=HS_MAGIC_0||rxBuff[1]!=HS_MAGIC_1||CRC8(rxBuff,SELECT_SIZE-1)!=rxBuff[SELECT_SIZE-1]||!FeaturesValid(rxBuff[2]))
+            return Disconnect();
+        selectPending=false;
+        SetFeatures(rxBuff[2]);
+        alarmTimer.SnoozeAlarm();
+        return ClientEvent{ClientEventType::Connected,{.remoteAddr=client.remoteIP()}};
+    }
+
+    if(rxSz==hdrSz)
+    {
+        //check crc and disconnect on fail
+        if(CRC8(rxBuff,metaSz)!=*(rxBuff+metaSz))
+            return Disconnect();
+        //continue with payload of variable-length package, disconnect if it will not fit the buffer
+        if(features&PKG_FEAT_VARLEN)
+        {
+            auto plSz=BoardLayout::GetPayloadSum(rxBuff,features);
+            if(plSz>pkgSz-hdrSz)
+                return Disconnect();
+            if(plSz>0)
+            {
+                rxSz+=plSz;
+                pkgLeft=plSz;
+                return ClientEvent{ClientEventType::NoEvent,{.pkgReading=true}};
+            }
+        }
+    }
+
+    //check payload crc and disconnect on fail
+    if(PayloadCRCEnabled(features) && !PayloadCRCValid(rxBuff,metaSz,rxSz))
+        return Disconnect();
+
     //prepare reading next package
-    pkgLeft=pkgSz;
+    rxSz=pkgLeft=hdrSz;
     alarmTimer.SnoozeAlarm();
     //read port for UDP connection with new request
     return ClientEvent{ClientEventType::NewRequest,{.udpPort=static_cast<uint16_t>(*rxBuff|*(rxBuff+1)<<8)}};
 }
 
-bool TCPServer::ProcessTX()
+bool TCPServer::ProcessTX(const uint16_t txSz, const uint16_t pathBarrier)
 {
-    //clear PKG_HEADER (not needed) and calculate CRC
-    *(txBuff)=*(txBuff+1)=0;
+    //write path barrier to PKG_HEADER (zero if not needed) and calculate CRC, metadata CRC also covers payload CRC
+    *(txBuff)=pathBarrier&0xFF;
+    *(txBuff+1)=(pathBarrier>>8)&0xFF;
+    if(PayloadCRCEnabled(features))
+        WritePayloadCRC(txBuff,metaSz,txSz);
     *(txBuff+metaSz)=CRC8(txBuff,metaSz);
-    auto dataLeft=pkgSz;
+    size_t dataLeft=txSz;
     while(dataLeft>0)
     {
-        auto dw=client.write(txBuff+pkgSz-dataLeft,dataLeft);
+        auto dw=client.write(txBuff+txSz-dataLeft,dataLeft);
         //TODO: check this if porting to other ethernet libs, UIPEthernet return 0 if client is not connected
         if(dw<1)
             return false;
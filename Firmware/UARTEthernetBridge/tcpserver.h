@@ -12,20 +12,31 @@ class TCPServer
 {
     private:
         AlarmTimer& alarmTimer;
-        const size_t pkgSz;
-        const size_t metaSz;
         uint8_t * const rxBuff;
         uint8_t * const txBuff;
         EthernetServer server;
         EthernetClient client;
 
         bool connected;
+        bool helloPending;
+        bool selectPending;
+        uint8_t features;
+        size_t pkgSz;
+        size_t metaSz;
+        size_t hdrSz;
+        size_t rxSz;
         size_t pkgLeft;
+        bool SendHello();
+        ClientEvent Disconnect();
     public:
-        TCPServer(AlarmTimer& alarmTimer, uint8_t * const rxBuff, uint8_t * const txBuff, const uint16_t pkgSz, const uint16_t metaSz, const uint16_t netPort);
+        //buffers must fit the package of any format, BoardLayout::GetPackageSizeMax()
+        TCPServer(AlarmTimer& alarmTimer, uint8_t * const rxBuff, uint8_t * const txBuff, const uint16_t netPort);
         void Start();
+        void SetFeatures(const uint8_t features);
+        //package format features selected by the client on connect
+        uint8_t GetFeatures() const;
         ClientEvent ProcessRX();
-        bool ProcessTX();
+        bool ProcessTX(const uint16_t txSz, const uint16_t pathBarrier);
 };
 
 #endif // TCPSERVER_H
@@ -4,20 +4,31 @@
 #define MODE_CLOSED 0xFF
 #define IS_OPEN(mode) (mode<MODE_CLOSED)
 
-void UARTWorker::Setup(ResetHelper* const _resetHelper, HardwareSerial* const _uart, uint8_t* _rxDataBuff, uint8_t* _txDataBuff)
+void UARTWorker::Setup(ResetHelper* const _resetHelper, HardwareSerial* const _uart, uint8_t* _txDataBuff)
 {
     resetHelper=_resetHelper;
     uart=_uart;
-    rxDataBuff=_rxDataBuff;
     txDataBuff=_txDataBuff;
     curMode=MODE_CLOSED;
     sessionId=0;
+    weight=1;
+    ioSize=PORT_IO_SIZE;
+    paused=false;
     txUsedSz=0;
 }
 
-void UARTWorker::ProcessRequest(const Request &request)
+void UARTWorker::SetTXDataBuff(uint8_t * const _txDataBuff)
 {
-    uint8_t szLeft;
+    txDataBuff=_txDataBuff;
+    txUsedSz=0;
+}
+
+void UARTWorker::ProcessRequest(const Request &request, const uint8_t * const rxDataBuff)
+{
+    uint16_t szLeft;
+    //pause state is sent with every request, so it is restored after lost UDP package
+    if(request.type==ReqType::NoCommand||request.type==ReqType::Data)
+        paused=(request.arg&REQ_ARG_PAUSE)!=0;
     switch (request.type)
     {
         case ReqType::Data:
@@ -26,7 +37,7 @@ void UARTWorker::ProcessRequest(const Request &request)
             while(szLeft>0)
             {
                 auto head=rxRingBuff.GetHead();
-                uint8_t szToWrite=szLeft>head.maxSz?static_cast<uint8_t>(head.maxSz):szLeft;
+                uint16_t szToWrite=szLeft>head.maxSz?head.maxSz:szLeft;
                 if(szToWrite<1)
                     break; //no space left for storing data at ring-buffer, data will be lost
                 memcpy(head.buffer,rxDataBuff+request.plSz-szLeft,szToWrite);
@@ -49,6 +60,7 @@ void UARTWorker::ProcessRequest(const Request &request)
                 rxRingBuff.Reset();
             }
             sessionId=0; //used only on client start, so reset session id
+            paused=false;
             curMode=request.arg;
             if(IS_OPEN(curMode))
             {
@@ -60,6 +72,11 @@ void UARTWorker::ProcessRequest(const Request &request)
                     uart->begin(speed,curMode);
                     uart->setTimeout(0);
                 }
+                //optional port weight and uart io size per poll follow the speed
+                weight=request.plSz>4&&rxDataBuff[4]>0?rxDataBuff[4]:1;
+                ioSize=request.plSz>6?static_cast<uint16_t>(rxDataBuff[5]|rxDataBuff[6]<<8):PORT_IO_SIZE;
+                if(ioSize<1||ioSize>DATA_PAYLOAD_SIZE)
+                    ioSize=PORT_IO_SIZE;
             }
             break;
         case ReqType::Close:
@@ -83,8 +100,8 @@ void UARTWorker::ProcessRX()
     //write data to uart-port from ring-buffer
     auto uartAvail=uart->availableForWrite();
     //limit uart-write bandwidth
-    if(uartAvail>PORT_IO_SIZE)
-        uartAvail=PORT_IO_SIZE;
+    if(static_cast<unsigned int>(uartAvail)>ioSize)
+        uartAvail=static_cast<int>(ioSize);
     while(uartAvail>0)
     {
         auto tail=rxRingBuff.GetTail();
@@ -101,21 +118,53 @@ void UARTWorker::FillTXBuff(bool reset)
 {
     if(reset)
         txUsedSz=0;
-    if(!IS_OPEN(curMode))
+    //data is left at uart while client is not able to accept it
+    if(!IS_OPEN(curMode)||paused)
         return;
     size_t sz=DATA_PAYLOAD_SIZE-txUsedSz;
     //limit uart-read bandwidth
-    if(sz>PORT_IO_SIZE)
-        sz=PORT_IO_SIZE;
+    if(sz>ioSize)
+        sz=ioSize;
     if(sz<1)
         return;
     txUsedSz+=uart->readBytes(txDataBuff+txUsedSz,sz);
     return;
 }
 
+bool UARTWorker::IsIdle()
+{
+    //no data pending in both directions
+    return !IS_OPEN(curMode) || (txUsedSz<1 && rxRingBuff.UsedSize()<1 && uart->available()<1);
+}
+
+uint16_t UARTWorker::GetTXDemand(const uint16_t maxPlSz)
+{
+    if(!IS_OPEN(curMode)||paused)
+        return 0;
+    auto avail=uart->available();
+    if(avail<1)
+        return 0;
+    //limited by size of the payload size field
+    if(static_cast<size_t>(avail)>maxPlSz-txUsedSz)
+        avail=static_cast<int>(maxPlSz-txUsedSz);
+    return static_cast<uint16_t>(avail);
+}
+
+uint8_t UARTWorker::GetWeight()
+{
+    return weight;
+}
+
+Response UARTWorker::ProcessExtraTX(uint8_t * const extraBuff, const uint16_t maxSz)
+{
+    if(IS_OPEN(curMode) && maxSz>0)
+        txUsedSz+=uart->readBytes(extraBuff,maxSz);
+    return ProcessTX();
+}
+
 Response UARTWorker::ProcessTX()
 {
     if(txUsedSz>0)
-        return Response{RespType::Data,static_cast<uint8_t>(rxRingBuff.IsHalfUsed()<<7|(sessionId&0x7F)),static_cast<uint8_t>(txUsedSz)};
-    return Response{RespType::NoCommand,static_cast<uint8_t>(rxRingBuff.IsHalfUsed()<<7|(sessionId&0x7F)),0};
+        return Response{RespType::Data,static_cast<uint8_t>(rxRingBuff.IsHalfUsed()<<7|(sessionId&0x7F)),static_cast<uint16_t>(txUsedSz),rxRingBuff.FreeSize()};
+    return Response{RespType::NoCommand,static_cast<uint8_t>(rxRingBuff.IsHalfUsed()<<7|(sessionId&0x7F)),0,rxRingBuff.FreeSize()};
 }
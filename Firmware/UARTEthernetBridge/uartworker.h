@@ -13,18 +13,29 @@ class UARTWorker
         unsigned long pollInterval;
         uint8_t curMode;
         uint8_t sessionId;
+        uint8_t weight;
+        uint16_t ioSize;
+        bool paused;
         //filled on setup
         ResetHelper* resetHelper;
         HardwareSerial* uart;
-        uint8_t* rxDataBuff;
         uint8_t* txDataBuff;
         size_t txUsedSz;
     public:
-        void Setup(ResetHelper* const resetHelper, HardwareSerial* const uart, uint8_t * rxDataBuff, uint8_t * txDataBuff);
-        void ProcessRequest(const Request& request);
+        void Setup(ResetHelper* const resetHelper, HardwareSerial* const uart, uint8_t * txDataBuff);
+        //position of the port's slot depends on package format
+        void SetTXDataBuff(uint8_t * const txDataBuff);
+        //rxDataBuff points to request payload, it's position inside package depends on package format
+        void ProcessRequest(const Request& request, const uint8_t * const rxDataBuff);
         void ProcessRX();
         void FillTXBuff(bool reset);
         Response ProcessTX();
+        bool IsIdle();
+        //used when package payload space is shared between ports
+        uint16_t GetTXDemand(const uint16_t maxPlSz);
+        uint8_t GetWeight();
+        //read more data from uart right after the data collected at poll ticks
+        Response ProcessExtraTX(uint8_t * const extraBuff, const uint16_t maxSz);
 };
 
 #endif // UARTWORKER_H
@@ -1,30 +1,157 @@
 #include "udpserver.h"
 #include "crc8.h"
+#include "configuration.h"
+#include "command.h"
 
-UDPServer::UDPServer(AlarmTimer& _alarmTimer, uint8_t* const _rxBuff, uint8_t* const _txBuff, const uint16_t _pkgSz, const uint16_t _metaSz):
+UDPServer::UDPServer(AlarmTimer& _alarmTimer, uint8_t* const _rxBuff, uint8_t* const _txBuff):
     alarmTimer(_alarmTimer),
-    pkgSz(_pkgSz),
-    metaSz(_metaSz),
     rxBuff(_rxBuff),
     txBuff(_txBuff)
 {
     clientAddr = INADDR_NONE;
     clientUDPPort = 0;
-    serverSeq = clientSeq = 0;
+    nextSeq = clientSeq = 0;
+    seqSynced = false;
     serverStarted = false;
+    tcpResponses = false;
+    SetFeatures(PKG_FEATURES);
 }
 
-bool UDPServer::DropOldSeq()
+void UDPServer::SetFeatures(const uint8_t _features)
 {
-    auto checkSeq=static_cast<uint16_t>(*rxBuff|*(rxBuff+1)<<8);
-    if(static_cast<uint16_t>(serverSeq-checkSeq)>static_cast<uint16_t>(checkSeq-serverSeq))
+    features=_features;
+    pkgSz=BoardLayout::GetPackageSize(features);
+    metaSz=BoardLayout::GetMetaSize(features);
+}
+
+bool UDPServer::AcceptSeq(const uint16_t size)
+{
+    auto seq=static_cast<uint16_t>(*rxBuff|*(rxBuff+1)<<8);
+    //first package after connect defines the sequence
+    if(!seqSynced)
     {
-        serverSeq=checkSeq;
+        seqSynced=true;
+        nextSeq=seq;
+    }
+    auto distance=static_cast<uint16_t>(seq-nextSeq);
+    if(distance>=0x8000||reorderBuffer.Contains(seq))
+    {
+        stats.late++;
         return false;
     }
+    if(distance>0)
+    {
+        //hold the package until missing ones arrive
+        if(!reorderBuffer.IsFull())
+        {
+            if(reorderBuffer.GetCount()<1)
+                holdStart=millis();
+            reorderBuffer.Store(seq,rxBuff,size);
+            return false;
+        }
+        //window is full, process the nearest package skipping missing ones before it, hold the rest
+        if(reorderBuffer.GetCount()>0)
+        {
+            auto slot=reorderBuffer.FindNearest(nextSeq);
+            auto heldSeq=reorderBuffer.GetSeq(slot);
+            if(static_cast<uint16_t>(heldSeq-nextSeq)<distance)
+            {
+                reorderBuffer.Swap(slot,seq,rxBuff,size);
+                distance=static_cast<uint16_t>(heldSeq-nextSeq);
+                seq=heldSeq;
+                holdStart=millis();
+            }
+        }
+        stats.lost+=distance;
+    }
+    else if(reorderBuffer.GetCount()>0)
+        stats.reordered++;
+    nextSeq=seq+1;
     return true;
 }
 
+bool UDPServer::ReleaseHeld()
+{
+    if(reorderBuffer.GetCount()<1)
+        return false;
+    auto slot=reorderBuffer.FindNearest(nextSeq);
+    auto seq=reorderBuffer.GetSeq(slot);
+    auto distance=static_cast<uint16_t>(seq-nextSeq);
+    //wait for missing packages until hold time is passed, then skip them
+    if(distance>0)
+    {
+        if(millis()-holdStart<UDP_REORDER_HOLD_MS)
+            return false;
+        stats.lost+=distance;
+    }
+    reorderBuffer.Take(slot,rxBuff);
+    nextSeq=seq+1;
+    holdStart=millis();
+    return true;
+}
+
+//count of missing packages before the held ones, reported to the client for retransmission
+uint8_t UDPServer::GetMissingCount() const
+{
+    if(reorderBuffer.GetCount()<1)
+        return 0;
+    auto distance=static_cast<uint16_t>(reorderBuffer.GetSeq(reorderBuffer.FindNearest(nextSeq))-nextSeq);
+    return distance>UINT8_MAX?UINT8_MAX:static_cast<uint8_t>(distance);
+}
+
+void UDPServer::Retransmit()
+{
+    for(uint8_t i=0;i<nackCount;++i)
+    {
+        uint16_t size=0;
+        auto package=history.Take(static_cast<uint16_t>(nackSeq+i),size);
+        if(package==nullptr||udpServer.beginPacket(clientAddr,clientUDPPort)!=1)
+            continue;
+        udpServer.write(package,size);
+        udpServer.endPacket();
+        stats.retransmitted++;
+    }
+    nackCount=0;
+}
+
+void UDPServer::SendParity()
+{
+    uint8_t header[FEC_HDR_SIZE];
+    parityEncoder.WriteHeader(header);
+    header[FEC_HDR_SIZE-1]=CRC8(header,FEC_HDR_SIZE-1);
+    if(udpServer.beginPacket(clientAddr,clientUDPPort)==1)
+    {
+        udpServer.write(header,FEC_HDR_SIZE);
+        udpServer.write(parityEncoder.GetData(),parityEncoder.GetDataSize());
+        udpServer.endPacket();
+    }
+    parityEncoder.Clear();
+}
+
+const UDPStats& UDPServer::GetStats() const
+{
+    return stats;
+}
+
+uint16_t UDPServer::TakePathBarrier()
+{
+    if(!tcpResponses&&!tcpLastPending)
+        return 0;
+    const uint16_t barrier=PKG_PATH_BARRIER|(tcpLastPending?PKG_PATH_LAST:0)|(clientSeq&PKG_PATH_SEQ_MASK);
+    tcpLastPending=false;
+    return barrier;
+}
+
+void UDPServer::SetTCPResponses(const bool enable)
+{
+    //the next response goes via TCP once more as the last one
+    if(tcpResponses&&!enable)
+        tcpLastPending=true;
+    else if(enable)
+        tcpLastPending=false;
+    tcpResponses=enable;
+}
+
 ClientEvent UDPServer::ProcessRX(const ClientEvent &ctlEvent)
 {
     switch (ctlEvent.type)
@@ -38,12 +165,24 @@ ClientEvent UDPServer::ProcessRX(const ClientEvent &ctlEvent)
                 serverStarted=false;
             }
             clientUDPPort = 0;
-            serverSeq = clientSeq = 0;
+            tcpResponses = false;
+            tcpLastPending = false;
+            nextSeq = clientSeq = 0;
+            seqSynced = false;
+            reorderBuffer.Clear();
+            history.Clear();
+            nackCount = 0;
+            parityEncoder.Clear();
+            parityDecoder.Clear();
             //store client address for serving UDP connection
             clientAddr=ctlEvent.data.remoteAddr;
             //nothing more to do at this point
             return ctlEvent;
         case ClientEventType::NewRequest:
+            //request via TCP without UDP port moves responses to TCP, UDP packages still missing at the client are requested with it
+            SetTCPResponses(ctlEvent.data.udpPort<1);
+            if(tcpResponses&&(features&PKG_FEAT_NACK))
+                nackCount=ReadNack(rxBuff,UART_COUNT,features,nackSeq);
             //try to start UIP server
             if(!serverStarted && ctlEvent.data.udpPort>0)
             {
@@ -60,19 +199,66 @@ ClientEvent UDPServer::ProcessRX(const ClientEvent &ctlEvent)
             break;
     }
 
+    //process held package first, if missing packages arrived or waiting time for them is over
+    if(ReleaseHeld())
+    {
+        alarmTimer.SnoozeAlarm();
+        return ClientEvent{ClientEventType::NewRequest,{.udpSrvStarted=false}};
+    }
+
     //parse and read the packet, flush it as fast as possible
     size_t inSz=udpServer.parsePacket();
     if(inSz<1)
         return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
-    auto dr=static_cast<size_t>(udpServer.read(rxBuff,pkgSz));
+    auto dr=static_cast<size_t>(udpServer.read(rxBuff,(features&PKG_FEAT_FEC)?pkgSz+FEC_HDR_SIZE:pkgSz));
     udpServer.flush();
 
-    if(dr!=pkgSz||CRC8(rxBuff,metaSz)!=*(rxBuff+metaSz)||DropOldSeq())
+    //probe package is echoed back right away, so client measures UDP path even while data goes via TCP
+    if(IsProbePackage(rxBuff,static_cast<uint16_t>(dr)))
+    {
+        if(inSz==dr&&CRC8(rxBuff,PROBE_SIZE-1)==*(rxBuff+PROBE_SIZE-1)&&udpServer.beginPacket(clientAddr,udpServer.remotePort())==1)
+        {
+            udpServer.write(rxBuff,PROBE_SIZE);
+            udpServer.endPacket();
+            stats.probes++;
+        }
+        return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
+    }
+
+    //single lost package of the group is restored from parity package, and processed as received one
+    const bool recovered=(features&PKG_FEAT_FEC)&&IsParityPackage(rxBuff,static_cast<uint16_t>(dr));
+    if(recovered)
+    {
+        if(inSz!=dr||CRC8(rxBuff,FEC_HDR_SIZE-1)!=*(rxBuff+FEC_HDR_SIZE-1))
+            return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
+        inSz=dr=parityDecoder.Recover(rxBuff,static_cast<uint16_t>(dr),stats.unrecovered);
+        if(dr<1)
+            return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
+        stats.recovered++;
+    }
+
+    //variable-length package must contain exactly the payload declared at metadata block
+    if(inSz!=dr||dr<metaSz+META_CRC_SZ||CRC8(rxBuff,metaSz)!=*(rxBuff+metaSz)||
+       dr!=((features&PKG_FEAT_VARLEN)?metaSz+META_CRC_SZ+BoardLayout::GetPayloadSum(rxBuff,features):pkgSz)||
+       (PayloadCRCEnabled(features)&&!PayloadCRCValid(rxBuff,metaSz,dr)))
+        return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
+
+    //packages reported missing by the client are retransmitted on the next ProcessTX
+    if(features&PKG_FEAT_NACK)
+        nackCount=ReadNack(rxBuff,UART_COUNT,features,nackSeq);
+
+    //held packages are stored by AcceptSeq, so parity is collected from the package as received
+    if((features&PKG_FEAT_FEC)&&!recovered)
+        parityDecoder.Add(static_cast<uint16_t>(*rxBuff|*(rxBuff+1)<<8),rxBuff,static_cast<uint16_t>(dr),stats.unrecovered);
+
+    if(!AcceptSeq(static_cast<uint16_t>(dr)))
         return ClientEvent{ClientEventType::NoEvent,{.pkgReading=false}};
 
     //record client's port if all OK
     if(clientUDPPort<1)
         clientUDPPort=udpServer.remotePort();
+    //client moved data path back to UDP
+    SetTCPResponses(false);
 
     //defer connection state tracking alarm
     alarmTimer.SnoozeAlarm();
@@ -81,19 +267,36 @@ ClientEvent UDPServer::ProcessRX(const ClientEvent &ctlEvent)
     return ClientEvent{ClientEventType::NewRequest,{.udpSrvStarted=false}};
 }
 
-bool UDPServer::ProcessTX()
+bool UDPServer::ProcessTX(const uint16_t txSz)
 {
     //do not attempt to send anything if we still do not known client's local port
-    if(!serverStarted||clientUDPPort<1||udpServer.beginPacket(clientAddr,clientUDPPort)!=1)
+    if(!serverStarted||clientUDPPort<1)
+        return false;
+    //missing packages are sent before the new one, and also after responses are moved to TCP
+    if(nackCount>0)
+        Retransmit();
+    if(tcpResponses||tcpLastPending)
+        return false;
+    if(udpServer.beginPacket(clientAddr,clientUDPPort)!=1)
         return false;
     //fill-up server sequence
-    *(txBuff)=clientSeq&0xFF;
-    *(txBuff+1)=(clientSeq>>8)&0xFF;
-    clientSeq++;
-    //calculate CRC for package metadata
+    const uint16_t seq=clientSeq++;
+    *(txBuff)=seq&0xFF;
+    *(txBuff+1)=(seq>>8)&0xFF;
+    //request retransmission of client's packages missing before the held ones
+    if(features&PKG_FEAT_NACK)
+        WriteNack(txBuff,UART_COUNT,features,nextSeq,GetMissingCount());
+    //calculate CRC for package payload and metadata
+    if(PayloadCRCEnabled(features))
+        WritePayloadCRC(txBuff,metaSz,txSz);
     *(txBuff+metaSz)=CRC8(txBuff,metaSz);
     //send package
-    udpServer.write(txBuff,pkgSz);
+    udpServer.write(txBuff,txSz);
     udpServer.endPacket();
+    if(features&PKG_FEAT_NACK)
+        history.Store(seq,txBuff,txSz);
+    //parity package follows the last package of the group
+    if((features&PKG_FEAT_FEC)&&parityEncoder.Add(seq,txBuff,txSz))
+        SendParity();
     return true;
 }
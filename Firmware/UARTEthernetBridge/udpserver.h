@@ -8,27 +8,68 @@
 #include "alarmtimer.h"
 #include "watchdog.h"
 #include "clientstate.h"
+#include "configuration.h"
+#include "command.h"
+#include "reorderbuffer.h"
+#include "packagehistory.h"
+#include "paritygroup.h"
+
+struct UDPStats
+{
+    uint16_t reordered; //missing packages arrived after the ones held
+    uint16_t late; //dropped packages older than already processed ones, or duplicates
+    uint16_t lost; //missing packages skipped because of hold timeout or window overflow
+    uint16_t retransmitted; //packages sent again on client's request
+    uint16_t recovered; //lost packages restored from parity packages
+    uint16_t unrecovered; //lost packages that could not be restored, more than one missing at the group or parity is lost
+    uint16_t probes; //probe packages echoed back to the client
+};
 
 class UDPServer
 {
     private:
         AlarmTimer& alarmTimer;
-        const size_t pkgSz;
-        const size_t metaSz;
         uint8_t * const rxBuff;
         uint8_t * const txBuff;
         IPAddress clientAddr = INADDR_NONE;
-        uint16_t serverSeq = 0;
+        uint16_t nextSeq = 0;
+        bool seqSynced = false;
         uint16_t clientUDPPort = 0;
         uint16_t clientSeq = 0;
         bool serverStarted = false;
+        //client moved data path to TCP, responses follow it until the next request via UDP
+        bool tcpResponses = false;
+        //responses are moved back to UDP, but the last response via TCP is not marked yet
+        bool tcpLastPending = false;
+        uint8_t features = 0;
+        size_t pkgSz = 0;
+        size_t metaSz = 0;
         EthernetUDP udpServer;
+        ReorderBuffer<UDP_REORDER_WINDOW,BoardLayout::GetPackageSizeMax()> reorderBuffer;
+        unsigned long holdStart = 0;
+        PackageHistory<UDP_RETRANSMIT_HISTORY,BoardLayout::GetPackageSizeMax()> history;
+        //range of packages reported missing by the client
+        uint16_t nackSeq = 0;
+        uint8_t nackCount = 0;
+        ParityEncoder<UDP_FEC_GROUP,BoardLayout::GetPackageSizeMax()> parityEncoder;
+        ParityDecoder<UDP_FEC_GROUP,BoardLayout::GetPackageSizeMax()> parityDecoder;
+        UDPStats stats = {0,0,0,0,0,0,0};
     public:
-        UDPServer(AlarmTimer& alarmTimer, uint8_t * const rxBuff, uint8_t * const txBuff, const uint16_t pkgSz, const uint16_t metaSz);
+        //buffers must fit the package of any format, BoardLayout::GetUDPPackageSizeMax() for rxBuff and BoardLayout::GetPackageSizeMax() for txBuff
+        UDPServer(AlarmTimer& alarmTimer, uint8_t * const rxBuff, uint8_t * const txBuff);
+        void SetFeatures(const uint8_t features);
         ClientEvent ProcessRX(const ClientEvent& ctlEvent);
-        bool ProcessTX();
+        bool ProcessTX(const uint16_t txSz);
+        const UDPStats& GetStats() const;
+        //path flags with next UDP sequence number for the response sent via TCP, 0 if responses are not moved to TCP
+        uint16_t TakePathBarrier();
     private:
-        bool DropOldSeq();
+        void SetTCPResponses(const bool enable);
+        bool AcceptSeq(const uint16_t size);
+        bool ReleaseHeld();
+        uint8_t GetMissingCount() const;
+        void Retransmit();
+        void SendParity();
 };
 
 #endif // UDPSERVER_H